@@ -0,0 +1,149 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#pragma once
+#include "core/core.hpp"
+#include "sound_pitch.hpp"
+
+namespace rgm::base {
+/// @brief 音频状态的快照，ruby 线程可以直接读取而不必等待音频线程
+/// SDL_mixer 每混合一段音频就会在 postmix 回调中刷新快照，修改状态的任务
+/// 执行后也会立即刷新。所有字段都是独立的原子变量，读到的值至多落后一次刷新。
+struct audio_state {
+  /// @brief 单个 channel 的状态
+  struct channel_state {
+    /// @brief 最近一次在此 channel 上播放的音效 id，0 表示没有
+    std::atomic<uint64_t> id{0};
+
+    /// @brief 播放状态，1 -> is_playing，2 -> is_fading
+    std::atomic<int> state{0};
+
+    /// @brief channel 的音量
+    std::atomic<int> volume{0};
+
+    /// @brief 播放速度，即音调比例
+    std::atomic<float> pitch{1.0f};
+  };
+
+  /// @brief 所有 channel 的状态
+  std::array<channel_state, sound_pitch::max_channels> channels;
+
+  /// @brief 当前音乐的 id，0 表示没有
+  std::atomic<uint64_t> music_id{0};
+
+  /// @brief 当前音乐的指针，只在 postmix 回调中读取播放位置
+  std::atomic<Mix_Music*> music{nullptr};
+
+  /// @brief 音乐的播放状态，各比特位的含义与 music_get_state 相同
+  std::atomic<int> music_state{0};
+
+  /// @brief 音乐的音量
+  std::atomic<int> music_volume{0};
+
+  /// @brief 当前音乐的播放位置，单位是秒，无法获取时为 -1
+  std::atomic<double> music_position{-1};
+
+  /// @brief 刷新的次数
+  std::atomic<uint64_t> updates{0};
+
+  /// @brief 读取 SDL_mixer 的状态并写入快照
+  /// 在音频线程的回调中调用时已经持有音频锁，SDL 的锁是可重入的。
+  void update() {
+    const int count =
+        std::min(Mix_AllocateChannels(-1), sound_pitch::max_channels);
+    for (int i = 0; i < count; ++i) {
+      int state = 0;
+      if (Mix_Playing(i)) state += 1;
+      if (Mix_FadingChannel(i) != MIX_NO_FADING) state += 2;
+
+      channels[i].state.store(state, std::memory_order_relaxed);
+      channels[i].volume.store(Mix_Volume(i, -1), std::memory_order_relaxed);
+    }
+
+    const Mix_Fading fading = Mix_FadingMusic();
+
+    int state = 0;
+    if (fading != MIX_NO_FADING) state += 1;
+    if (fading == MIX_FADING_IN) state += 2;
+    if (fading == MIX_FADING_OUT) state += 4;
+    if (Mix_PausedMusic()) state += 8;
+    if (Mix_PlayingMusic()) state += 16;
+    music_state.store(state, std::memory_order_relaxed);
+    music_volume.store(Mix_VolumeMusic(-1), std::memory_order_relaxed);
+
+    Mix_Music* p = music.load(std::memory_order_acquire);
+    music_position.store(p ? Mix_GetMusicPosition(p) : -1.0,
+                         std::memory_order_relaxed);
+
+    updates.fetch_add(1, std::memory_order_release);
+  }
+
+  /// @brief 记录在 channel 上播放的音效
+  void set_sound(int channel, uint64_t id) {
+    if (channel < 0 || channel >= sound_pitch::max_channels) return;
+
+    channels[channel].id.store(id, std::memory_order_relaxed);
+    channels[channel].pitch.store(1.0f, std::memory_order_relaxed);
+    update();
+  }
+
+  /// @brief 记录 channel 的播放速度
+  void set_pitch(int channel, float pitch) {
+    if (channel < 0 || channel >= sound_pitch::max_channels) return;
+
+    channels[channel].pitch.store(pitch, std::memory_order_relaxed);
+  }
+
+  /// @brief 记录当前播放的音乐
+  void set_music(uint64_t id, Mix_Music* p) {
+    music_id.store(id, std::memory_order_relaxed);
+    music.store(p, std::memory_order_release);
+    update();
+  }
+
+  /// @brief 音乐被释放前调用，之后的 postmix 回调不会再访问它
+  /// Mix_FreeMusic 需要音频锁，不会与正在执行的 postmix 回调重叠。
+  void release_music(uint64_t id) {
+    if (music_id.load(std::memory_order_relaxed) != id) return;
+
+    music.store(nullptr, std::memory_order_release);
+    music_id.store(0, std::memory_order_relaxed);
+  }
+
+  /// @brief 音效的播放状态，各比特位的含义与 sound_get_state 相同
+  [[nodiscard]] int sound_state(uint64_t id) const {
+    int state = 0;
+    for (const channel_state& c : channels) {
+      if (c.id.load(std::memory_order_relaxed) == id) {
+        state |= c.state.load(std::memory_order_relaxed);
+      }
+    }
+    return state;
+  }
+
+  /// @brief SDL_mixer 的 postmix 回调
+  static void postmix(void* userdata, Uint8*, int) {
+    static_cast<audio_state*>(userdata)->update();
+  }
+};
+
+/// @brief 全局的音频状态快照，由音频线程写入，ruby 线程读取
+audio_state audio_snapshot;
+}  // namespace rgm::base
\ No newline at end of file
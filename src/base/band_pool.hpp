@@ -0,0 +1,159 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+#pragma once
+#include "core/core.hpp"
+
+namespace rgm::base {
+/// @brief 按扫描线分段并行处理图像的线程池
+/// 线程在第一次使用时创建，数量不超过 4 个，调用线程也会参与计算。
+/// run 会阻塞到所有分段处理完毕，同一时刻只能由一个线程调用。
+struct band_pool {
+  /// @brief 像素数量少于此值时直接在调用线程中处理
+  static constexpr int min_parallel_pixels = 64 * 64;
+
+  /// @brief 每个分段至少包含的行数
+  static constexpr int min_band_rows = 16;
+
+  std::vector<std::jthread> threads;
+  std::mutex mutex;
+  std::condition_variable cv_start;
+  std::condition_variable cv_done;
+
+  /*
+   * 当前的任务，以及尚未领取的分段和尚未完成的分段。run 会阻塞到任务完成，
+   * 所以只保存调用者的函数对象的地址和调用它的函数，不需要复制函数对象。
+   */
+  void (*job)(void*, int, int) = nullptr;
+  void* job_data = nullptr;
+  int rows = 0;
+  int band_rows = 0;
+  int next_band = 0;
+  int band_count = 0;
+  int pending = 0;
+  uint64_t generation = 0;
+  bool stop = false;
+
+  /// @brief 获取渲染线程使用的线程池
+  static band_pool& instance() {
+    static band_pool pool;
+    return pool;
+  }
+
+  ~band_pool() {
+    {
+      std::lock_guard lock(mutex);
+      stop = true;
+    }
+    cv_start.notify_all();
+
+    /* 先等待线程退出，再析构 mutex 等成员 */
+    threads.clear();
+  }
+
+  /// @brief 后台线程的数量
+  int size() const { return static_cast<int>(threads.size()); }
+
+  /// @brief 将 [0, rows) 分为若干段，并行地调用 f(y_begin, y_end)
+  /// @param rows 总行数
+  /// @param width 每行的像素数，用于判断是否值得并行
+  /// @param f 处理分段的函数对象，通常是一个 lambda 表达式
+  /// 直接接受 lambda 而不使用 std::function，以免捕获的变量较多时在堆上
+  /// 分配内存。
+  void run(int rows, int width, auto&& f) {
+    using F = std::remove_reference_t<decltype(f)>;
+
+    if (rows <= 0) return;
+    if (rows * width < min_parallel_pixels || rows < min_band_rows * 2) {
+      f(0, rows);
+      return;
+    }
+    if (threads.empty()) setup();
+
+    const int max_bands = size() + 1;
+    const int bands = std::min(max_bands, rows / min_band_rows);
+    {
+      std::lock_guard lock(mutex);
+      job = [](void* data, int begin, int end) {
+        (*static_cast<F*>(data))(begin, end);
+      };
+      job_data = const_cast<void*>(static_cast<const void*>(&f));
+      this->rows = rows;
+      band_rows = (rows + bands - 1) / bands;
+      band_count = (rows + band_rows - 1) / band_rows;
+      next_band = 0;
+      pending = band_count;
+      ++generation;
+    }
+    cv_start.notify_all();
+
+    /* 调用线程也领取分段 */
+    while (work()) {
+    }
+
+    std::unique_lock lock(mutex);
+    cv_done.wait(lock, [this] { return pending == 0; });
+    job = nullptr;
+    job_data = nullptr;
+  }
+
+  /// @brief 创建后台线程
+  void setup() {
+    const int n = std::clamp<int>(std::thread::hardware_concurrency(), 1, 5);
+    for (int i = 0; i < n - 1; ++i) {
+      threads.emplace_back([this] {
+        uint64_t seen = 0;
+        while (true) {
+          {
+            std::unique_lock lock(mutex);
+            cv_start.wait(lock, [&] { return stop || generation != seen; });
+            if (stop) return;
+            seen = generation;
+          }
+          while (work()) {
+          }
+        }
+      });
+    }
+  }
+
+  /// @brief 领取并处理一个分段，没有剩余的分段时返回 false
+  bool work() {
+    int band;
+    {
+      std::lock_guard lock(mutex);
+      if (next_band >= band_count) return false;
+      band = next_band++;
+    }
+
+    const int begin = band * band_rows;
+    job(job_data, begin, std::min(rows, begin + band_rows));
+
+    bool done;
+    {
+      std::lock_guard lock(mutex);
+      done = (--pending == 0);
+    }
+    if (done) cv_done.notify_one();
+    return true;
+  }
+};
+}  // namespace rgm::base
@@ -19,6 +19,9 @@
 // 3. This notice may not be removed or altered from any source distribution.
 
 #pragma once
+#include "audio_state.hpp"
+#include "band_pool.hpp"
+#include "benchmark.hpp"
 #include "controller.hpp"
 #include "core/core.hpp"
 #include "counter.hpp"
@@ -27,6 +30,8 @@
 #include "init_ruby.hpp"
 #include "init_sdl2.hpp"
 #include "init_timer.hpp"
+#include "init_trace.hpp"
+#include "kernel_benchmark.hpp"
 #include "kernel_ruby.hpp"
 #include "music.hpp"
 #include "render.hpp"
@@ -35,25 +40,30 @@
 #include "sound.hpp"
 #include "sound_pitch.hpp"
 #include "surface.hpp"
+#include "surface_kernel.hpp"
 #include "texture.hpp"
 #include "timer.hpp"
 #include "window.hpp"
 
 namespace rgm::base {
 /// @brief 执行 ruby 脚本的 task，运行游戏的主要逻辑（即 RGSS 脚本）
-/// init_ruby 必须是第一个！
-using tasks_ruby =
-    std::tuple<init_ruby, init_embeded, init_timer, init_counter, init_surfaces,
-               init_music, init_sound, init_config, init_render, init_window,
-               music_finish_callback, controller_connect,
-               controller_disconnect>;
+/// init_ruby 必须是第一个！测试用的 task 只在 develop 模式下加入。
+using tasks_ruby = core::traits::expand_tuples_t<
+    std::tuple<init_ruby, init_embeded, init_timer, init_trace, init_counter,
+               init_surfaces, init_music, init_sound, init_config, init_render,
+               init_window, music_finish_callback, controller_connect,
+               controller_disconnect>,
+    std::conditional_t<config::develop, std::tuple<init_kernel_benchmark>,
+                       std::tuple<>>>;
 
 /// @brief 执行渲染流程的 task，使用 SDL2 创建窗口，绘制画面并处理事件
-/// init_sdl2 必须是第一个！
-using tasks_render =
+/// init_sdl2 必须是第一个！测试用的 task 只在 develop 模式下加入。
+using tasks_render = core::traits::expand_tuples_t<
     std::tuple<init_sdl2, init_renderstack, init_textures, poll_event,
                clear_screen, present_window, resize_window, resize_screen,
-               set_title, set_fullscreen, get_display_bounds, get_hwnd>;
+               set_title, set_fullscreen, get_display_bounds, get_hwnd>,
+    std::conditional_t<config::develop, std::tuple<kernel_benchmark_task>,
+                       std::tuple<>>>;
 
 /// @brief 执行音乐播放的 task，使用 SDL2 Mixer 播放音乐和音效
 using tasks_audio =
@@ -0,0 +1,150 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#pragma once
+#include "core/core.hpp"
+
+namespace rgm::base {
+/// @brief 无窗口模式下逐帧记录耗时，程序退出时写入报告
+/// 与 stopwatch 类似，作为全局变量使用，借助 RAII 机制在析构时输出结果。
+/// 每一帧记录以下 4 个时间，单位为毫秒：
+/// 1. frame，逻辑线程中相邻两次 Graphics.present 的间隔；
+/// 2. ruby，一帧开始到首次发送绘制任务（Graphics.update 或 transition）之间
+///    执行 ruby 脚本的时间，没有发送绘制任务的帧等于 frame；
+/// 3. render，渲染线程中 clear_screen 到 present_window 之间的绘制时间；
+/// 4. present，渲染线程中 renderer.present() 的时间。
+/// 前 2 项只在逻辑线程中读写，后 2 项只在渲染线程中读写，互不干扰。
+/// 报告的扩展名为 .json 时输出 JSON，否则输出 CSV。
+struct frame_recorder {
+  using clock = std::chrono::steady_clock;
+
+  /// @brief 逻辑线程中当前帧的起点
+  clock::time_point frame_start = clock::now();
+
+  /// @brief 逻辑线程中当前帧执行 ruby 脚本的时间
+  std::optional<double> ruby_time;
+
+  /// @brief 逻辑线程记录的每帧的 frame 和 ruby 时间
+  std::vector<std::array<double, 2>> logic_records;
+
+  /// @brief 渲染线程中当前帧绘制的起点
+  clock::time_point render_start;
+
+  /// @brief 渲染线程中当前帧 present 的起点
+  clock::time_point present_start;
+
+  /// @brief 渲染线程记录的每帧的 render 和 present 时间
+  std::vector<std::array<double, 2>> render_records;
+
+  /// @brief 计算从 start 到现在经过的毫秒数
+  static double elapsed(clock::time_point start) {
+    std::chrono::duration<double, std::milli> diff = clock::now() - start;
+    return diff.count();
+  }
+
+  /// @brief 逻辑线程：ruby 脚本执行完毕，开始发送绘制任务
+  void logic_end() {
+    if (!config::headless) return;
+    if (!ruby_time) ruby_time = elapsed(frame_start);
+  }
+
+  /// @brief 逻辑线程：一帧结束，记录 frame 和 ruby 时间
+  void frame_end() {
+    if (!config::headless) return;
+
+    double frame_time = elapsed(frame_start);
+    logic_records.push_back({frame_time, ruby_time.value_or(frame_time)});
+    ruby_time.reset();
+    frame_start = clock::now();
+  }
+
+  /// @brief 渲染线程：开始绘制
+  void render_begin() {
+    if (!config::headless) return;
+    render_start = clock::now();
+  }
+
+  /// @brief 渲染线程：绘制完成，开始 present
+  void present_begin() {
+    if (!config::headless) return;
+    present_start = clock::now();
+  }
+
+  /// @brief 渲染线程：present 完成，记录 render 和 present 时间
+  void present_end() {
+    if (!config::headless) return;
+
+    std::chrono::duration<double, std::milli> diff =
+        present_start - render_start;
+    render_records.push_back({diff.count(), elapsed(present_start)});
+  }
+
+  /// @brief 析构时写入报告，并打印各项的平均值
+  ~frame_recorder() {
+    if (!config::headless) return;
+
+    const size_t size = std::min(logic_records.size(), render_records.size());
+    if (size == 0) return;
+
+    const std::string& path = config::benchmark_report;
+    const bool json = path.ends_with(".json");
+
+    std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+    if (!ofs) {
+      cen::log_error("[Benchmark] cannot write report to %s", path.data());
+      return;
+    }
+
+    std::array<double, 4> total{};
+    ofs << (json ? "[\n" : "frame,ruby,render,present\n");
+    for (size_t i = 0; i < size; ++i) {
+      auto [frame, ruby] = logic_records[i];
+      auto [render, present] = render_records[i];
+      total[0] += frame;
+      total[1] += ruby;
+      total[2] += render;
+      total[3] += present;
+
+      std::array<char, 160> line{};
+      if (json) {
+        snprintf(line.data(), line.size(),
+                 "  {\"frame\": %.4f, \"ruby\": %.4f, \"render\": %.4f, "
+                 "\"present\": %.4f}%s\n",
+                 frame, ruby, render, present, i + 1 < size ? "," : "");
+      } else {
+        snprintf(line.data(), line.size(), "%.4f,%.4f,%.4f,%.4f\n", frame,
+                 ruby, render, present);
+      }
+      ofs << line.data();
+    }
+    if (json) ofs << "]\n";
+
+    printf("===       Benchmark <%s>      ===\n", path.data());
+    printf("[ total frames ]: %zu\n", size);
+    printf("[ average time ]: frame %f ms, ruby %f ms, render %f ms, "
+           "present %f ms\n",
+           total[0] / size, total[1] / size, total[2] / size,
+           total[3] / size);
+  }
+};
+
+/// @brief 全局的逐帧耗时记录，只在无窗口模式下工作
+frame_recorder benchmark_recorder;
+}  // namespace rgm::base
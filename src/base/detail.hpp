@@ -175,6 +175,10 @@ struct detail_ext : detail {
   /* 静态成员变量 id_table，缓存 ruby 中各 Symbol 的 ID 提升查找效率。*/
   inline static std::vector<ID> id_table = {};
 
+  /// @brief 调用 rb_ivar_get 读取实例变量的累计次数
+  /// 只在 ruby 线程中读写，用于统计 Graphics.update 中读取实例变量的次数。
+  inline static uint64_t ivar_reads = 0;
+
   /// @brief 复制了基类 detail 的 get 函数
   template <typename T>
   [[nodiscard]] static T get(VALUE object) {
@@ -189,6 +193,7 @@ struct detail_ext : detail {
   [[nodiscard]] static VALUE get(VALUE value_) {
     Check_Type(value_, T_OBJECT);
 
+    ++ivar_reads;
     return rb_ivar_get(value_, id_table[static_cast<size_t>(w)]);
   }
 
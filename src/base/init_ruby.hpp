@@ -59,6 +59,10 @@ struct init_config {
                  config::debug ? Qtrue : Qfalse);
     rb_const_set(rb_mRGM_Config, rb_intern("Synchronized"),
                  config::synchronized ? Qtrue : Qfalse);
+    rb_const_set(rb_mRGM_Config, rb_intern("Pipelined"),
+                 config::pipelined ? Qtrue : Qfalse);
+    rb_const_set(rb_mRGM_Config, rb_intern("Lazy_Event_Pages"),
+                 config::lazy_event_pages ? Qtrue : Qfalse);
     rb_const_set(rb_mRGM_Config, rb_intern("Game_Title"),
                  rb_utf8_str_new_cstr(config::game_title.data()));
     rb_const_set(rb_mRGM_Config, rb_intern("Resource_Prefix"),
@@ -75,6 +79,12 @@ struct init_config {
                  INT2FIX(static_cast<int>(config::driver)));
     rb_const_set(rb_mRGM_Config, rb_intern("Render_Driver_Name"),
                  rb_utf8_str_new_cstr(config::driver_name.data()));
+    rb_const_set(rb_mRGM_Config, rb_intern("Headless"),
+                 config::headless ? Qtrue : Qfalse);
+    rb_const_set(rb_mRGM_Config, rb_intern("Benchmark_Frames"),
+                 INT2FIX(config::benchmark_frames));
+    rb_const_set(rb_mRGM_Config, rb_intern("Benchmark_Input"),
+                 rb_utf8_str_new_cstr(config::benchmark_input.data()));
   }
 };
 }  // namespace rgm::base
\ No newline at end of file
@@ -21,6 +21,7 @@
 #pragma once
 #include <SDL_syswm.h>
 
+#include "audio_state.hpp"
 #include "controller.hpp"
 #include "core/core.hpp"
 #include "sound_pitch.hpp"
@@ -28,6 +29,17 @@
 INCBIN(controller_mapping, "./ext/gamecontrollerdb.txt");
 
 namespace rgm::base {
+/// @brief 在 SDL 初始化之前选择视频和音频驱动，在 cen_library 中使用
+/// 无窗口模式下使用 dummy 驱动，不需要显示器、GPU 和声卡。
+struct sdl_driver {
+  sdl_driver() {
+    if (!config::headless) return;
+
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+  }
+};
+
 /// @brief 辅助设定 SDL Hint 的类，在 cen_library 中使用
 struct sdl_hint {
   cen::window::window_flags window_flag;
@@ -51,6 +63,9 @@ struct sdl_hint {
 /// @brief 封装了 SDL2 的数据的类
 /// 此类还会利用 RAII 机制管理 SDL2 初始化和退出
 struct cen_library {
+  /// @brief SDL 驱动，必须在 SDL 库之前构造
+  sdl_driver driver;
+
   /// @brief SDL 库
   cen::sdl sdl;
 
@@ -97,7 +112,8 @@ struct cen_library {
 
   /// @brief 初始化 SDL2 运行环境，创建并显示窗口
   explicit cen_library()
-      : sdl(),
+      : driver(),
+        sdl(),
         hint(),
         img(),
         ttf(),
@@ -115,12 +131,15 @@ struct cen_library {
     renderer.clear_with(cen::colors::transparent);
     renderer.present();
 
-    /* 显示窗口 */
-    window.show();
+    /* 显示窗口，无窗口模式下保持隐藏 */
+    if (!config::headless) window.show();
 
     /* 设置 SDL_MIXER 的频率调制器 */
     sound_pitch::setup();
 
+    /* 每次混合音频后刷新音频状态的快照 */
+    Mix_SetPostMix(audio_state::postmix, &audio_snapshot);
+
     /* 设置 Game Conntroller 的 Mapping */
     SDL_RWops* ops = SDL_RWFromConstMem(rgm_controller_mapping_data,
                                         rgm_controller_mapping_size);
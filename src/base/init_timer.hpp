@@ -20,6 +20,7 @@
 
 #pragma once
 #include "core/core.hpp"
+#include "benchmark.hpp"
 #include "detail.hpp"
 #include "timer.hpp"
 
@@ -82,6 +83,10 @@ struct init_timer {
       static VALUE check_delay(VALUE, VALUE frame_rate_) {
         RGMLOAD(frame_rate, double);
 
+        /* 无窗口模式下不限制帧率，只记录这一帧的耗时 */
+        benchmark_recorder.frame_end();
+        if (config::headless) return Qnil;
+
         double freq = 1 / frame_rate;
         RGMDATA(timer).tick(freq);
         return Qnil;
@@ -0,0 +1,50 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#pragma once
+#include "core/core.hpp"
+#include "detail.hpp"
+
+namespace rgm::base {
+/// @brief 追踪系统相关的初始化类
+/// @see src/core/trace.hpp
+/// 开启追踪后，程序退出时会自动导出到 config::trace_path。ruby 中也可以
+/// 随时调用 RGM::Base.trace_dump 导出，以便在出现卡顿时立刻保存现场。
+struct init_trace {
+  static void before(auto& this_worker) {
+    /* 静态的 worker 变量供函数的内部类 wrapper 使用 */
+    static decltype(auto) worker = this_worker;
+
+    /* wrapper 类，创建静态方法供 ruby 的模块绑定 */
+    struct wrapper {
+      /* ruby method: Base#trace_dump -> tracer::dump */
+      static VALUE dump(VALUE, VALUE path_) {
+        RGMLOAD(path, const char*);
+
+        return core::tracer::dump(path) ? Qtrue : Qfalse;
+      }
+    };
+
+    VALUE rb_mRGM = rb_define_module("RGM");
+    VALUE rb_mRGM_Base = rb_define_module_under(rb_mRGM, "Base");
+    rb_define_module_function(rb_mRGM_Base, "trace_dump", wrapper::dump, 1);
+  }
+};
+}  // namespace rgm::base
@@ -0,0 +1,78 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#pragma once
+#include "core/core.hpp"
+#include "detail.hpp"
+
+namespace rgm::base {
+/// @brief 任务：什么也不做的合成任务，用于测试 kernel 的吞吐量
+/// 大小与常见的绘制任务相当，由 Base#kernel_benchmark 发送到渲染线程。
+struct kernel_benchmark_task {
+  /// @brief 模拟绘制任务携带的参数
+  std::array<uint64_t, 4> payload;
+
+  /// @brief 累加 payload 的结果，防止任务被优化掉
+  inline static uint64_t sum = 0;
+
+  void run(auto&) { sum += payload[0]; }
+};
+
+/// @brief kernel 吞吐量测试相关的初始化类
+/// 只在 develop 模式下加入 tasks_ruby 和 tasks_render，见 base.hpp。
+struct init_kernel_benchmark {
+  static void before(auto& this_worker) {
+    /* 静态的 worker 变量供函数的内部类 wrapper 使用 */
+    static decltype(auto) worker = this_worker;
+
+    /* wrapper 类，创建静态方法供 ruby 的模块绑定 */
+    struct wrapper {
+      /* ruby method: Base#kernel_benchmark -> kernel_benchmark_task */
+      static VALUE kernel_benchmark(VALUE, VALUE count_, VALUE batched_) {
+        RGMLOAD(count, int);
+        RGMLOAD(batched, bool);
+
+        auto start = std::chrono::steady_clock::now();
+        if (batched) {
+          /* 与 Graphics.update 相同，在作用域结束时一次性放入队列 */
+          auto batch = worker.batch();
+          for (int i = 0; i < count; ++i) {
+            worker >> kernel_benchmark_task{{static_cast<uint64_t>(i)}};
+          }
+        } else {
+          for (int i = 0; i < count; ++i) {
+            worker >> kernel_benchmark_task{{static_cast<uint64_t>(i)}};
+          }
+        }
+        RGMWAIT(1);
+
+        std::chrono::duration<double> diff =
+            std::chrono::steady_clock::now() - start;
+        return DBL2NUM(diff.count());
+      }
+    };
+
+    VALUE rb_mRGM = rb_define_module("RGM");
+    VALUE rb_mRGM_Base = rb_define_module_under(rb_mRGM, "Base");
+    rb_define_module_function(rb_mRGM_Base, "kernel_benchmark",
+                              wrapper::kernel_benchmark, 2);
+  }
+};
+}  // namespace rgm::base
@@ -20,6 +20,7 @@
 
 #pragma once
 #include "core/core.hpp"
+#include "audio_state.hpp"
 #include "detail.hpp"
 #include "ruby_wrapper.hpp"
 
@@ -62,6 +63,9 @@ struct music_dispose {
 
   void run(auto& worker) {
     musics& data = RGMDATA(musics);
+
+    /* 先从快照中移除，postmix 回调不会再访问此音乐 */
+    audio_snapshot.release_music(id);
     data.erase(id);
   }
 };
@@ -77,6 +81,7 @@ struct music_play {
   void run(auto& worker) {
     musics& data = RGMDATA(musics);
     data.at(id).play(iteration);
+    audio_snapshot.set_music(id, data.at(id).get());
 
     /* 静态的 worker 变量供函数的内部类 wrapper 使用 */
     static decltype(auto) this_worker(worker);
@@ -105,6 +110,7 @@ struct music_fade_in {
   void run(auto& worker) {
     musics& data = RGMDATA(musics);
     data.at(id).fade_in(cen::music::ms_type{duration}, iteration);
+    audio_snapshot.set_music(id, data.at(id).get());
 
     /* 静态的 worker 变量供函数的内部类 wrapper 使用 */
     static decltype(auto) this_worker(worker);
@@ -148,7 +154,10 @@ struct music_set_volume {
   /// @brief 要设置的音量大小
   int volume;
 
-  void run(auto&) { cen::music::set_volume(volume); }
+  void run(auto&) {
+    cen::music::set_volume(volume);
+    audio_snapshot.update();
+  }
 };
 
 /// @brief 设置当前播放的音乐的播放位置
@@ -156,27 +165,42 @@ struct music_set_position {
   /// @brief 要设置的当前音乐的播放位置
   double position;
 
-  void run(auto&) { cen::music::set_position(position); }
+  void run(auto&) {
+    cen::music::set_position(position);
+    audio_snapshot.update();
+  }
 };
 
 /// @brief 恢复当前音乐的播放
 struct music_resume {
-  void run(auto&) { cen::music::resume(); }
+  void run(auto&) {
+    cen::music::resume();
+    audio_snapshot.update();
+  }
 };
 
 /// @brief 暂停当前音乐的播放
 struct music_pause {
-  void run(auto&) { cen::music::pause(); }
+  void run(auto&) {
+    cen::music::pause();
+    audio_snapshot.update();
+  }
 };
 
 /// @brief 停止当前音乐的播放
 struct music_halt {
-  void run(auto&) { cen::music::halt(); }
+  void run(auto&) {
+    cen::music::halt();
+    audio_snapshot.update();
+  }
 };
 
 /// @brief 从头播放当前音乐
 struct music_rewind {
-  void run(auto&) { cen::music::rewind(); }
+  void run(auto&) {
+    cen::music::rewind();
+    audio_snapshot.update();
+  }
 };
 
 /// @brief 淡出当前音乐
@@ -184,7 +208,10 @@ struct music_fade_out {
   /// @brief 淡出时间，单位是毫秒（ms）
   int duration;
 
-  void run(auto&) { cen::music::fade_out(cen::music::ms_type{duration}); }
+  void run(auto&) {
+    cen::music::fade_out(cen::music::ms_type{duration});
+    audio_snapshot.update();
+  }
 };
 
 /// @brief 获取当前音乐的播放状态
@@ -227,41 +254,68 @@ struct init_music {
     static decltype(auto) worker = this_worker;
 
     /* wrapper 类，创建静态方法供 ruby 的模块绑定 */
+    /* 状态的查询直接读取 audio_snapshot，不等待音频线程 */
     struct wrapper {
-      /* ruby method: Base#music_get_state -> music_get_state */
+      /* ruby method: Base#music_get_state -> audio_snapshot */
       static VALUE music_get_state(VALUE) {
-        int state = 0;
-        worker >> base::music_get_state{&state};
-        RGMWAIT(2);
-        return INT2FIX(state);
+        return INT2FIX(audio_snapshot.music_state.load());
       }
 
-      /* ruby method: Base#music_get_volume -> music_get_volume */
+      /* ruby method: Base#music_get_volume -> audio_snapshot */
       static VALUE music_get_volume(VALUE) {
-        int volume = 0;
-        worker >> base::music_get_volume{&volume};
-        RGMWAIT(2);
-        return INT2FIX(volume);
+        return INT2FIX(audio_snapshot.music_volume.load());
       }
 
-      /* ruby method: Base#music_get_position -> music_get_position */
+      /* ruby method: Base#music_get_position -> audio_snapshot */
       static VALUE music_get_position(VALUE, VALUE id_) {
         RGMLOAD(id, uint64_t);
+
+        if (audio_snapshot.music_id.load() == id) {
+          return DBL2NUM(audio_snapshot.music_position.load());
+        }
+
+        /* 不是当前播放的音乐，需要在音频线程中查询 */
         double position = 0;
         worker >> base::music_get_position{id, &position};
         RGMWAIT(2);
         return DBL2NUM(position);
       }
+
+      /* ruby method: Base#audio_latency_benchmark */
+      /* 比较 n 次同步查询和读取快照的平均耗时，单位是微秒 */
+      static VALUE audio_latency_benchmark(VALUE, VALUE n_) {
+        RGMLOAD(n, int);
+        using clock = std::chrono::steady_clock;
+
+        int state = 0;
+        const auto t0 = clock::now();
+        for (int i = 0; i < n; ++i) {
+          worker >> base::music_get_state{&state};
+          RGMWAIT(2);
+        }
+        const auto t1 = clock::now();
+        for (int i = 0; i < n; ++i) {
+          state ^= audio_snapshot.music_state.load();
+        }
+        const auto t2 = clock::now();
+
+        const std::chrono::duration<double, std::micro> sync = t1 - t0;
+        const std::chrono::duration<double, std::micro> snapshot = t2 - t1;
+        return rb_ary_new_from_args(2, DBL2NUM(sync.count() / std::max(n, 1)),
+                                    DBL2NUM(snapshot.count() / std::max(n, 1)));
+      }
     };
 
     VALUE rb_mRGM = rb_define_module("RGM");
     VALUE rb_mRGM_Base = rb_define_module_under(rb_mRGM, "Base");
-    rb_define_module_function(rb_mRGM_Base, "music_finish_callback",
+    rb_define_module_function(rb_mRGM_Base, "music_get_state",
                               wrapper::music_get_state, 0);
     rb_define_module_function(rb_mRGM_Base, "music_get_volume",
                               wrapper::music_get_volume, 0);
     rb_define_module_function(rb_mRGM_Base, "music_get_position",
                               wrapper::music_get_position, 1);
+    rb_define_module_function(rb_mRGM_Base, "audio_latency_benchmark",
+                              wrapper::audio_latency_benchmark, 1);
 
     RGMBIND(rb_mRGM_Base, "music_create", music_create, 2);
     RGMBIND(rb_mRGM_Base, "music_dispose", music_dispose, 1);
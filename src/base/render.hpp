@@ -19,6 +19,7 @@
 // 3. This notice may not be removed or altered from any source distribution.
 
 #pragma once
+#include "benchmark.hpp"
 #include "core/core.hpp"
 #include "renderstack.hpp"
 #include "ruby_wrapper.hpp"
@@ -100,6 +101,7 @@ struct clear_screen {
     /* render_timer 的起点 */
     render_timer.start();
     render_timer.step(1);
+    benchmark_recorder.render_begin();
 
     /* 开发模式检查是否有 renderstack 的出入栈错误 */
     if constexpr (config::develop) {
@@ -109,6 +111,9 @@ struct clear_screen {
       }
     }
 
+    /* 保存上一帧 viewport 的统计数据 */
+    stack.step();
+
     renderer.set_target(stack.current());
     renderer.set_blend_mode(cen::blend_mode::none);
     renderer.clear_with(config::screen_background_color);
@@ -168,7 +173,9 @@ struct present_window {
     render_timer.step(4);
 
     /* 调用 present() 会阻塞，直到收到垂直同步信号 */
+    benchmark_recorder.present_begin();
     renderer.present();
+    benchmark_recorder.present_end();
 
     /* render_timer 的终点 */
     render_timer.step(5);
@@ -23,6 +23,127 @@
 #include "init_sdl2.hpp"
 
 namespace rgm::base {
+/// @brief 渲染目标 texture 的缓存池，按宽和高分别划分尺寸等级
+/// 尺寸等级依次为 32, 48, 64, 96, 128, 192, ...，即 2 的幂次和其 1.5 倍交替，
+/// 宽和高各自向上取整到最近的等级，浪费的面积不超过原来的 2.25 倍。
+/// 每个 (宽等级, 高等级) 对应一个桶，申请和归还都是 O(1) 的操作。
+/// 空闲的 texture 同时按照最近最少使用的顺序排列，总字节数超过预算时，
+/// 淘汰最久未使用的 texture。
+struct texture_pool {
+  /// @brief 最小的尺寸等级
+  static constexpr int min_size = 32;
+
+  /// @brief 渲染器支持的最大 texture size
+  static constexpr int max_texture_size = 32768;
+
+  /// @brief 尺寸等级的数量，最大的等级是 max_texture_size
+  static constexpr int class_count = 21;
+
+  /// @brief 桶中的一个空闲 texture
+  struct entry {
+    /// @brief 空闲的 texture
+    cen::texture texture;
+
+    /// @brief 在 lru 中的位置
+    std::list<std::pair<size_t, std::list<entry>::iterator>>::iterator lru_it;
+  };
+
+  /// @brief 所有的桶，索引是 宽等级 * class_count + 高等级
+  /// 每个桶的前端是最近归还的 texture。
+  std::array<std::list<entry>, class_count * class_count> buckets;
+
+  /// @brief 所有空闲的 texture 的桶索引和位置，前端是最近归还的
+  std::list<std::pair<size_t, std::list<entry>::iterator>> lru;
+
+  /// @brief 空闲的 texture 占用的字节数上限
+  size_t capacity = 0;
+
+  /// @brief 空闲的 texture 占用的字节数
+  size_t bytes = 0;
+
+  /// @brief 统计数据：命中次数、未命中次数和淘汰次数
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+
+  /// @brief 计算不小于 value 的最小尺寸等级
+  [[nodiscard]] static constexpr int size_class(int value) {
+    if (value > max_texture_size) {
+      throw std::invalid_argument("Texture size must be less than 32768.");
+    }
+    if (value <= min_size) return 0;
+
+    /* 2^(n-1) < value <= 2^n，等级 2(n-5) 对应 2^n，前一个等级是其 3/4 */
+    const int n = std::bit_width(static_cast<unsigned>(value - 1));
+    const int k = 2 * (n - 5);
+    return value <= (3 << (n - 2)) ? k - 1 : k;
+  }
+
+  /// @brief 尺寸等级对应的大小
+  [[nodiscard]] static constexpr int class_value(int k) {
+    return (k % 2 == 0) ? (min_size << (k / 2)) : ((min_size * 3 / 2) << (k / 2));
+  }
+
+  /// @brief texture 占用的字节数，按照 bgra32 格式估算
+  [[nodiscard]] static size_t size_of(const cen::texture& texture) {
+    return static_cast<size_t>(texture.width()) * texture.height() * 4;
+  }
+
+  /// @brief 从缓存中取出能放下 width x height 的 texture
+  /// @return 未命中则返回 nullopt，由调用方按照 extent 的大小创建
+  [[nodiscard]] std::optional<cen::texture> acquire(int width, int height) {
+    std::list<entry>& bucket = buckets[index(width, height)];
+    if (bucket.empty()) {
+      ++misses;
+      return std::nullopt;
+    }
+    ++hits;
+
+    cen::texture texture = std::move(bucket.front().texture);
+    lru.erase(bucket.front().lru_it);
+    bucket.pop_front();
+    bytes -= size_of(texture);
+    return texture;
+  }
+
+  /// @brief 归还 texture，超出预算时淘汰最久未使用的 texture
+  void release(cen::texture texture) {
+    const size_t i = index(texture.width(), texture.height());
+    std::list<entry>& bucket = buckets[i];
+
+    bytes += size_of(texture);
+    bucket.push_front(entry{std::move(texture), {}});
+    lru.emplace_front(i, bucket.begin());
+    bucket.front().lru_it = lru.begin();
+
+    while (bytes > capacity && !lru.empty()) {
+      auto [j, it] = lru.back();
+      bytes -= size_of(it->texture);
+      buckets[j].erase(it);
+      lru.pop_back();
+      ++evictions;
+    }
+  }
+
+  /// @brief 实际创建的 texture 的大小，宽和高分别取整到尺寸等级
+  [[nodiscard]] static cen::iarea extent(int width, int height) {
+    return cen::iarea{class_value(size_class(width)),
+                      class_value(size_class(height))};
+  }
+
+  /// @brief 桶的索引
+  [[nodiscard]] static size_t index(int width, int height) {
+    return size_class(width) * class_count + size_class(height);
+  }
+
+  /// @brief 清空缓存
+  void clear() {
+    for (auto& bucket : buckets) bucket.clear();
+    lru.clear();
+    bytes = 0;
+  }
+};
+
 /// @brief 管理分层渲染，内置 stack 数据结构并提供缓存避免频繁申请 texture
 struct renderstack {
   /*
@@ -49,39 +170,30 @@ struct renderstack {
   5. 所有内容绘制完毕时，屏幕的内容绘制到窗口上。
   */
 
-  /// @brief 缓存使用的图片大小基数
-  static constexpr int cache_base_size = 48;
-
-  /// @brief 缓存使用的图片大小每次膨胀的倍数
-  static constexpr int cache_extend_ratio = 2;
-
-  /// @brief 渲染器支持的最大 texture size
-  static constexpr int max_texture_size = 32768;
-
   /// @brief 渲染栈，存放多层渲染结构对应的 texture
   std::vector<cen::texture> stack;
 
   /// @brief 缓存一定大小的 texture 避免重复申请内存或显存
-  std::list<cen::texture> cache;
+  texture_pool cache;
 
   /// @brief 渲染器的 handle，没有所有权
   cen::renderer_handle renderer;
 
-  /// @brief 辅助计算返回不小于当前的长和宽的2的最小幂次
-  /// @param width 图片的宽
-  /// @param height 图片的高
-  /// @return int 能放下这个图片的最小正方形 texture 的大小
-  [[nodiscard]] constexpr static int best_value(int width, int height) {
-    int least_value = std::max(width, height);
-    if (least_value > max_texture_size) {
-      throw std::invalid_argument("Texture size must be less than 32768.");
-    }
-    int value = cache_base_size;
-    while (value < least_value) {
-      value *= cache_extend_ratio;
-    }
-    return value;
-  }
+  /// @brief 直接绘制的区域，不为空时，内容绘制到 region_depth 层的此区域内
+  /// 不需要后期处理的 viewport 不入栈，而是设置此区域作为 SDL 的视口，
+  /// 坐标原点和 clip 都相对于此区域，省去了 capture 层的两次拷贝。
+  std::optional<cen::irect> region;
+
+  /// @brief 直接绘制的区域所在的层
+  size_t region_depth = 0;
+
+  /// @brief 当前帧 capture 层和直接绘制的区域的数量
+  int capture_count = 0;
+  int region_count = 0;
+
+  /// @brief 上一帧的统计数据
+  int last_capture_count = 0;
+  int last_region_count = 0;
 
   /// @brief 构造函数，不执行任何操作，初始化操作在 setup 里 */
   explicit renderstack() : stack(), cache(), renderer(nullptr) {}
@@ -94,13 +206,8 @@ struct renderstack {
     /* 给 renderer_handle 成员赋值 */
     this->renderer = cen::renderer_handle(renderer);
 
-    /*  创建缓存 cache，初始有 5 个 texture 在缓存中 */
-    int size = cache_base_size;
-    for (size_t i = 0; i < 5; ++i) {
-      cen::texture empty = make_empty_texture(size, size);
-      cache.push_back(std::move(empty));
-      size *= cache_extend_ratio;
-    }
+    /* 设置缓存的预算，单位：MB */
+    cache.capacity = static_cast<size_t>(config::render_pool_size) << 20;
 
     /* 创建与屏幕大小相同的 screen 并放入 stack 中 */
     cen::texture screen = make_empty_texture(width, height);
@@ -130,36 +237,42 @@ struct renderstack {
   /// @brief 将一个尺寸不小于 width x height 的 texture，添加到栈顶
   /// @param width texture 的最小宽度
   /// @param height texture 的最小高度
+  /// 此 texture 的内容未定义，调用方需要自行清空。
   void push_texture(int width, int height) {
-    /* 优先从缓存中查找是否有满足条件的 texture */
-    auto condition = [=](auto& x) {
-      return x.width() >= width && x.height() >= height;
-    };
-    auto it = std::find_if(cache.begin(), cache.end(), condition);
-
-    if (it != cache.end()) [[likely]] {
-      stack.push_back(std::move(*it));
-      cache.erase(it);
-    } else [[unlikely]] {
-      /* 少数的情况下，缓存中的 texture 都太小了，则创建一个足够大的 */
-      const int size = best_value(width, height);
-      cen::texture empty = make_empty_texture(size, size);
-      stack.push_back(std::move(empty));
+    /* 优先从缓存中取出相同尺寸等级的 texture */
+    if (auto opt = cache.acquire(width, height)) [[likely]] {
+      stack.push_back(std::move(*opt));
+      return;
     }
+
+    /* 未命中则按照尺寸等级创建，之后可以被相同等级的图层复用 */
+    cen::texture empty =
+        renderer.make_texture(texture_pool::extent(width, height),
+                              config::texture_format,
+                              cen::texture_access::target);
+    empty.set_blend_mode(cen::blend_mode::none);
+    stack.push_back(std::move(empty));
   }
 
-  /// @brief 将栈顶的 texture 放回到缓存里，并按照顺序排好
+  /// @brief 将栈顶的 texture 放回到缓存里
   void pop_texture() {
-    int width = stack.back().width();
-    int height = stack.back().height();
-    auto condition = [=](auto& x) {
-      return x.width() >= width && x.height() >= height;
-    };
-    auto it = std::find_if(cache.begin(), cache.end(), condition);
-    cache.insert(it, std::move(stack.back()));
+    cache.release(std::move(stack.back()));
     stack.pop_back();
   }
 
+  /// @brief 将 texture 设置为渲染目标
+  /// @param target 目标 texture
+  /// 如果 target 是直接绘制的区域所在的层，视口设置为此区域，否则是整个 texture。
+  void bind(cen::texture& target) {
+    renderer.set_target(target);
+
+    if (region && &target == &stack[region_depth]) {
+      renderer.set_viewport(*region);
+    } else {
+      SDL_RenderSetViewport(renderer.get(), nullptr);
+    }
+  }
+
   /// @brief 将一个尺寸不小于 width x height 的 texture 放到栈顶
   /// @param width texture 的最小宽度。
   /// @param height texture 的最小高度。
@@ -167,7 +280,7 @@ struct renderstack {
   void push_empty_layer(int width, int height) {
     push_texture(width, height);
 
-    renderer.set_target(current());
+    bind(current());
     renderer.set_clip(cen::irect(0, 0, width, height));
     renderer.set_blend_mode(cen::blend_mode::none);
 
@@ -181,6 +294,8 @@ struct renderstack {
   /// @param height 区域的高
   /// 当前栈顶 texture 的此区域的内容会被绘制到新的 texture 中
   void push_capture_layer(int x, int y, int width, int height) {
+    ++capture_count;
+
     cen::texture& last = current();
     last.set_blend_mode(cen::blend_mode::none);
 
@@ -189,13 +304,40 @@ struct renderstack {
                     cen::irect(0, 0, width, height));
   }
 
-  /// @brief 合并两个 texture 的方案的类，输入参数是 up 和 down 两个 texture
-  /// 此方案的目标是把 up 的内容绘制到 down 上，方案通常是一个 lambda 表达式。
-  using process_t = std::function<void(cen::texture& up, cen::texture& down)>;
+  /// @brief 设置直接绘制的区域，之后的内容直接绘制到栈顶 texture 的此区域内
+  /// @param x 区域左上角的横坐标
+  /// @param y 区域左上角的纵坐标
+  /// @param width 区域的宽
+  /// @param height 区域的高
+  /// 与 push_capture_layer 不同，此区域不入栈，结束时调用 pop_region。
+  void push_region(int x, int y, int width, int height) {
+    ++region_count;
+
+    region = cen::irect(x, y, width, height);
+    region_depth = stack.size() - 1;
+    bind(current());
+  }
+
+  /// @brief 取消直接绘制的区域，视口还原为整个栈顶 texture
+  void pop_region() {
+    region.reset();
+    bind(current());
+  }
+
+  /// @brief 一帧开始时调用，保存上一帧的统计数据并清零
+  void step() {
+    last_capture_count = capture_count;
+    last_region_count = region_count;
+    capture_count = 0;
+    region_count = 0;
+  }
 
   /// @brief 将栈顶的 texture 绘制到下一层，并移除栈顶的 texture。
-  /// @param process 合并方案
-  void merge(process_t process) {
+  /// @param process 合并方案，输入参数是 up 和 down 两个 texture
+  /// 此方案的目标是把 up 的内容绘制到 down 上，方案通常是一个 lambda 表达式。
+  /// 每帧会调用许多次，直接接受 lambda 而不使用 std::function，以免捕获的
+  /// 变量较多时在堆上分配内存。
+  void merge(auto&& process) {
     size_t depth = stack.size();
 
     /* 开发模式检查是否有 renderstack 的出入栈错误 */
@@ -212,7 +354,7 @@ struct renderstack {
   /// @brief 将目标 texture 绘制到栈顶的 texture 之上。
   /// @param process 合并方案
   /// @param texture 目标 texture
-  void merge(process_t process, cen::texture& texture) {
+  void merge(auto&& process, cen::texture& texture) {
     if constexpr (config::develop) {
       if (stack.empty()) {
         cen::log_error("Merge failed, the stack is empty!");
@@ -227,6 +369,7 @@ struct renderstack {
 
   /// @brief 清空 stack 和 缓存的 textures
   void clear() {
+    region.reset();
     stack.clear();
     cache.clear();
   }
@@ -246,4 +389,4 @@ struct init_renderstack {
 
   static void after(auto& worker) { RGMDATA(renderstack).clear(); }
 };
-}  // namespace rgm::base
\ No newline at end of file
+}  // namespace rgm::base
\ No newline at end of file
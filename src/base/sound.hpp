@@ -22,6 +22,7 @@
 #include "core/core.hpp"
 #include "detail.hpp"
 #include "ruby_wrapper.hpp"
+#include "audio_state.hpp"
 #include "sound_pitch.hpp"
 
 namespace rgm::base {
@@ -68,6 +69,7 @@ struct sound_play {
   void run(auto& worker) {
     cen::sound_effect& s = RGMDATA(sounds).at(id);
     s.play(iteration);
+    audio_snapshot.set_sound(s.channel().value_or(-1), id);
   }
 };
 
@@ -79,6 +81,7 @@ struct sound_stop {
   void run(auto& worker) {
     cen::sound_effect& s = RGMDATA(sounds).at(id);
     s.stop();
+    audio_snapshot.update();
   }
 };
 
@@ -93,6 +96,7 @@ struct sound_fade_in {
   void run(auto& worker) {
     cen::sound_effect& s = RGMDATA(sounds).at(id);
     s.fade_in(cen::music::ms_type{duration});
+    audio_snapshot.set_sound(s.channel().value_or(-1), id);
   }
 };
 
@@ -107,6 +111,7 @@ struct sound_fade_out {
   void run(auto& worker) {
     cen::sound_effect& s = RGMDATA(sounds).at(id);
     s.fade_out(cen::music::ms_type{duration});
+    audio_snapshot.update();
   }
 };
 
@@ -121,6 +126,7 @@ struct sound_set_volume {
   void run(auto& worker) {
     cen::sound_effect& s = RGMDATA(sounds).at(id);
     s.set_volume(volume);
+    audio_snapshot.update();
   }
 };
 
@@ -145,7 +151,8 @@ struct sound_set_pitch {
       int index = channel.value();
       float* p_speed = &RGMDATA(sound_speeds).at(index);
       *p_speed = pitch / 100.f;
-      sound_pitch::setupPlaybackSpeedEffect(s.get(), p_speed, index, loop);
+      sound_pitch::setup_effect(s.get(), p_speed, index, loop);
+      audio_snapshot.set_pitch(index, *p_speed);
     }
   }
 };
@@ -164,8 +171,8 @@ struct sound_get_state {
   void run(auto& worker) {
     cen::sound_effect& s = RGMDATA(sounds).at(id);
     *p_state = 0;
-    if (s.is_playing()) p_state += 1;
-    if (s.is_fading()) p_state += 2;
+    if (s.is_playing()) *p_state += 1;
+    if (s.is_fading()) *p_state += 2;
   }
 };
 
@@ -191,14 +198,12 @@ struct init_sound {
 
     /* wrapper 类，创建静态方法供 ruby 的模块绑定 */
     struct wrapper {
-      /* ruby method: Base#sound_get_state -> sound_get_state */
+      /* ruby method: Base#sound_get_state -> audio_snapshot */
       static VALUE sound_get_state(VALUE, VALUE id_) {
         RGMLOAD(id, uint64_t);
 
-        int state = 0;
-        worker >> base::sound_get_state{id, &state};
-        RGMWAIT(2);
-        return INT2FIX(state);
+        /* 直接读取快照，不等待音频线程 */
+        return INT2FIX(audio_snapshot.sound_state(id));
       }
 
       /* ruby method: Base#sound_get_channel -> sound_get_channel */
@@ -210,6 +215,18 @@ struct init_sound {
         RGMWAIT(2);
         return INT2FIX(channel);
       }
+
+      /* ruby method: Base#sound_pitch_benchmark -> sound_pitch::benchmark */
+      static VALUE sound_pitch_benchmark(VALUE, VALUE speed_, VALUE sinc_) {
+        RGMLOAD(speed, double);
+        RGMLOAD(sinc, bool);
+
+        if (!(speed >= 0)) rb_raise(rb_eArgError, "speed must not be negative");
+
+        /* 在 ruby 线程中直接计算，不需要音频设备 */
+        return DBL2NUM(
+            sound_pitch::benchmark(static_cast<float>(speed), sinc, 0.5));
+      }
     };
 
     VALUE rb_mRGM = rb_define_module("RGM");
@@ -218,6 +235,8 @@ struct init_sound {
                               wrapper::sound_get_state, 1);
     rb_define_module_function(rb_mRGM_Base, "sound_get_channel",
                               wrapper::sound_get_channel, 1);
+    rb_define_module_function(rb_mRGM_Base, "sound_pitch_benchmark",
+                              wrapper::sound_pitch_benchmark, 2);
 
     RGMBIND(rb_mRGM_Base, "sound_create", sound_create, 2);
     RGMBIND(rb_mRGM_Base, "sound_dispose", sound_dispose, 1);
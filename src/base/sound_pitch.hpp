@@ -19,7 +19,7 @@
 // 3. This notice may not be removed or altered from any source distribution.
 
 /*
- * sound_pitching_example.cpp
+ * 思路来自 sound_pitching_example.cpp
  *
  *  Created on: 27 de dez de 2017
  *      Author: Carlos Faruolo
@@ -27,220 +27,428 @@
 #pragma once
 #include "core/core.hpp"
 
-/* 这段代码是其他人写的插件，用于修改 Sound 的声调，尽量保持原样 */
+/* 根据编译选项选择 SIMD 指令集，都不支持时使用标量的实现 */
+#if defined(__AVX__)
+#include <immintrin.h>
+#define RGM_PITCH_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RGM_PITCH_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RGM_PITCH_NEON
+#endif
+
 namespace rgm::base {
+/// @brief 通过 Mix_RegisterEffect 修改 Sound 的声调
+/// 每个 mixer channel 在 pool 中有一个固定的处理器，播放时不申请内存。
+/// 重采样先把所需范围的 chunk 数据转换成 float，再用 SIMD 进行线性插值，
+/// 或者使用 8 点的 windowed-sinc 插值（config::sound_sinc）。
 struct sound_pitch {
-  static Uint16 audioFormat;  // current audio format constant
-  static int audioFrequency;  // frequency rate of the current audio format
-  static int
-      audioChannelCount;  // number of channels of the current audio format
-  static int
-      audioAllocatedMixChannelsCount;  // number of mix channels allocated
-
-  static inline Uint16 formatSampleSize(Uint16 format) {
-    return (format & 0xFF) / 8;
+  /// @brief 支持的 channel 数量，与 sound_speeds 的大小一致
+  static constexpr int max_channels = 32;
+
+  /// @brief windowed-sinc 插值使用的采样点数量
+  static constexpr int sinc_taps = 8;
+
+  /// @brief windowed-sinc 插值表的相位数量，取定点数小数部分的高 8 位
+  static constexpr int sinc_phases = 256;
+
+  /// @brief 每次重采样的最大帧数，更长的输出分段处理
+  static constexpr int block_frames = 4096;
+
+  /// @brief 播放速度的上限，决定了每段需要读取的源数据的最大长度
+  static constexpr float max_speed = 4.0f;
+
+  /// @brief 音频设备的格式、频率和声道数
+  static Uint16 audio_format;
+  static int audio_frequency;
+  static int audio_channels;
+
+  /// @brief windowed-sinc 插值表，每行对应一个相位，各行的权重之和为 1
+  static std::array<float, sinc_phases * sinc_taps> sinc_table;
+
+  /// @brief 计算 out[i] = a[i] + (b[i] - a[i]) * t[i]
+  static void lerp(const float* a, const float* b, const float* t, float* out,
+                   int n) {
+    int i = 0;
+#if defined(RGM_PITCH_AVX)
+    for (; i + 8 <= n; i += 8) {
+      const __m256 va = _mm256_loadu_ps(a + i);
+      const __m256 vb = _mm256_loadu_ps(b + i);
+      const __m256 vt = _mm256_loadu_ps(t + i);
+      _mm256_storeu_ps(
+          out + i, _mm256_add_ps(va, _mm256_mul_ps(_mm256_sub_ps(vb, va), vt)));
+    }
+#elif defined(RGM_PITCH_SSE2)
+    for (; i + 4 <= n; i += 4) {
+      const __m128 va = _mm_loadu_ps(a + i);
+      const __m128 vb = _mm_loadu_ps(b + i);
+      const __m128 vt = _mm_loadu_ps(t + i);
+      _mm_storeu_ps(out + i,
+                    _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), vt)));
+    }
+#elif defined(RGM_PITCH_NEON)
+    for (; i + 4 <= n; i += 4) {
+      const float32x4_t va = vld1q_f32(a + i);
+      const float32x4_t vb = vld1q_f32(b + i);
+      const float32x4_t vt = vld1q_f32(t + i);
+      vst1q_f32(out + i, vmlaq_f32(va, vsubq_f32(vb, va), vt));
+    }
+#endif
+    for (; i < n; ++i) out[i] = a[i] + (b[i] - a[i]) * t[i];
   }
 
-  // Get chunk time length (in ms) given its size and current audio format
-  static int computeChunkLengthMillisec(int chunkSize) {
-    // bytes / samplesize == sample points
-    const Uint32 points = chunkSize / formatSampleSize(audioFormat);
-    // sample points / channels == sample frames
-    const Uint32 frames = (points / audioChannelCount);
-    // (sample frames * 1000) / frequency == play length, in ms
-    return ((frames * 1000) / audioFrequency);
+  /// @brief 计算 sinc_taps 个元素的点积
+  [[nodiscard]] static float dot(const float* a, const float* b) {
+#if defined(RGM_PITCH_AVX)
+    const __m256 m = _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+#elif defined(RGM_PITCH_SSE2)
+    __m128 s = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)),
+                          _mm_mul_ps(_mm_loadu_ps(a + 4), _mm_loadu_ps(b + 4)));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+#elif defined(RGM_PITCH_NEON)
+    float32x4_t m = vmulq_f32(vld1q_f32(a), vld1q_f32(b));
+    m = vmlaq_f32(m, vld1q_f32(a + 4), vld1q_f32(b + 4));
+    const float32x2_t s = vadd_f32(vget_low_f32(m), vget_high_f32(m));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+#else
+    float s = 0;
+    for (int i = 0; i < sinc_taps; ++i) s += a[i] * b[i];
+    return s;
+#endif
   }
 
-  // Custom handler object to control which part of the Mix_Chunk's audio data
-  // will be played, with which pitch-related modifications. This needed to be a
-  // template because the actual Mix_Chunk's data format may vary (AUDIO_U8,
-  // AUDIO_S16, etc) and the data type varies with it (Uint8, Sint16, etc). The
-  // AudioFormatType should be the data type that is compatible with the current
-  // SDL_mixer-initialized audio format.
-  template <typename AudioFormatType>
-  struct PlaybackSpeedEffectHandler {
-    const AudioFormatType* const
-        chunkData;             // pointer to the chunk sample data (as array)
-    const float* speedFactor;  // the playback speed factor
-    float position;            // current position of the sound, in ms
-    const int duration;        // the duration of the sound, in ms
-    // the size of the sound, as a number of indexes (or sample points).
-    // thinks of this as a array size when using the proper array type (instead
-    // of just Uint8*).
-    const int chunkSize;
-    // flags whether playback should stay looping
-    const bool loop;
-    // flags whether playback should be halted by this callback when playback is
-    // finished
-    const bool attemptSelfHalting;
-    // true if this playback has been pitched by this handler
-    bool altered;
-
-    PlaybackSpeedEffectHandler(const Mix_Chunk& chunk, const float* speed,
-                               bool loop, bool trySelfHalt)
-        : chunkData(reinterpret_cast<AudioFormatType*>(chunk.abuf)),
-          speedFactor(speed),
-          position(0),
-          duration(computeChunkLengthMillisec(chunk.alen)),
-          chunkSize(chunk.alen / formatSampleSize(audioFormat)),
-          loop(loop),
-          attemptSelfHalting(trySelfHalt),
-          altered(false) {}
-
-    // processing function to be able to change chunk speed/pitch.
-    void modifyStreamPlaybackSpeed(int mixChannel, void* stream, int length) {
-      AudioFormatType* buffer = static_cast<AudioFormatType*>(stream);
-      const int bufferSize =
-          length / sizeof(AudioFormatType);  // buffer size (as array)
-      const float speedFactor =
-          *this->speedFactor;  // take a "snapshot" of speed factor
-
-      // if there is still sound to be played
-      if (position < duration || loop) {
-        // normal duration of each sample
-        const float delta = 1000.0 / audioFrequency;
-        // virtual stretched duration, scaled by 'speedFactor'
-        const float vdelta = delta * speedFactor;
-
-        // if playback is unaltered and pitch is required (for the first time)
-        if (!altered && speedFactor != 1.0f) {
-          // flags playback modification and proceed to the pitch routine.
-          altered = true;
+  /// @brief 静音对应的采样值，无符号的格式以中间值为静音
+  template <typename T>
+  [[nodiscard]] static constexpr T silence() {
+    if constexpr (std::is_unsigned_v<T>) {
+      return static_cast<T>(1u << (sizeof(T) * 8 - 1));
+    } else {
+      return T{};
+    }
+  }
+
+  /// @brief 将插值的结果转换成采样值，sinc 插值可能超出范围，需要截断
+  template <typename T>
+  [[nodiscard]] static T from_float(float v) {
+    if constexpr (std::is_floating_point_v<T>) {
+      return v;
+    } else {
+      /* 32 位的最大值不能用 float 精确表示，取不超过它的最大的 float */
+      constexpr float lo = static_cast<float>(std::numeric_limits<T>::min());
+      constexpr float hi = sizeof(T) < 4
+                               ? static_cast<float>(std::numeric_limits<T>::max())
+                               : 2147483520.0f;
+      return static_cast<T>(std::clamp(v, lo, hi));
+    }
+  }
+
+  /// @brief 一个 channel 的变调处理器，所有的缓冲区都在 pool 中重复使用
+  struct handler {
+    /// @brief chunk 的采样数据，没有所有权
+    const Uint8* data = nullptr;
+
+    /// @brief chunk 的帧数
+    int frames = 0;
+
+    /// @brief 每帧包含的采样点数量，即声道数
+    int channels = 2;
+
+    /// @brief 播放速度的地址，在 sound_speeds 中
+    const float* speed = nullptr;
+
+    /// @brief 当前的播放位置，单位是帧
+    double position = 0;
+
+    /// @brief 是否循环播放
+    bool loop = false;
+
+    /// @brief 是否使用 windowed-sinc 插值
+    bool sinc = false;
+
+    /// @brief 是否已经改变过播放速度，速度一直为 1 时不需要处理
+    bool altered = false;
+
+    /// @brief 转换成 float 的源数据，各个声道分别连续存放
+    std::vector<float> source;
+
+    /// @brief 输出的每一帧在 source 中的起点、小数部分和 sinc 插值的相位
+    std::vector<int> index;
+    std::vector<float> frac;
+    std::vector<int> phase;
+
+    /// @brief 线性插值的左右两点，以及插值的结果
+    std::vector<float> left;
+    std::vector<float> right;
+    std::vector<float> out;
+
+    /// @brief 按照最大的分段长度分配所有的缓冲区
+    /// 在音频线程之外调用，之后的回调中不再申请内存。
+    /// @param channels 声道数
+    void allocate(int channels) {
+      const int span =
+          static_cast<int>(block_frames * max_speed) + sinc_taps + 2;
+
+      source.assign(static_cast<size_t>(span) * channels, 0.0f);
+      index.assign(block_frames, 0);
+      frac.assign(block_frames, 0.0f);
+      phase.assign(block_frames, 0);
+      left.assign(block_frames, 0.0f);
+      right.assign(block_frames, 0.0f);
+      out.assign(block_frames, 0.0f);
+    }
+
+    /// @brief 开始新的一次播放
+    void reset(const Mix_Chunk& chunk, const float* speed, bool loop,
+               bool sinc) {
+      const int sample_size = (audio_format & 0xFF) / 8;
+
+      this->data = chunk.abuf;
+      this->frames = chunk.alen / sample_size / audio_channels;
+      this->channels = audio_channels;
+      this->speed = speed;
+      this->position = 0;
+      this->loop = loop;
+      this->sinc = sinc;
+      this->altered = false;
+    }
+
+    /// @brief 处理 mixer 的一段输出，长度为 length 字节
+    template <typename T>
+    void process(void* stream, int length) {
+      T* buffer = static_cast<T*>(stream);
+      const int n = static_cast<int>(length / sizeof(T)) / channels;
+      const float speed = std::clamp(*this->speed, 0.0f, max_speed);
+
+      if (n <= 0 || frames <= 0) return;
+
+      /* 非循环播放，且已经播放完毕，输出静音 */
+      if (!loop && position >= frames) {
+        std::fill_n(buffer, n * channels, silence<T>());
+        return;
+      }
+
+      if (!altered && speed != 1.0f) altered = true;
+
+      if (altered) {
+        for (int done = 0; done < n; done += block_frames) {
+          resample(buffer + static_cast<size_t>(done) * channels,
+                   std::min(n - done, block_frames), speed,
+                   position + done * static_cast<double>(speed));
         }
+      }
 
-        if (altered)  // if unaltered, this pitch routine is skipped
-        {
-          for (int i = 0; i < bufferSize; i += audioChannelCount) {
-            // j goes from 0 to size/channelCount, incremented 1 by 1
-            const int j = i / audioChannelCount;
-            // get "virtual" index. its corresponding value will be
-            // interpolated.
-            const float x = position + j * vdelta;
-            // get left index to interpolate from original chunk data
-            // (right index will be this plus 1)
-            const int k = floor(x / delta);
-            // get the proportion of the right value (left will be 1.0 minus
-            // this)
-            const float prop = (x / delta) - k;
-
-            // usually just 2 channels: 0 (left) and 1 (right), but who knows...
-            for (int c = 0; c < audioChannelCount; c++) {
-              // check if k will be within bounds
-              if (k * audioChannelCount + audioChannelCount - 1 < chunkSize ||
-                  loop) {
-                AudioFormatType v0 =
-                    chunkData[(k * audioChannelCount + c) % chunkSize];
-                AudioFormatType v1 =
-                    chunkData[((k + 1) * audioChannelCount + c) % chunkSize];
-
-                // put interpolated value on 'data'
-                // linear interpolation
-                buffer[i + c] = (1 - prop) * v0 + prop * v1;
-              } else {
-                // if k will be out of bounds (chunk bounds),
-                // it means we already finished;
-                // thus, we'll pass silence
-                buffer[i + c] = 0;
-              }
-            }
-          }
+      /* 更新播放位置 */
+      position += n * static_cast<double>(speed);
+      if (loop) position = std::fmod(position, frames);
+    }
+
+    /// @brief 从 start 开始，以 speed 的速度重采样 n 帧到 buffer 中
+    /// n 不超过 block_frames，speed 不超过 max_speed，缓冲区都已经分配好。
+    template <typename T>
+    void resample(T* buffer, int n, float speed, double start) {
+      const T* samples = reinterpret_cast<const T*>(data);
+
+      /* 插值需要当前位置之前的 pad 帧和之后的 taps - pad 帧 */
+      const int taps = sinc ? sinc_taps : 2;
+      const int pad = taps / 2 - 1;
+
+      /* 使用 32.32 的定点数计算每一帧的位置，避免逐点的 floor */
+      /* 小数部分只取高 24 位，转换成 float 时没有舍入，总是小于 1 */
+      const double base = std::floor(start);
+      uint64_t pos = static_cast<uint64_t>((start - base) * 4294967296.0);
+      const uint64_t step = static_cast<uint64_t>(speed * 4294967296.0);
+
+      static_assert(sinc_phases == 256);
+      for (int j = 0; j < n; ++j) {
+        index[j] = static_cast<int>(pos >> 32);
+        frac[j] = static_cast<float>((pos & 0xFFFFFFFFu) >> 8) * 0x1p-24f;
+        phase[j] = static_cast<int>((pos >> 24) & 0xFF);
+        pos += step;
+      }
+
+      /* 将所需范围的数据转换成 float，超出 chunk 的部分循环或者静音 */
+      const int span = index[n - 1] + taps;
+
+      int64_t f = static_cast<int64_t>(base) - pad;
+      if (loop) f = ((f % frames) + frames) % frames;
+      for (int m = 0; m < span; ++m, ++f) {
+        if (loop && f == frames) f = 0;
+
+        const bool inside = (f >= 0) && (f < frames);
+        for (int c = 0; c < channels; ++c) {
+          source[c * span + m] = static_cast<float>(
+              inside ? samples[f * channels + c] : silence<T>());
         }
-        // update position
-        position += (bufferSize / audioChannelCount) * vdelta;
-        // reset position if looping
-        if (loop) {
-          while (position > duration) {
-            position -= duration;
+      }
+
+      /* 逐个声道插值 */
+      for (int c = 0; c < channels; ++c) {
+        const float* s = source.data() + static_cast<size_t>(c) * span;
+
+        if (sinc) {
+          for (int j = 0; j < n; ++j) {
+            out[j] =
+                dot(s + index[j], sinc_table.data() + phase[j] * sinc_taps);
           }
-        }
-        // if we already played the whole sound but finished earlier than
-        // expected by SDL_mixer (due to faster playback speed) set silence on
-      } else {
-        // the buffer since Mix_HaltChannel() poops out some of it for a few ms.
-        for (int i = 0; i < bufferSize; i++) {
-          buffer[i] = 0;
+        } else {
+          for (int j = 0; j < n; ++j) {
+            left[j] = s[index[j]];
+            right[j] = s[index[j] + 1];
+          }
+          lerp(left.data(), right.data(), frac.data(), out.data(), n);
         }
 
-        if (attemptSelfHalting) {
-          // XXX unsafe call, since it locks audio;
-          // but no safer solution was found yet...
-          Mix_HaltChannel(mixChannel);
+        for (int j = 0; j < n; ++j) {
+          buffer[j * channels + c] = from_float<T>(out[j]);
         }
       }
     }
+  };
 
-    // Mix_EffectFunc_t callback that redirects to handler method (handler
-    // passed via userData)
-    static void mixEffectFuncCallback(int channel, void* stream, int length,
-                                      void* userData) {
-      static_cast<PlaybackSpeedEffectHandler*>(userData)
-          ->modifyStreamPlaybackSpeed(channel, stream, length);
-    }
+  /// @brief 所有 channel 的处理器
+  static std::array<handler, max_channels> pool;
 
-    // Mix_EffectDone_t callback that deletes the handler at the end of the
-    // effect usage (handler passed via userData)
-    static void mixEffectDoneCallback(int, void* userData) {
-      delete static_cast<PlaybackSpeedEffectHandler*>(userData);
-    }
+  /// @brief Mix_EffectFunc_t 的回调，userdata 是 pool 中的处理器
+  template <typename T>
+  static void effect_callback(int, void* stream, int length, void* userdata) {
+    static_cast<handler*>(userdata)->process<T>(stream, length);
+  }
 
-    // function to register a handler to this channel for the next playback.
-    static void registerEffect(int channel, const Mix_Chunk& chunk,
-                               const float* speed, bool loop,
-                               bool trySelfHalt) {
-      Mix_RegisterEffect(
-          channel, mixEffectFuncCallback, mixEffectDoneCallback,
-          new PlaybackSpeedEffectHandler(chunk, speed, loop, trySelfHalt));
-    }
-  };
+  /// @brief 给 channel 注册变调的处理器，对本次播放有效
+  template <typename T>
+  static void register_effect(int channel, const Mix_Chunk& chunk,
+                              const float* speed, bool loop) {
+    handler& h = pool[channel];
 
-  // Register playback speed effect handler according to the current audio
-  // format; effect valid for a single playback; if playback is looped, lasts
-  // until it's halted.
-  static void setupPlaybackSpeedEffect(const Mix_Chunk* const chunk,
-                                       const float* speed, int channel,
-                                       bool loop = false,
-                                       bool trySelfHalt = false) {
-    // select the register function for the current audio format
-    // and register the effect using the compatible handlers
-    // XXX is it correct to behave the same way to all S16 and U16 formats?
-    // Should we create case statements for AUDIO_S16SYS, AUDIO_S16LSB,
-    // AUDIO_S16MSB, etc, individually?
-    switch (audioFormat) {
-#define BRANCH(type)                                                       \
-  PlaybackSpeedEffectHandler<type>::registerEffect(channel, *chunk, speed, \
-                                                   loop, trySelfHalt)
+    /* 移除此 channel 上次注册的处理器，之后音频线程不会再访问 h */
+    Mix_UnregisterEffect(channel, effect_callback<T>);
+
+    h.reset(chunk, speed, loop, config::sound_sinc);
+    Mix_RegisterEffect(channel, effect_callback<T>, nullptr, &h);
+  }
+
+  /// @brief 根据当前的音频格式，给 channel 注册变调的处理器
+  /// @param chunk 正在播放的 chunk
+  /// @param speed 播放速度的地址，之后修改此值会实时生效
+  /// @param channel 播放 chunk 的 channel
+  /// @param loop 是否循环播放
+  static void setup_effect(const Mix_Chunk* const chunk, const float* speed,
+                           int channel, bool loop) {
+    if (channel < 0 || channel >= max_channels) return;
+
+    switch (audio_format) {
       case AUDIO_U8:
-        BRANCH(Uint8);
+        register_effect<Uint8>(channel, *chunk, speed, loop);
         break;
       case AUDIO_S8:
-        BRANCH(Sint8);
+        register_effect<Sint8>(channel, *chunk, speed, loop);
         break;
       case AUDIO_U16:
-        BRANCH(Uint16);
+        register_effect<Uint16>(channel, *chunk, speed, loop);
         break;
       default:
       case AUDIO_S16:
-        BRANCH(Sint16);
+        register_effect<Sint16>(channel, *chunk, speed, loop);
         break;
       case AUDIO_S32:
-        BRANCH(Sint32);
+        register_effect<Sint32>(channel, *chunk, speed, loop);
         break;
       case AUDIO_F32:
-        BRANCH(float);
+        register_effect<float>(channel, *chunk, speed, loop);
         break;
-#undef BRANCH
     }
   }
 
-  // setup and bind
+  /// @brief 计算 windowed-sinc 插值表，使用 Blackman 窗
+  static void setup_sinc_table() {
+    constexpr double pi = 3.14159265358979323846;
+    constexpr double half = sinc_taps / 2;
+
+    for (int p = 0; p < sinc_phases; ++p) {
+      float* row = sinc_table.data() + p * sinc_taps;
+      const double offset = static_cast<double>(p) / sinc_phases;
+
+      double sum = 0;
+      for (int t = 0; t < sinc_taps; ++t) {
+        /* 第 t 个采样点与插值位置的距离 */
+        const double x = (t - (half - 1)) - offset;
+        const double sinc = (x == 0) ? 1.0 : std::sin(pi * x) / (pi * x);
+        const double window = 0.42 + 0.5 * std::cos(pi * x / half) +
+                              0.08 * std::cos(2 * pi * x / half);
+        row[t] = static_cast<float>(sinc * window);
+        sum += row[t];
+      }
+      for (int t = 0; t < sinc_taps; ++t) {
+        row[t] = static_cast<float>(row[t] / sum);
+      }
+    }
+  }
+
+  /// @brief 基准测试，对 1 秒的 16 位立体声正弦波反复变调
+  /// @param speed 播放速度，超过 max_speed 时按 max_speed 处理
+  /// @param sinc 是否使用 windowed-sinc 插值
+  /// @param duration 测试的时长，单位是秒
+  /// @return 单个 channel 每秒能处理的 PCM 数据的秒数
+  static double benchmark(float speed, bool sinc, double duration) {
+    const int frequency = audio_frequency > 0 ? audio_frequency : 44100;
+
+    std::vector<Sint16> pcm(static_cast<size_t>(frequency) * 2);
+    for (int i = 0; i < frequency; ++i) {
+      const Sint16 v = static_cast<Sint16>(
+          8000 * std::sin(i * 440.0 * 6.2831853 / frequency));
+      pcm[i * 2] = v;
+      pcm[i * 2 + 1] = v;
+    }
+
+    /* 测试使用独立的格式，不影响音频设备的设置 */
+    handler h;
+    h.data = reinterpret_cast<const Uint8*>(pcm.data());
+    h.frames = frequency;
+    h.channels = 2;
+    h.speed = &speed;
+    h.loop = true;
+    h.sinc = sinc;
+    h.altered = true;
+    h.allocate(h.channels);
+
+    /* 每次处理 1024 帧，与 mixer 的默认缓冲区大小相近 */
+    std::vector<Sint16> stream(1024 * 2);
+    const int length = static_cast<int>(stream.size() * sizeof(Sint16));
+
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    std::chrono::duration<double> elapsed{};
+    uint64_t processed = 0;
+    do {
+      for (int i = 0; i < 64; ++i) h.process<Sint16>(stream.data(), length);
+      processed += 64 * 1024;
+      elapsed = clock::now() - start;
+    } while (elapsed.count() < duration);
+
+    return processed / static_cast<double>(frequency) / elapsed.count();
+  }
+
+  /// @brief 读取音频设备的设置，并计算插值表
   static void setup() {
-    // query specs
-    Mix_QuerySpec(&audioFrequency, &audioFormat, &audioChannelCount);
-    audioAllocatedMixChannelsCount = Mix_AllocateChannels(MIX_CHANNELS);
+    Mix_QuerySpec(&audio_frequency, &audio_format, &audio_channels);
+    Mix_AllocateChannels(MIX_CHANNELS);
+    setup_sinc_table();
+
+    for (handler& h : pool) h.allocate(audio_channels);
   }
 };
-Uint16 sound_pitch::audioFormat;
-int sound_pitch::audioFrequency;
-int sound_pitch::audioChannelCount;
-int sound_pitch::audioAllocatedMixChannelsCount;
+Uint16 sound_pitch::audio_format;
+int sound_pitch::audio_frequency;
+int sound_pitch::audio_channels;
+std::array<float, sound_pitch::sinc_phases * sound_pitch::sinc_taps>
+    sound_pitch::sinc_table;
+std::array<sound_pitch::handler, sound_pitch::max_channels> sound_pitch::pool;
 }  // namespace rgm::base
\ No newline at end of file
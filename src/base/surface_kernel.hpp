@@ -0,0 +1,390 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#pragma once
+#include "core/core.hpp"
+
+/* 根据编译选项选择 SIMD 指令集，不支持时使用标量的实现 */
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RGM_SURFACE_SSE2
+#endif
+
+namespace rgm::base {
+/// @brief 对 rgba32 格式的像素行进行批量操作的函数集合
+/// 像素按 uint32_t 存储，从低位到高位依次是 r、g、b、a。
+/// 每个函数处理一行中连续的 n 个像素，由调用者负责裁剪和遍历各行。
+struct surface_kernel {
+  /// @brief 颜色变换矩阵，out = m * (r, g, b, a) + offset
+  /// 矩阵按列存储，每列的第 4 个分量对应 alpha，变换不会修改 alpha。
+  struct transform {
+    alignas(16) std::array<float, 16> columns;
+    alignas(16) std::array<float, 4> offset;
+
+    /// @brief 根据 3x3 的 rgb 矩阵（按行）和偏移量构造变换
+    static transform make(const std::array<float, 9>& m,
+                          const std::array<float, 3>& o) {
+      transform t{};
+      for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+          t.columns[col * 4 + row] = m[row * 3 + col];
+        }
+      }
+      t.columns[15] = 1.0f;
+      t.offset = {o[0], o[1], o[2], 0.0f};
+      return t;
+    }
+
+    /// @brief 灰度，与 gray.fs 的权重相同
+    static transform gray() {
+      constexpr float r = 0.299f, g = 0.587f, b = 0.114f;
+      return make({r, g, b, r, g, b, r, g, b}, {0, 0, 0});
+    }
+
+    /// @brief 色相旋转，与 shader_hue 的系数相同
+    static transform hue(int hue) {
+      constexpr double pi = 3.141592653589793;
+      constexpr double r3 = 1.7320508075688772;
+      double angle = (pi / 180.0) * hue;
+
+      float k1 = (1.0 - cos(angle) - r3 * sin(angle)) / 3.0;
+      float k2 = (1.0 - cos(angle) + r3 * sin(angle)) / 3.0;
+      float k0 = 1.0f - k1 - k2;
+
+      return make({k0, k1, k2, k2, k0, k1, k1, k2, k0}, {0, 0, 0});
+    }
+
+    /// @brief 色调，与 tone.fs 的计算相同，参数的范围与 rmxp::tone 一致
+    static transform tone(int red, int green, int blue, int gray) {
+      constexpr float r = 0.299f, g = 0.587f, b = 0.114f;
+      const float k = gray / 255.0f;
+
+      return make({1 - k + r * k, g * k, b * k,  //
+                   r * k, 1 - k + g * k, b * k,  //
+                   r * k, g * k, 1 - k + b * k},
+                  {static_cast<float>(red), static_cast<float>(green),
+                   static_cast<float>(blue)});
+    }
+
+    /// @brief 颜色修饰，与 blend_type::color 的公式相同
+    /// rgb = alpha * color + (1 - alpha) * rgb，参数的范围是 0 ~ 255
+    static transform color(int red, int green, int blue, int alpha) {
+      const float k = alpha / 255.0f;
+
+      return make({1 - k, 0, 0, 0, 1 - k, 0, 0, 0, 1 - k},
+                  {red * k, green * k, blue * k});
+    }
+
+    /// @brief 交换 r 和 b 分量，用于处理 bgra32 格式的像素
+    [[nodiscard]] transform swap_rb() const {
+      constexpr std::array<int, 4> p = {2, 1, 0, 3};
+
+      transform t{};
+      for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+          t.columns[col * 4 + row] = columns[p[col] * 4 + p[row]];
+        }
+        t.offset[col] = offset[p[col]];
+      }
+      return t;
+    }
+  };
+
+  /// @brief 将 0 ~ 255 * 255 的值近似除以 255，结果四舍五入
+  static constexpr uint32_t div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+  }
+
+  /// @brief 用颜色 c 填充 n 个像素
+  static void fill(uint32_t* p, int n, uint32_t c) {
+    int i = 0;
+#if defined(RGM_SURFACE_SSE2)
+    const __m128i vc = _mm_set1_epi32(static_cast<int>(c));
+    for (; i + 4 <= n; i += 4) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), vc);
+    }
+#endif
+    for (; i < n; ++i) p[i] = c;
+  }
+
+  /// @brief 将颜色 from 替换为 to，返回替换的像素数量
+  static int replace(uint32_t* p, int n, uint32_t from, uint32_t to) {
+    int count = 0;
+    int i = 0;
+#if defined(RGM_SURFACE_SSE2)
+    const __m128i vf = _mm_set1_epi32(static_cast<int>(from));
+    const __m128i vt = _mm_set1_epi32(static_cast<int>(to));
+    for (; i + 4 <= n; i += 4) {
+      __m128i* q = reinterpret_cast<__m128i*>(p + i);
+      const __m128i v = _mm_loadu_si128(q);
+      const __m128i mask = _mm_cmpeq_epi32(v, vf);
+      const int bits = _mm_movemask_ps(_mm_castsi128_ps(mask));
+      if (bits == 0) continue;
+
+      count += std::popcount(static_cast<unsigned>(bits));
+      _mm_storeu_si128(
+          q, _mm_or_si128(_mm_and_si128(mask, vt), _mm_andnot_si128(mask, v)));
+    }
+#endif
+    for (; i < n; ++i) {
+      if (p[i] == from) {
+        p[i] = to;
+        ++count;
+      }
+    }
+    return count;
+  }
+
+  /// @brief 将 src 的 n 个像素以 alpha 混合的方式绘制到 dst 上
+  /// 混合方式与 SDL_BLENDMODE_BLEND 相同，src 的 alpha 会先乘以 opacity / 255。
+  static void blend(uint32_t* dst, const uint32_t* src, int n, int opacity) {
+    int i = 0;
+#if defined(RGM_SURFACE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i v255 = _mm_set1_epi16(255);
+    const __m128i v128 = _mm_set1_epi16(128);
+    const __m128i vop = _mm_set1_epi16(static_cast<int16_t>(opacity));
+    /* 每个像素的 alpha 分量置为 255，使输出的 alpha = a + da * (1 - a) */
+    const __m128i alpha_mask = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+
+    auto div255_epi16 = [&](__m128i x) {
+      x = _mm_add_epi16(x, v128);
+      return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    };
+
+    /* 以 16 位整数处理 2 个像素 */
+    auto process = [&](__m128i s, __m128i d) {
+      __m128i a = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+      a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+      a = div255_epi16(_mm_mullo_epi16(a, vop));
+
+      s = _mm_or_si128(s, alpha_mask);
+      const __m128i x = _mm_add_epi16(
+          _mm_mullo_epi16(s, a), _mm_mullo_epi16(d, _mm_sub_epi16(v255, a)));
+      return div255_epi16(x);
+    };
+
+    for (; i + 4 <= n; i += 4) {
+      const __m128i vs =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      __m128i* q = reinterpret_cast<__m128i*>(dst + i);
+      const __m128i vd = _mm_loadu_si128(q);
+
+      const __m128i lo = process(_mm_unpacklo_epi8(vs, zero),
+                                 _mm_unpacklo_epi8(vd, zero));
+      const __m128i hi = process(_mm_unpackhi_epi8(vs, zero),
+                                 _mm_unpackhi_epi8(vd, zero));
+      _mm_storeu_si128(q, _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < n; ++i) {
+      const uint32_t s = src[i];
+      const uint32_t d = dst[i];
+      const uint32_t a = div255((s >> 24) * opacity);
+
+      uint32_t out = 0;
+      for (int shift = 0; shift < 24; shift += 8) {
+        const uint32_t cs = (s >> shift) & 255;
+        const uint32_t cd = (d >> shift) & 255;
+        out |= div255(cs * a + cd * (255 - a)) << shift;
+      }
+      out |= div255(255 * a + (d >> 24) * (255 - a)) << 24;
+      dst[i] = out;
+    }
+  }
+
+  /// @brief 根据渐变图计算 n 个像素的透明度，与 transition.fs 的计算相同
+  /// @param out 输出的透明度，0 ~ 255
+  /// @param mask 渐变图的灰度，0 ~ 255
+  /// @param threshold 渐变完成的程度乘以 255
+  /// @param vague 渐变过渡的模糊程度，为 0 时只输出 0 或 255
+  static void ramp(uint8_t* out, const uint8_t* mask, int n, int threshold,
+                   int vague) {
+    /* out = (mask - threshold + vague) * 255 / vague，vague 为 0 时视为阶跃 */
+    const float base = static_cast<float>((vague == 0 ? 1 : vague) - threshold);
+    const float k = (vague == 0) ? 255.0f : 255.0f / vague;
+
+    int i = 0;
+#if defined(RGM_SURFACE_SSE2)
+    const __m128 vbase = _mm_set1_ps(base);
+    const __m128 vk = _mm_set1_ps(k);
+    const __m128i zero = _mm_setzero_si128();
+
+    auto process = [&](__m128i v32) {
+      const __m128 x = _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(v32), vbase), vk);
+      return _mm_cvtps_epi32(x);
+    };
+
+    for (; i + 16 <= n; i += 16) {
+      const __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+      const __m128i lo = _mm_unpacklo_epi8(v, zero);
+      const __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+      const __m128i p0 = process(_mm_unpacklo_epi16(lo, zero));
+      const __m128i p1 = process(_mm_unpackhi_epi16(lo, zero));
+      const __m128i p2 = process(_mm_unpacklo_epi16(hi, zero));
+      const __m128i p3 = process(_mm_unpackhi_epi16(hi, zero));
+
+      /* 饱和打包自动截断到 0 ~ 255 */
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                       _mm_packus_epi16(_mm_packs_epi32(p0, p1),
+                                        _mm_packs_epi32(p2, p3)));
+    }
+#endif
+    for (; i < n; ++i) {
+      const float x = (mask[i] + base) * k;
+      out[i] = static_cast<uint8_t>(
+          std::clamp(static_cast<int>(std::nearbyint(x)), 0, 255));
+    }
+  }
+
+  /// @brief 按透明度混合两组像素，dst = from * alpha + to * (1 - alpha)
+  /// alpha 的范围是 0 ~ 255，包括 alpha 分量在内的 4 个分量都参与混合。
+  static void mix(uint32_t* dst, const uint32_t* from, const uint32_t* to,
+                  const uint8_t* alpha, int n) {
+    int i = 0;
+#if defined(RGM_SURFACE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i v255 = _mm_set1_epi16(255);
+    const __m128i v128 = _mm_set1_epi16(128);
+
+    auto div255_epi16 = [&](__m128i x) {
+      x = _mm_add_epi16(x, v128);
+      return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    };
+
+    /* 以 16 位整数处理 2 个像素 */
+    auto process = [&](__m128i f, __m128i t, __m128i a) {
+      return div255_epi16(_mm_add_epi16(
+          _mm_mullo_epi16(f, a), _mm_mullo_epi16(t, _mm_sub_epi16(v255, a))));
+    };
+
+    for (; i + 4 <= n; i += 4) {
+      int32_t a4;
+      std::memcpy(&a4, alpha + i, 4);
+
+      /* 每个透明度重复 4 次，对应像素的 4 个分量 */
+      __m128i va = _mm_cvtsi32_si128(a4);
+      va = _mm_unpacklo_epi8(va, va);
+      va = _mm_unpacklo_epi16(va, va);
+
+      const __m128i vf =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+      const __m128i vt =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(to + i));
+
+      const __m128i lo =
+          process(_mm_unpacklo_epi8(vf, zero), _mm_unpacklo_epi8(vt, zero),
+                  _mm_unpacklo_epi8(va, zero));
+      const __m128i hi =
+          process(_mm_unpackhi_epi8(vf, zero), _mm_unpackhi_epi8(vt, zero),
+                  _mm_unpackhi_epi8(va, zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                       _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < n; ++i) {
+      const uint32_t a = alpha[i];
+
+      uint32_t out = 0;
+      for (int shift = 0; shift < 32; shift += 8) {
+        const uint32_t cf = (from[i] >> shift) & 255;
+        const uint32_t ct = (to[i] >> shift) & 255;
+        out |= div255(cf * a + ct * (255 - a)) << shift;
+      }
+      dst[i] = out;
+    }
+  }
+
+  /// @brief 对 n 个像素应用颜色变换，结果截断到 0 ~ 255
+  static void apply(uint32_t* p, int n, const transform& t) {
+    int i = 0;
+#if defined(RGM_SURFACE_SSE2)
+    const __m128 c0 = _mm_load_ps(t.columns.data());
+    const __m128 c1 = _mm_load_ps(t.columns.data() + 4);
+    const __m128 c2 = _mm_load_ps(t.columns.data() + 8);
+    const __m128 c3 = _mm_load_ps(t.columns.data() + 12);
+    const __m128 vo = _mm_load_ps(t.offset.data());
+    const __m128i zero = _mm_setzero_si128();
+
+    /* 一个像素的 4 个分量转换为 float 后，计算 m * v + offset */
+    auto process = [&](__m128i v16) {
+      const __m128 v = _mm_cvtepi32_ps(v16);
+      __m128 out = _mm_add_ps(
+          vo, _mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0))));
+      out = _mm_add_ps(
+          out, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+      out = _mm_add_ps(
+          out, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+      out = _mm_add_ps(
+          out, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+      return _mm_cvtps_epi32(out);
+    };
+
+    for (; i + 4 <= n; i += 4) {
+      __m128i* q = reinterpret_cast<__m128i*>(p + i);
+      const __m128i v = _mm_loadu_si128(q);
+      const __m128i lo = _mm_unpacklo_epi8(v, zero);
+      const __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+      const __m128i p0 = process(_mm_unpacklo_epi16(lo, zero));
+      const __m128i p1 = process(_mm_unpackhi_epi16(lo, zero));
+      const __m128i p2 = process(_mm_unpacklo_epi16(hi, zero));
+      const __m128i p3 = process(_mm_unpackhi_epi16(hi, zero));
+
+      /* 饱和打包自动截断到 0 ~ 255 */
+      _mm_storeu_si128(q, _mm_packus_epi16(_mm_packs_epi32(p0, p1),
+                                           _mm_packs_epi32(p2, p3)));
+    }
+#endif
+    for (; i < n; ++i) {
+      const uint32_t c = p[i];
+      const std::array<float, 4> v = {
+          static_cast<float>(c & 255), static_cast<float>((c >> 8) & 255),
+          static_cast<float>((c >> 16) & 255), static_cast<float>(c >> 24)};
+
+      uint32_t out = 0;
+      for (int k = 0; k < 4; ++k) {
+        float x = t.offset[k];
+        for (int j = 0; j < 4; ++j) x += t.columns[j * 4 + k] * v[j];
+
+        const int y = static_cast<int>(std::lround(x));
+        out |= static_cast<uint32_t>(std::clamp(y, 0, 255)) << (k * 8);
+      }
+      p[i] = out;
+    }
+  }
+
+  /// @brief 对 surface 中 rect 区域内的每一行调用 f(row, width)
+  /// rect 会先被裁剪到 surface 的范围内
+  static void for_each_row(cen::surface& s, SDL_Rect rect, auto f) {
+    const SDL_Rect bound{0, 0, s.width(), s.height()};
+    SDL_Rect r;
+    if (!SDL_IntersectRect(&rect, &bound, &r)) return;
+
+    uint8_t* base = static_cast<uint8_t*>(s.pixel_data());
+    for (int y = r.y; y < r.y + r.h; ++y) {
+      f(reinterpret_cast<uint32_t*>(base + y * s.pitch()) + r.x, r.w);
+    }
+  }
+};
+}  // namespace rgm::base
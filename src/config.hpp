@@ -59,6 +59,7 @@ bool debug = false;
 /* 从 config.ini 中读取的设置 */
 bool synchronized = true;
 bool concurrent = false;
+bool pipelined = false;
 bool controller_left_arrow = true;
 bool controller_right_arrow = true;
 std::string game_title = "RGModern";
@@ -67,6 +68,20 @@ int window_width = 640;
 int window_height = 480;
 int screen_width = 640;
 int screen_height = 480;
+int external_cache_size = 64;
+int render_pool_size = 64;
+bool sound_sinc = false;
+bool lazy_event_pages = false;
+
+/* 无窗口的基准测试模式，也可以通过环境变量 RGM_HEADLESS 开启 */
+bool headless = false;
+int benchmark_frames = 600;
+std::string benchmark_input = "";
+std::string benchmark_report = "benchmark.csv";
+
+/* 导出 Chrome trace 的追踪系统，也可以通过环境变量 RGM_TRACE 开启 */
+bool trace = false;
+std::string trace_path = "trace.json";
 
 /* 支持的 driver 的类型 */
 enum class driver_type { software, opengl, direct3d9, direct3d11 };
@@ -101,18 +116,46 @@ void load_data(std::map<std::string, section_t>& data) {
   Set(game_title, "Game", "Title");
   Set(synchronized, "Kernel", "Synchronization");
   Set(concurrent, "Kernel", "Concurrency");
+  Set(pipelined, "Kernel", "Pipelined");
   Set(controller_left_arrow, "Kernel", "LeftAxisArrow");
   Set(controller_right_arrow, "Kernel", "RightAxisArrow");
   Set(resource_prefix, "Kernel", "ResourcePrefix");
+  Set(external_cache_size, "Kernel", "ExternalCacheSize");
+  Set(render_pool_size, "Kernel", "RenderPoolSize");
+  Set(lazy_event_pages, "Kernel", "LazyEventPages");
+  Set(trace, "Kernel", "Trace");
+  Set(trace_path, "Kernel", "TracePath");
   Set(window_width, "System", "WindowWidth");
   Set(window_height, "System", "WindowHeight");
   Set(screen_width, "System", "ScreenWidth");
   Set(screen_height, "System", "ScreenHeight");
+  Set(sound_sinc, "System", "SoundSinc");
 #ifdef __WIN32
   Set(driver_name, "Kernel", "RenderDriver");
 #endif
+  Set(headless, "Benchmark", "Headless");
+  Set(benchmark_frames, "Benchmark", "Frames");
+  Set(benchmark_input, "Benchmark", "InputScript");
+  Set(benchmark_report, "Benchmark", "Report");
 #undef Set
 
+  /* 环境变量优先于 config.ini，方便在 CI 中运行 */
+  if (const char* env = std::getenv("RGM_HEADLESS")) {
+    headless = (std::string_view(env) != "" && std::string_view(env) != "0");
+  }
+  if (const char* env = std::getenv("RGM_BENCHMARK_FRAMES")) {
+    benchmark_frames = std::atoi(env);
+  }
+  if (const char* env = std::getenv("RGM_TRACE")) {
+    trace = (std::string_view(env) != "" && std::string_view(env) != "0");
+  }
+
+  /* 无窗口模式使用软件渲染器，配合 SDL 的 dummy 视频驱动 */
+  if (headless) driver_name = "software";
+
+  /* 流水线模式只在异步多线程模式下生效 */
+  if (synchronized) pipelined = false;
+
   /* 将 driver_name 转换成小写 */
   std::transform(driver_name.begin(), driver_name.end(), driver_name.begin(),
                  [](unsigned char c) { return std::tolower(c); });
@@ -0,0 +1,138 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#pragma once
+#include "config.hpp"
+
+namespace rgm::core {
+/// @brief 全局 operator new 被调用的次数
+/// 开发模式下由 main.cpp 中替换的 operator new 累加，其他模式下始终为 0。
+/// 指定了对齐方式的 operator new 不在统计范围内。
+inline std::atomic<uint64_t> heap_allocations = 0;
+
+/// @brief 逐帧重置的内存池
+/// 逻辑线程每帧都会发送大量的绘制任务，任务中的 std::vector 等数据如果
+/// 在堆上分配，每帧都要分配和释放许多次。这些数据改为从此内存池中分配，
+/// 释放时什么也不做，等到使用它们的任务都执行完毕后一次性地重置。
+/// 内存池分为 2 代轮流使用，step 切换到另一代并重置它，调用者需要保证
+/// 上上次 step 之前分配的数据都不再被使用。每一代的缓冲区会逐渐增长到能
+/// 容纳一整帧的数据，此后不再向上游申请内存。
+/// 只有拥有此内存池的线程可以分配内存，释放则可以在任意线程中进行。
+struct frame_arena : std::pmr::memory_resource {
+  /// @brief 统计向上游申请内存的次数和字节数的 memory_resource
+  struct upstream_resource : std::pmr::memory_resource {
+    /// @brief 申请内存的次数
+    uint64_t count = 0;
+
+    /// @brief 申请内存的字节数
+    size_t bytes = 0;
+
+    void* do_allocate(size_t size, size_t alignment) override {
+      ++count;
+      bytes += size;
+      return std::pmr::new_delete_resource()->allocate(size, alignment);
+    }
+
+    void do_deallocate(void* p, size_t size, size_t alignment) override {
+      std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+    }
+
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+  };
+
+  /// @brief 内存池的一代，缓冲区用完后由 upstream 分配
+  struct generation {
+    std::unique_ptr<std::byte[]> buffer;
+    size_t capacity = 0;
+    upstream_resource upstream;
+    std::optional<std::pmr::monotonic_buffer_resource> resource;
+  };
+
+  /// @brief 轮流使用的 2 代
+  std::array<generation, 2> generations;
+
+  /// @brief 当前使用的代的索引
+  size_t index = 0;
+
+  /// @brief 本帧分配的字节数
+  size_t bytes = 0;
+
+  /// @brief 本帧开始时 heap_allocations 的值
+  uint64_t heap_mark = 0;
+
+  /// @brief 上一帧的统计数据
+  /// 依次为分配的字节数、向上游申请内存的次数和全局的堆分配次数。
+  size_t last_bytes = 0;
+  uint64_t last_overflows = 0;
+  uint64_t last_heap_allocations = 0;
+
+  explicit frame_arena() {
+    for (generation& g : generations) g.resource.emplace(&g.upstream);
+  }
+
+  /// @brief 一帧结束时调用，切换到另一代并重置它
+  /// 如果这一代上次向上游申请过内存，则将缓冲区扩大到能容纳全部的数据。
+  void step() {
+    const uint64_t heap = heap_allocations.load(std::memory_order_relaxed);
+
+    last_bytes = bytes;
+    last_overflows = generations[index].upstream.count;
+    last_heap_allocations = heap - heap_mark;
+    bytes = 0;
+    heap_mark = heap;
+
+    index = 1 - index;
+    generation& g = generations[index];
+    g.resource->release();
+
+    if (g.upstream.count > 0) {
+      const size_t size = std::bit_ceil(g.capacity + g.upstream.bytes);
+
+      g.resource.reset();
+      g.buffer = std::make_unique_for_overwrite<std::byte[]>(size);
+      g.capacity = size;
+      g.resource.emplace(g.buffer.get(), size, &g.upstream);
+    }
+    g.upstream.count = 0;
+    g.upstream.bytes = 0;
+  }
+
+  /// @brief 2 代的缓冲区的总字节数
+  [[nodiscard]] size_t capacity() const {
+    return generations[0].capacity + generations[1].capacity;
+  }
+
+  void* do_allocate(size_t size, size_t alignment) override {
+    bytes += size;
+    return generations[index].resource->allocate(size, alignment);
+  }
+
+  /* 内存在重置时统一回收，这里什么也不做 */
+  void do_deallocate(void*, size_t, size_t) override {}
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+}  // namespace rgm::core
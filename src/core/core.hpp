@@ -19,12 +19,14 @@
 // 3. This notice may not be removed or altered from any source distribution.
 
 #pragma once
+#include "arena.hpp"
 #include "config.hpp"
 #include "cooperation.hpp"
 #include "kernel.hpp"
 #include "scheduler.hpp"
 #include "semaphore.hpp"
 #include "stopwatch.hpp"
+#include "trace.hpp"
 #include "type_traits.hpp"
 #include "worker.hpp"
 
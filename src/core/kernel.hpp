@@ -20,9 +20,16 @@
 
 #pragma once
 #include "semaphore.hpp"
+#include "trace.hpp"
 #include "type_traits.hpp"
 
 namespace rgm::core {
+/// @brief 当前线程是否处于批量发送任务的作用域中，值为作用域嵌套的层数
+/// 大于 0 时，发往各个 kernel 的任务会先暂存在本线程中，离开最外层的
+/// 作用域时再一次性地放入队列。
+/// @see worker::batch
+inline thread_local int batch_depth = 0;
+
 /// @brief worker 运作任务的核，负责处理任务队列
 /// @tparam T_tasks 支持的任务类型，除此以外的类型不会在此 kernel 中执行
 /// @tparam active 区分核是主动模式还是被动模式。
@@ -39,19 +46,56 @@ struct kernel {
   using T_variants =
       decltype(traits::tuple_to_variant(std::declval<T_tasks>()));
 
+  /// @brief 每次从队列中批量取出的任务数量的上限
+  static constexpr size_t bulk_size = 64;
+
   /// @brief 存放所有待执行任务的队列，这是一个多读多写的无锁管道
   moodycamel::BlockingConcurrentQueue<T_variants> m_queue;
 
+  /// @brief 批量出队时使用的缓冲区，只在拥有此 kernel 的线程中读写
+  /// 任务在 [m_head, m_tail) 范围内，执行前先移出缓冲区。
+  std::array<T_variants, bulk_size> m_buffer;
+
+  /// @brief 缓冲区中下一个待执行的任务的位置
+  size_t m_head = 0;
+
+  /// @brief 缓冲区中任务的数量
+  size_t m_tail = 0;
+
+  /// @brief 批量发送时，当前线程暂存的发往此 kernel 的任务
+  inline static thread_local std::vector<T_variants> t_pending;
+
   /// @brief 将任务放入队列中
   /// @tparam T 任务的类型
   /// @param t 任务对象，此参数必须是右值引用类型，将所有权交给队列
   /// @return 返回 *this
+  /// 在批量发送的作用域中，任务先暂存起来，保持与同一线程发出的其他任务
+  /// 的先后顺序。带有信号量的任务（如 synchronize_signal）会立刻连同之前
+  /// 暂存的任务一起放入队列，否则发送方将永远阻塞。
   template <typename T>
   kernel& operator<<(T&& t) {
+    if (batch_depth > 0) {
+      t_pending.emplace_back(std::forward<T>(t));
+
+      if constexpr (requires { t.pause->release(); }) {
+        commit();
+      }
+      return *this;
+    }
+
     m_queue.enqueue(std::forward<T>(t));
     return *this;
   }
 
+  /// @brief 将当前线程暂存的任务一次性地放入队列中
+  void commit() {
+    if (t_pending.empty()) return;
+
+    m_queue.enqueue_bulk(std::make_move_iterator(t_pending.begin()),
+                         t_pending.size());
+    t_pending.clear();
+  }
+
   /// @brief 依次执行队列中的任务并清空队列，只有主动线程才会调用此函数。
   /// @param worker 拥有此 kernel 的 worker
   /// worker 将作为入参传递给各个 task 的 run 函数。
@@ -60,21 +104,29 @@ struct kernel {
 
     auto visitor = [&worker]<typename T>(T& item) {
       if constexpr (!std::is_same_v<std::monostate, T>) {
+        trace_scope scope(trace_name<T>());
         item.run(worker);
       }
     };
 
     /* 查看 stop_source 的状态，及时退出运行 */
     while (!worker.is_stopped()) {
-      T_variants item;
-      if constexpr (active) {
-        /* 主动模式下队列为空就退出循环 */
-        if (!m_queue.try_dequeue(item)) break;
-      } else {
-        /* 被动模式下队列为空则阻塞 1ms，然后继续获取任务 */
-        m_queue.wait_dequeue_timed(item, std::chrono::milliseconds{1});
+      /* 缓冲区为空时，从队列中批量取出任务 */
+      if (m_head == m_tail) {
+        m_head = 0;
+        if constexpr (active) {
+          /* 主动模式下队列为空就退出循环 */
+          m_tail = m_queue.try_dequeue_bulk(m_buffer.begin(), bulk_size);
+          if (m_tail == 0) break;
+        } else {
+          /* 被动模式下队列为空则阻塞，直到有新的任务或者收到停止信号 */
+          m_tail = m_queue.wait_dequeue_bulk(m_buffer.begin(), bulk_size);
+          continue;
+        }
       }
 
+      /* 先移出缓冲区再执行，任务执行期间可能会再次调用 flush */
+      T_variants item = std::move(m_buffer[m_head++]);
       std::visit(visitor, item);
     }
 
@@ -90,6 +142,11 @@ struct kernel {
       }
     };
 
+    /* 缓冲区中尚未执行的任务 */
+    while (m_head != m_tail) {
+      std::visit(visitor, m_buffer[m_head++]);
+    }
+
     while (true) {
       T_variants item;
       if (!m_queue.try_dequeue(item)) break;
@@ -101,7 +158,13 @@ struct kernel {
   /// @brief 默认的 run 函数就是清空队列
   /// @param worker 拥有此 kernel 的 worker
   /// 被动线程将使用此函数，主动线程需要覆写此函数以执行特定任务。
-  void run(auto& worker) { flush(worker); }
+  void run(auto& worker) {
+    /* 收到停止信号时放入一个空任务，唤醒阻塞在队列上的线程 */
+    std::stop_callback wake(worker.p_scheduler->stop_source.get_token(),
+                            [this] { m_queue.enqueue(std::monostate{}); });
+
+    flush(worker);
+  }
 };
 
 /// @brief 偏特化为主动模式的核，当作其他核的基类使用
@@ -21,6 +21,7 @@
 #pragma once
 #include "config.hpp"
 #include "cooperation.hpp"
+#include "trace.hpp"
 #include "type_traits.hpp"
 
 namespace rgm::core {
@@ -196,6 +197,13 @@ struct scheduler<First, Rest...> : scheduler<> {
         workers);
   }
 
+  /// @brief 将当前线程暂存的任务批量放入各个 worker 的队列中
+  /// @see worker::batch
+  void commit() {
+    std::apply([](auto&... worker) { (worker.m_kernel.commit(), ...); },
+               workers);
+  }
+
   /// @brief 将某个 task 分配给能接受此 task 的 worker
   /// @tparam T_task 被分配的 task 的类型
   /// @return 如果此 task 不被任何 worker 接受，则返回 false，否则返回 true
@@ -216,6 +224,9 @@ struct scheduler<First, Rest...> : scheduler<> {
       return (get_task(worker, task) || ...);
     };
 
+    /* 记录发送任务的时刻，与执行的时刻对比可以看出队列中的延迟 */
+    tracer::instant(trace_name<T_task>());
+
     /* 遍历所有的 workers 并执行 set_task 操作 */
     bool ret = std::apply(set_task, workers);
 
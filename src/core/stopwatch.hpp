@@ -20,29 +20,43 @@
 
 #pragma once
 #include "config.hpp"
+#include "trace.hpp"
 
 namespace rgm::core {
-/// @brief 秒表的基类，提供了接口函数，但不执行任何操作
+/// @brief 秒表的基类，提供了接口函数，只在开启追踪时记录各阶段
 /// 在非开发模式下使用此类代替 stopwatch 以提升性能
+/// 开启追踪时（config::trace），每个阶段都会记录为一个追踪事件，事件的
+/// 参数是阶段的索引，所以发布版本中也能看到每一帧各阶段的耗时。
 struct stopwatch_base {
+  /// @brief 秒表的名称，作为追踪事件的名称
+  const char* trace_name;
+
+  /// @brief 上一个记录点的时间戳，-1 表示不记录
+  int64_t trace_last = -1;
+
   /// @brief 秒表的构造函数
   /// @param name 秒表的名称，打印结果时显示
   /// @param skip_counts 正式计时前跳过的步数
-  explicit stopwatch_base(const char*, int64_t = 0) {}
+  explicit stopwatch_base(const char* name, int64_t = 0) : trace_name(name) {}
 
   /// @brief 秒表计时的起点
   /// 秒表每次调用 start 都会重新开始计时
-  void start() {}
+  void start() { trace_last = tracer::enabled() ? tracer::now() : -1; }
 
   /// @brief 秒表计时的阶段记录点
   /// @param index 表示此处为第 index 个阶段记录点
-  void step(size_t) {}
+  void step(size_t index) {
+    if (trace_last < 0) return;
+
+    tracer::complete(trace_name, trace_last, index);
+    trace_last = tracer::now();
+  }
 };
 
 /// @brief 秒表，用于测试若干段反复执行代码的性能。
 /// 继承自 stopwatch_base 作为全局变量使用。
 /// 借助 RAII 机制，在程序退出时析构并打印相关的调试信息。
-struct stopwatch_normal {
+struct stopwatch_normal : stopwatch_base {
   /// @brief 代表一个阶段性记录点的内部类
   struct interval {
     /// @brief 当前记录的时间，与下一个阶段记录的时间做减法来计时
@@ -74,7 +88,8 @@ struct stopwatch_normal {
   /// @brief stopwatch_normal 的构造函数
   /// @param name 打印结果时显示的名称
   /// @param skip_counts 正式计时前跳过的步数，默认为 1
-  explicit stopwatch_normal(const char* name, int skip_counts = 1) : data() {
+  explicit stopwatch_normal(const char* name, int skip_counts = 1)
+      : stopwatch_base(name), data() {
     this->name = name;
     this->index = total_index++;
     this->counts = 0 - skip_counts;
@@ -110,6 +125,8 @@ struct stopwatch_normal {
 
   /// @brief 标记计时的起点
   void start() {
+    stopwatch_base::start();
+
     ++counts;
     if (counts < 0) return;
     data[0].now = std::chrono::steady_clock::now();
@@ -117,6 +134,8 @@ struct stopwatch_normal {
 
   /// @brief 标记计时的阶段记录点
   void step(size_t index) {
+    stopwatch_base::step(index);
+
     if (counts < 0) return;
     data[index].now = std::chrono::steady_clock::now();
     std::chrono::duration<double> diff = data[index].now - data[index - 1].now;
@@ -0,0 +1,295 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#pragma once
+#include "config.hpp"
+
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#define RGM_TRACE_DEMANGLE 1
+#endif
+
+namespace rgm::core {
+/// @brief 一条追踪记录，对应于 Chrome trace 格式中的一个事件
+/// 所有成员都是原子变量，导出时其他线程可能仍在写入，使用 relaxed 顺序
+/// 读写不会产生额外的开销。
+struct trace_event {
+  /// @brief 事件的名称，必须是静态存储期的字符串
+  std::atomic<const char*> name = nullptr;
+
+  /// @brief 事件的起点，单位：纳秒
+  std::atomic<int64_t> ts = 0;
+
+  /// @brief 事件的持续时间，单位：纳秒
+  std::atomic<int64_t> dur = 0;
+
+  /// @brief 附加的参数，如等待的 worker 索引、秒表的阶段等
+  std::atomic<int64_t> arg = 0;
+
+  /// @brief 事件的类型，'X' 表示持续一段时间，'i' 表示瞬间
+  std::atomic<char> phase = 0;
+};
+
+/// @brief 每个线程独有的环形缓冲区
+/// 只有所属的线程会写入，写满后覆盖最早的记录，写入时不需要加锁。
+struct trace_buffer {
+  /// @brief 缓冲区的容量，每个线程最多保留的事件数量
+  static constexpr size_t capacity = 1 << 15;
+
+  /// @brief 存储事件的数组
+  std::array<trace_event, capacity> events;
+
+  /// @brief 已经写入的事件总数，对 capacity 取余即下一个写入的位置
+  std::atomic<uint64_t> head = 0;
+
+  /// @brief 线程的编号，从 1 开始
+  uint64_t tid = 0;
+
+  /// @brief 线程的名称，必须是静态存储期的字符串
+  std::atomic<const char*> thread_name = "main";
+
+  /// @brief 写入一个事件
+  void push(const char* name, char phase, int64_t ts, int64_t dur,
+            int64_t arg) {
+    const uint64_t h = head.load(std::memory_order_relaxed);
+    trace_event& e = events[h % capacity];
+
+    /* 与 dump 中的 acquire fence 配对：读到这次写入的值时，也能读到 head */
+    std::atomic_thread_fence(std::memory_order_release);
+
+    e.name.store(name, std::memory_order_relaxed);
+    e.ts.store(ts, std::memory_order_relaxed);
+    e.dur.store(dur, std::memory_order_relaxed);
+    e.arg.store(arg, std::memory_order_relaxed);
+    e.phase.store(phase, std::memory_order_relaxed);
+
+    head.store(h + 1, std::memory_order_release);
+  }
+};
+
+/// @brief 追踪系统，记录各个线程的任务、等待和计时，导出为 Chrome trace
+/// 追踪总是参与编译，由 config::trace 在运行时开关，关闭时每个记录点只多
+/// 一次布尔判断。导出的 JSON 可以在 chrome://tracing 或 Perfetto 中查看。
+struct tracer {
+  using clock = std::chrono::steady_clock;
+
+  /// @brief 所有时间戳的零点
+  inline static const clock::time_point epoch = clock::now();
+
+  /// @brief 保护 buffers 的互斥锁，只在线程首次记录和导出时使用
+  inline static std::mutex mutex;
+
+  /// @brief 所有线程的缓冲区，线程退出后仍然保留，以便在程序结束时导出
+  inline static std::vector<std::unique_ptr<trace_buffer>> buffers;
+
+  /// @brief 当前线程的缓冲区
+  inline static thread_local trace_buffer* t_buffer = nullptr;
+
+  /// @brief 当前线程的名称
+  inline static thread_local const char* t_name = "main";
+
+  /// @brief 追踪是否开启
+  [[nodiscard]] static bool enabled() noexcept { return config::trace; }
+
+  /// @brief 当前的时间戳，单位：纳秒
+  [[nodiscard]] static int64_t now() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() -
+                                                                epoch)
+        .count();
+  }
+
+  /// @brief 获取当前线程的缓冲区，首次调用时创建
+  [[nodiscard]] static trace_buffer& local() {
+    if (!t_buffer) [[unlikely]] {
+      std::scoped_lock lock(mutex);
+
+      buffers.push_back(std::make_unique<trace_buffer>());
+      t_buffer = buffers.back().get();
+      t_buffer->tid = buffers.size();
+      t_buffer->thread_name.store(t_name, std::memory_order_relaxed);
+    }
+    return *t_buffer;
+  }
+
+  /// @brief 设置当前线程的名称
+  /// @param name 线程的名称，必须是静态存储期的字符串
+  static void name_thread(const char* name) {
+    t_name = name;
+    if (t_buffer) t_buffer->thread_name.store(name, std::memory_order_relaxed);
+  }
+
+  /// @brief 记录一个持续事件，从 start 开始到现在结束
+  static void complete(const char* name, int64_t start, int64_t arg = 0) {
+    if (!enabled()) return;
+    local().push(name, 'X', start, now() - start, arg);
+  }
+
+  /// @brief 记录一个瞬间事件
+  static void instant(const char* name, int64_t arg = 0) {
+    if (!enabled()) return;
+    local().push(name, 'i', now(), 0, arg);
+  }
+
+  /// @brief 将类型名转换为可读的形式
+  [[nodiscard]] static std::string demangle(const char* name) {
+#ifdef RGM_TRACE_DEMANGLE
+    int status = 0;
+    char* p = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (p) {
+      std::string ret = p;
+      std::free(p);
+      return ret;
+    }
+#endif
+    return name;
+  }
+
+  /// @brief 转义 JSON 字符串中的特殊字符
+  [[nodiscard]] static std::string escape(std::string_view s) {
+    std::string ret;
+    ret.reserve(s.size());
+    for (char c : s) {
+      if (c == '"' || c == '\\') ret.push_back('\\');
+      if (static_cast<unsigned char>(c) < 0x20) continue;
+      ret.push_back(c);
+    }
+    return ret;
+  }
+
+  /// @brief 导出所有线程的追踪记录，可以在任意线程中随时调用
+  /// @param path 导出的 JSON 文件的路径
+  /// @return 成功写入文件则返回 true
+  /// 导出时其他线程可能仍在写入，被覆盖的记录会被丢弃。
+  static bool dump(const std::string& path) {
+    std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+    if (!ofs) return false;
+
+    /* 任务的名称是 typeid 的返回值，缓存转换后的结果 */
+    std::map<const char*, std::string> names;
+    auto get_name = [&names](const char* name) -> const std::string& {
+      auto it = names.find(name);
+      if (it == names.end()) {
+        it = names.emplace(name, escape(demangle(name))).first;
+      }
+      return it->second;
+    };
+
+    std::scoped_lock lock(mutex);
+
+    bool first = true;
+    auto separator = [&first, &ofs] {
+      ofs << (first ? "\n" : ",\n");
+      first = false;
+    };
+
+    ofs << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for (auto& p_buffer : buffers) {
+      trace_buffer& buffer = *p_buffer;
+
+      /* 线程名称的元数据 */
+      separator();
+      ofs << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, "
+          << "\"tid\": " << buffer.tid << ", \"args\": {\"name\": \""
+          << escape(buffer.thread_name.load(std::memory_order_relaxed))
+          << "\"}}";
+
+      const uint64_t end = buffer.head.load(std::memory_order_acquire);
+      uint64_t begin = end > trace_buffer::capacity
+                           ? end - trace_buffer::capacity
+                           : 0;
+
+      std::vector<std::array<int64_t, 3>> values;
+      std::vector<std::pair<const char*, char>> keys;
+      for (uint64_t i = begin; i < end; ++i) {
+        const trace_event& e = buffer.events[i % trace_buffer::capacity];
+        keys.emplace_back(e.name.load(std::memory_order_relaxed),
+                          e.phase.load(std::memory_order_relaxed));
+        values.push_back({e.ts.load(std::memory_order_relaxed),
+                          e.dur.load(std::memory_order_relaxed),
+                          e.arg.load(std::memory_order_relaxed)});
+      }
+
+      /*
+       * 复制期间被覆盖的记录不可信，丢弃。fence 保证复制时读到的新值对应的
+       * head 都能在这里读到。写入位置 head 的事件正在进行，它占用的槽位
+       * 对应的 head - capacity 也要丢弃。
+       */
+      std::atomic_thread_fence(std::memory_order_acquire);
+      const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+      if (head >= trace_buffer::capacity &&
+          head - trace_buffer::capacity + 1 > begin) {
+        begin = head - trace_buffer::capacity + 1;
+      }
+
+      for (uint64_t i = begin; i < end; ++i) {
+        const size_t k = i - (end - keys.size());
+        auto [name, phase] = keys[k];
+        auto [ts, dur, arg] = values[k];
+        if (!name) continue;
+
+        std::array<char, 96> buf{};
+        separator();
+        ofs << "{\"ph\": \"" << phase << "\", \"name\": \"" << get_name(name)
+            << "\", \"pid\": 1, \"tid\": " << buffer.tid;
+        snprintf(buf.data(), buf.size(), ", \"ts\": %.3f", ts / 1000.0);
+        ofs << buf.data();
+        if (phase == 'X') {
+          snprintf(buf.data(), buf.size(), ", \"dur\": %.3f", dur / 1000.0);
+          ofs << buf.data();
+        } else {
+          ofs << ", \"s\": \"t\"";
+        }
+        ofs << ", \"args\": {\"arg\": " << arg << "}}";
+      }
+    }
+    ofs << "\n]}\n";
+    return true;
+  }
+};
+
+/// @brief 返回任务类型的名称，导出时再转换为可读的形式
+template <typename T>
+[[nodiscard]] const char* trace_name() noexcept {
+  return typeid(T).name();
+}
+
+/// @brief 利用 RAII 机制记录一段代码的执行时间
+/// 构造时追踪未开启，则析构时也不会记录。
+struct trace_scope {
+  /// @brief 事件的名称，必须是静态存储期的字符串
+  const char* name;
+
+  /// @brief 附加的参数
+  int64_t arg;
+
+  /// @brief 起点，-1 表示不记录
+  int64_t start;
+
+  explicit trace_scope(const char* name, int64_t arg = 0) noexcept
+      : name(name), arg(arg), start(tracer::enabled() ? tracer::now() : -1) {}
+
+  ~trace_scope() {
+    if (start >= 0) tracer::complete(name, start, arg);
+  }
+
+  trace_scope(const trace_scope&) = delete;
+  trace_scope& operator=(const trace_scope&) = delete;
+};
+}  // namespace rgm::core
@@ -19,10 +19,12 @@
 // 3. This notice may not be removed or altered from any source distribution.
 
 #pragma once
+#include "arena.hpp"
 #include "cooperation.hpp"
 #include "kernel.hpp"
 #include "scheduler.hpp"
 #include "semaphore.hpp"
+#include "trace.hpp"
 #include "type_traits.hpp"
 
 namespace rgm::core {
@@ -86,6 +88,11 @@ struct worker {
   /// 使用智能指针是为了精确控制其生命周期。
   std::unique_ptr<T_data> p_data;
 
+  /// @brief worker 逐帧重置的内存池，供发送给其他 worker 的任务分配数据
+  /// 任务可能在其他线程中析构并归还内存，使用静态变量保证内存池比所有的
+  /// 任务队列都活得更久。
+  inline static frame_arena arena;
+
   /// @brief 发送停止信号，在异步多线程模式下还会恢复等待自身的 worker。
   void stop() noexcept {
     p_scheduler->stop_source.request_stop();
@@ -159,6 +166,12 @@ struct worker {
           co_index, size, std::tuple_size_v<T_tasks>,
           std::tuple_size_v<T_kernel_tasks>);
     }
+    /* 异步多线程模式下，每个 worker 都有自己的线程 */
+    if constexpr (is_asynchronized) {
+      static const std::string name = "worker " + std::to_string(co_index);
+      tracer::name_thread(name.data());
+    }
+
     p_data = std::make_unique<T_data>();
     traits::for_each<T_tasks>::before(*this);
   }
@@ -209,6 +222,29 @@ struct worker {
     return static_cast<derived_t>(p_scheduler)->broadcast(std::move(task));
   }
 
+  /// @brief 开启批量发送任务的作用域
+  /// @tparam c 辅助 scheduler<>* 向下转型，使用默认参数推迟编译时的推导时机
+  /// @return 作用域对象，析构时结束批量发送
+  /// 作用域内当前线程发出的任务会暂存起来，离开最外层的作用域时，每个
+  /// kernel 只调用一次 enqueue_bulk，减少了队列的同步开销。作用域可以嵌套。
+  /// 这是一个静态函数，调用静态成员变量 p_scheduer 执行。
+  template <cooperation c = co_type>
+  [[nodiscard]] static auto batch() {
+    using derived_t = scheduler_cast<c>::type;
+
+    static_assert(!std::is_void_v<derived_t>,
+                  "Failed to downcast scheduler<>* !");
+
+    struct guard {
+      ~guard() noexcept {
+        if (--batch_depth == 0) static_cast<derived_t>(p_scheduler)->commit();
+      }
+    };
+
+    ++batch_depth;
+    return guard{};
+  }
+
   /// @brief 使当前线程的运行和目标线程同步
   /// @tparam id 要等待的线程的 co_index
   /// 1. 当前线程发送 synchronize_signal 信号
@@ -220,6 +256,8 @@ struct worker {
     if (is_stopped()) return;
 
     if constexpr (is_asynchronized) {
+      trace_scope scope("RGMWAIT", id);
+
       bool ret = send(synchronize_signal<id>{&(m_kernel.m_pause)});
       if (ret) m_kernel.m_pause.acquire();
     }
@@ -259,6 +297,7 @@ struct worker {
     if constexpr (is_asynchronized || is_active) {
       m_kernel << std::forward<T>(task);
     } else {
+      trace_scope scope(trace_name<T>());
       task.run(*this);
     }
     return *this;
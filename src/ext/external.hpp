@@ -22,77 +22,191 @@
 #include "base/base.hpp"
 
 namespace rgm::ext {
-/// @brief 管理外部 zip 资源包的类
-/// 可以直接从外部资源包读取 texture 和 surface，对应为 ruby 中的
-/// Bitmap 和 Palette。此方法用于实现图像素材的加密。
-struct zip_data_external {
+/// @brief 所有 worker 共享的外部 zip 资源包
+/// 打开资源包时一次性地读取中央目录，建立文件名到条目的索引，之后索引
+/// 只读，可以在任意线程中查询。libzip 的句柄和解压缓存由互斥锁保护。
+/// 解压后的文件内容按最近最少使用的顺序缓存，总字节数不超过
+/// config::external_cache_size MB，重复读取同一文件时无需再次解压。
+struct zip_archive {
+  /// @brief 资源包中单个文件的索引信息
+  struct entry {
+    /// @brief 文件在资源包中的序号，用于 zip_fopen_index
+    zip_uint64_t index;
+
+    /// @brief 解压后的大小
+    zip_uint64_t size;
+
+    /// @brief 压缩后的大小
+    zip_uint64_t comp_size;
+
+    /// @brief 文件的 CRC 校验码，libzip 读完文件时会校验
+    uint32_t crc;
+  };
+
+  /// @brief 缓存中的文件内容，使用智能指针以便在被淘汰后仍可安全使用
+  using buffer = std::shared_ptr<const std::string>;
+
   /// @brief 管理外部资源文件的指针
   zip_t* archive;
 
-  /// @brief 在构造函数中什么也不做
-  explicit zip_data_external() : archive(nullptr) {}
+  /// @brief 文件名 => 索引信息
+  std::map<std::string, entry, std::less<>> entries;
 
-  /// @brief 在析构函数中释放保存的资源
-  ~zip_data_external() {
-    if (archive) zip_close(archive);
-  }
+  /// @brief 保护 archive 和缓存的互斥锁
+  std::mutex mutex;
 
-  /// @brief 注册某个 zip 包为外部资源包
+  /// @brief 缓存的文件，越靠前的越是最近使用过的
+  std::list<std::pair<std::string, buffer>> lru;
+
+  /// @brief 文件名 => 缓存在 lru 中的位置
+  std::map<std::string_view, decltype(lru)::iterator> cached;
+
+  /// @brief 缓存的容量和当前占用的字节数
+  size_t capacity;
+  size_t bytes;
+
+  /// @brief 缓存的命中和未命中次数
+  uint64_t hits;
+  uint64_t misses;
+
+  /// @brief 打开资源包，建立索引
   /// @param path 外部资源包的路径
   /// @param password 外部资源包的密码
-  void regist(std::string_view path, std::string_view password) {
+  explicit zip_archive(std::string_view path, std::string_view password)
+      : archive(nullptr),
+        entries(),
+        mutex(),
+        lru(),
+        cached(),
+        capacity(static_cast<size_t>(std::max(config::external_cache_size, 0)) *
+                 1024 * 1024),
+        bytes(0),
+        hits(0),
+        misses(0) {
     zip_error_t error;
     zip_source_t* zs;
 
-    if (archive) zip_close(archive);
-
     if (path.size() != 0) {
       zs = zip_source_file_create(path.data(), 0, 0, &error);
       archive = zip_open_from_source(zs, ZIP_RDONLY, &error);
     }
+    if (!archive) return;
+
     if (password.size() != 0) {
       zip_set_default_password(archive, password.data());
     }
+
+    /* 遍历中央目录，建立索引 */
+    zip_int64_t n = zip_get_num_entries(archive, 0);
+    for (zip_int64_t i = 0; i < n; ++i) {
+      zip_stat_t sb;
+      if (zip_stat_index(archive, i, ZIP_FL_ENC_UTF_8, &sb) != 0) continue;
+      if (!(sb.valid & ZIP_STAT_NAME)) continue;
+
+      entries.emplace(sb.name, entry{static_cast<zip_uint64_t>(i), sb.size,
+                                     sb.comp_size, sb.crc});
+    }
+  }
+
+  /// @brief 在析构函数中释放保存的资源
+  ~zip_archive() {
+    if (archive) zip_close(archive);
   }
 
+  zip_archive(const zip_archive&) = delete;
+  zip_archive& operator=(const zip_archive&) = delete;
+
   /// @brief 检查某个路径是否位于外部资源包中
-  /// @param path 要检查的文件名称
-  /// @return 如果该文件存在，则 true，否则 false
   [[nodiscard]] bool check(std::string_view path) const {
-    zip_stat_t sb;
-    int ret = zip_stat(archive, path.data(), ZIP_FL_ENC_UTF_8, &sb);
-    return ret == 0;
+    return entries.find(path) != entries.end();
   }
 
-  /// @brief 读取外部资源包中指定的文件的内容
+  /// @brief 读取外部资源包中指定的文件的内容，优先从缓存中读取
   /// @param path 外部资源包中的文件路径
-  /// @return 成功则 std::string 中存储了文件的内容，失败返回 std::nullopt
-  [[nodiscard]] std::optional<std::string> load_string(
-      std::string_view path) const {
-    std::string buf;
-
-    zip_stat_t sb;
-    int ret = zip_stat(archive, path.data(), ZIP_FL_ENC_UTF_8, &sb);
-    if (ret != 0) return std::nullopt;
+  /// @return 成功则返回文件的内容，失败返回 nullptr
+  [[nodiscard]] buffer load(std::string_view path) {
+    auto it = entries.find(path);
+    if (it == entries.end()) return nullptr;
+
+    std::scoped_lock lock(mutex);
+
+    /* 命中缓存，将其移动到 lru 的最前面 */
+    if (auto c = cached.find(path); c != cached.end()) {
+      ++hits;
+      lru.splice(lru.begin(), lru, c->second);
+      return c->second->second;
+    }
+    ++misses;
 
-    zip_file_t* file = zip_fopen(archive, path.data(), ZIP_FL_ENC_UTF_8);
-    if (!file) return std::nullopt;
+    const entry& e = it->second;
+    core::trace_scope scope("zip_archive::load", e.size);
 
-    buf.resize(sb.size);
-    zip_fread(file, buf.data(), sb.size);
+    zip_file_t* file = zip_fopen_index(archive, e.index, 0);
+    if (!file) return nullptr;
 
+    auto buf = std::make_shared<std::string>(e.size, '\0');
+    zip_int64_t n = zip_fread(file, buf->data(), e.size);
     zip_fclose(file);
+
+    /* 读取失败（如密码错误、校验不通过）时不缓存 */
+    if (n < 0 || static_cast<zip_uint64_t>(n) != e.size) return nullptr;
+
+    /* 超过缓存容量的文件不缓存 */
+    if (e.size > capacity) return buf;
+
+    lru.emplace_front(it->first, buf);
+    cached.emplace(lru.front().first, lru.begin());
+    bytes += e.size;
+
+    /* 淘汰最久未使用的文件，直到缓存的大小不超过容量 */
+    while (bytes > capacity) {
+      auto& [name, old] = lru.back();
+      bytes -= old->size();
+      cached.erase(name);
+      lru.pop_back();
+    }
     return buf;
   }
 
+  /// @brief 读取缓存的统计数据
+  /// @return 依次为命中次数、未命中次数、缓存占用的字节数
+  [[nodiscard]] std::array<uint64_t, 3> stats() {
+    std::scoped_lock lock(mutex);
+    return {hits, misses, bytes};
+  }
+};
+
+/// @brief 管理外部 zip 资源包的类
+/// 可以直接从外部资源包读取 texture 和 surface，对应为 ruby 中的
+/// Bitmap 和 Palette。此方法用于实现图像素材的加密。
+/// 每个 worker 都持有同一个 zip_archive 的智能指针，重新注册资源包时，
+/// 旧的资源包会在所有 worker 都不再使用后才关闭。
+struct zip_data_external {
+  /// @brief 共享的外部资源包，未注册时为空
+  std::shared_ptr<zip_archive> p_archive;
+
+  /// @brief 检查某个路径是否位于外部资源包中
+  /// @param path 要检查的文件名称
+  /// @return 如果该文件存在，则 true，否则 false
+  [[nodiscard]] bool check(std::string_view path) const {
+    return p_archive && p_archive->check(path);
+  }
+
+  /// @brief 读取外部资源包中指定的文件的内容
+  /// @param path 外部资源包中的文件路径
+  /// @return 成功则返回文件的内容，失败返回 nullptr
+  [[nodiscard]] zip_archive::buffer load_string(std::string_view path) const {
+    if (!p_archive) return nullptr;
+
+    return p_archive->load(path);
+  }
+
   /// @brief 直接读取外部资源包中的图像文件为 cen::texture
   /// @param path 外部资源包中的图像文件路径
   /// @param renderer SDL 的渲染器
   /// @return 成功则返回新创建的 cen::texture，失败则返回 std::nullopt。
   [[nodiscard]] std::optional<cen::texture> load_texture(
       std::string_view path, cen::renderer& renderer) const {
-    if (!archive) return std::nullopt;
-
     auto buf = load_string(path);
     if (!buf) return std::nullopt;
 
@@ -111,8 +225,6 @@ struct zip_data_external {
   /// @return 成功则返回新创建的 cen::surface，失败则返回 std::nullopt。
   [[nodiscard]] std::optional<cen::surface> load_surface(
       std::string_view path) const {
-    if (!archive) return std::nullopt;
-
     auto buf = load_string(path);
     if (!buf) return std::nullopt;
 
@@ -132,21 +244,17 @@ template <size_t worker_id = 0>
 struct regist_external_data {
   using data = std::tuple<zip_data_external>;
 
-  /// @brief path 外部资源包的路径
-  std::string path;
-
-  /// @brief password 外部资源包的密码
-  std::string password;
+  /// @brief 共享的外部资源包
+  std::shared_ptr<zip_archive> p_archive;
 
   void run(auto& worker) {
     zip_data_external& z = RGMDATA(zip_data_external);
 
-    z.regist(path, password);
+    z.p_archive = p_archive;
 
     /* 递归广播此任务给下一个 worker */
     if constexpr (worker_id < config::max_workers) {
-      worker >> regist_external_data<worker_id + 1>{std::move(path),
-                                                    std::move(password)};
+      worker >> regist_external_data<worker_id + 1>{std::move(p_archive)};
     }
   }
 };
@@ -166,8 +274,11 @@ struct init_external {
         RGMLOAD(path, std::string);
         RGMLOAD(password, std::string);
 
+        /* 打开资源包并建立索引，所有的 worker 共享同一个 zip_archive */
+        auto p_archive = std::make_shared<zip_archive>(path, password);
+
         /* 这里不能用 worker >> 送到队列中，需要立刻执行 */
-        regist_external_data<0>{path, password}.run(worker);
+        regist_external_data<0>{std::move(p_archive)}.run(worker);
 
         return Qnil;
       }
@@ -178,8 +289,6 @@ struct init_external {
 
         zip_data_external& z = RGMDATA(zip_data_external);
 
-        if (!z.archive) return Qfalse;
-
         bool valid = z.check(path);
         return valid ? Qtrue : Qfalse;
       }
@@ -198,6 +307,17 @@ struct init_external {
 
         return object;
       }
+
+      /* ruby method: Base#external_cache_stats -> zip_archive::stats */
+      static VALUE external_cache_stats(VALUE) {
+        zip_data_external& z = RGMDATA(zip_data_external);
+
+        std::array<uint64_t, 3> stats{};
+        if (z.p_archive) stats = z.p_archive->stats();
+
+        return rb_ary_new_from_args(3, ULL2NUM(stats[0]), ULL2NUM(stats[1]),
+                                    ULL2NUM(stats[2]));
+      }
     };
 
     VALUE rb_mRGM = rb_define_module("RGM");
@@ -209,6 +329,10 @@ struct init_external {
                               wrapper::external_regist, 2);
     rb_define_module_function(rb_mRGM_Ext, "external_load",
                               wrapper::external_load, 1);
+
+    VALUE rb_mRGM_Base = rb_define_module_under(rb_mRGM, "Base");
+    rb_define_module_function(rb_mRGM_Base, "external_cache_stats",
+                              wrapper::external_cache_stats, 0);
   }
 };
 }  // namespace rgm::ext
\ No newline at end of file
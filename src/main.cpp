@@ -20,6 +20,20 @@
 
 #include "main.hpp"
 
+#if RGM_BUILDMODE < 2
+/* 开发模式下统计 operator new 的调用次数，供 Graphics.arena_stats 使用 */
+void* operator new(std::size_t size) {
+  rgm::core::heap_allocations.fetch_add(1, std::memory_order_relaxed);
+
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
 /// @brief SDL_Main 函数，程序的实际入口。
 int main(int argc, char* argv[]) {
 #ifdef __WIN32
@@ -54,6 +68,12 @@ int main(int argc, char* argv[]) {
                            cen::message_box_type::error);
   }
 
+  /* 开启追踪时，导出所有线程的追踪记录 */
+  if (rgm::config::trace) {
+    rgm::core::tracer::dump(rgm::config::trace_path);
+    cen::log_info("trace is saved to %s", rgm::config::trace_path.data());
+  }
+
   cen::log_info("RGModern ends with applause.");
   return 0;
 }
\ No newline at end of file
@@ -25,6 +25,7 @@
 #include "ext/external.hpp"
 #include "font.hpp"
 #include "shader/shader.hpp"
+#include "software_effect.hpp"
 
 namespace rgm::rmxp {
 /*
@@ -33,6 +34,32 @@ namespace rgm::rmxp {
  * 在以下注释中，Bitmap 和 SDL 的纹理代表的是同一个概念。
  */
 
+/// @brief 渲染线程中各个 Bitmap 内容的版本
+/// 创建或修改 Bitmap 的任务都会更新对应的版本，依赖 Bitmap 内容的缓存
+/// （如 plane_tiles）通过比较版本判断是否失效。版本取自全局递增的序号，
+/// 即使 Bitmap 被释放后 id 被重新使用，版本也不会重复。
+struct bitmap_versions {
+  /// @brief 每个 Bitmap 的 id 对应的版本
+  std::unordered_map<uint64_t, uint64_t> m_data;
+
+  /// @brief 全局递增的序号
+  uint64_t counter = 0;
+
+  /// @brief 标记 Bitmap 的内容已改变
+  void touch(uint64_t id) { m_data[id] = ++counter; }
+
+  /// @brief 获取 Bitmap 的版本
+  [[nodiscard]] uint64_t get(uint64_t id) const {
+    auto it = m_data.find(id);
+    return it == m_data.end() ? 0 : it->second;
+  }
+};
+
+/// @brief 数据类 bitmap_versions 相关的初始化类
+struct init_bitmap_versions {
+  using data = std::tuple<bitmap_versions>;
+};
+
 /// @brief 创建 Bitmap 的任务，有多种不同的特化方式。
 /// @tparam size_t 创建方式
 /// @see ./src/base/textures.hpp
@@ -73,9 +100,10 @@ struct bitmap_create<1> {
     renderer.render(texture, cen::ipoint(0, 0));
 
     RGMDATA(base::textures).emplace(id, std::move(bitmap));
+    RGMDATA(bitmap_versions).touch(id);
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -103,9 +131,10 @@ struct bitmap_create<2> {
     cen::texture bitmap = stack.make_empty_texture(width, height);
 
     RGMDATA(base::textures).emplace(id, std::move(bitmap));
+    RGMDATA(bitmap_versions).touch(id);
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -148,9 +177,10 @@ struct bitmap_create<3> {
     renderer.render(texture, cen::ipoint(0, 0));
 
     RGMDATA(base::textures).emplace(id, std::move(bitmap));
+    RGMDATA(bitmap_versions).touch(id);
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -167,6 +197,7 @@ struct bitmap_dispose {
     if (id % base::counter::increament != 0) return;
 
     RGMDATA(base::textures).erase(id);
+    RGMDATA(bitmap_versions).m_data.erase(id);
 
     /* 释放其他关联的 Bitmap，id + 1 是自动元件 */
     RGMDATA(base::textures).erase(id + 1);
@@ -201,6 +232,7 @@ struct bitmap_blt {
     base::renderstack& stack = RGMDATA(base::renderstack);
 
     cen::texture& bitmap = RGMDATA(base::textures).at(id);
+    RGMDATA(bitmap_versions).touch(id);
     cen::texture& src_bitmap = RGMDATA(base::textures).at(src_id);
 
     const cen::irect src_rect(r.x, r.y, r.width, r.height);
@@ -213,7 +245,7 @@ struct bitmap_blt {
     renderer.render(src_bitmap, src_rect, dst_rect);
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -242,6 +274,7 @@ struct bitmap_stretch_blt {
     base::renderstack& stack = RGMDATA(base::renderstack);
 
     cen::texture& bitmap = RGMDATA(base::textures).at(id);
+    RGMDATA(bitmap_versions).touch(id);
     cen::texture& src_bitmap = RGMDATA(base::textures).at(src_id);
 
     const cen::irect src_rect(src_r.x, src_r.y, src_r.width, src_r.height);
@@ -253,7 +286,7 @@ struct bitmap_stretch_blt {
     renderer.render(src_bitmap, src_rect, dst_rect);
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -275,6 +308,7 @@ struct bitmap_fill_rect {
     base::renderstack& stack = RGMDATA(base::renderstack);
 
     cen::texture& bitmap = RGMDATA(base::textures).at(id);
+    RGMDATA(bitmap_versions).touch(id);
 
     renderer.set_target(bitmap);
 
@@ -284,7 +318,7 @@ struct bitmap_fill_rect {
     renderer.fill_rect(cen::irect(r.x, r.y, r.width, r.height));
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -294,6 +328,7 @@ struct bitmap_fill_rect {
 /// 此模板任务会调用 T_shader 修改 Bitmap 中所有的像素。
 /// 使用方法见 bitmap_hue_change 和 bitmap_grayscale。
 /// 此模板任务不在 Graphics.update 中被自动调用，而是立即生效。
+/// software 渲染器没有 shader，改为调用 software_effect 处理像素。
 /// @see ./src/shader/shader_base.hpp
 template <typename T_shader, typename... Args>
 struct bitmap_shader_helper {
@@ -303,6 +338,21 @@ struct bitmap_shader_helper {
     base::renderstack& stack = RGMDATA(base::renderstack);
 
     cen::texture& bitmap = RGMDATA(base::textures).at(bitmap_id);
+    RGMDATA(bitmap_versions).touch(bitmap_id);
+
+    if (config::driver == config::driver_type::software) {
+      using transform = software_effect::transform;
+
+      if constexpr (std::is_same_v<T_shader, shader_hue>) {
+        software_effect::apply(renderer, bitmap, transform::hue(args...));
+      } else {
+        software_effect::apply(renderer, bitmap, transform::gray());
+      }
+
+      /* 还原 target 为渲染栈的栈顶 */
+      stack.bind(stack.current());
+      return;
+    }
 
     /* 使用 base::renderstack::make_empty_texture 创建空白的 texture */
     cen::texture empty =
@@ -337,7 +387,7 @@ struct bitmap_shader_helper {
     }
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -419,6 +469,7 @@ struct bitmap_draw_text {
 
     cen::font& font = RGMDATA(font_manager<false>).get(font_id, font_size);
     cen::texture& bitmap = RGMDATA(base::textures).at(id);
+    RGMDATA(bitmap_versions).touch(id);
 
     /* 设置字体 */
     font.reset_style();
@@ -427,27 +478,35 @@ struct bitmap_draw_text {
     font.set_underlined(font_underlined);
     font.set_strikethrough(font_strikethrough);
 
-    /* 绘制文字，绘制的结果是一个 cen::surface */
-    std::unique_ptr<cen::surface> ptr;
-    if (font_solid) {
-      ptr = std::make_unique<cen::surface>(font.render_solid_utf8(
-          text.data(), cen::color(c.red, c.green, c.blue, c.alpha)));
-    } else {
-      ptr = std::make_unique<cen::surface>(font.render_blended_utf8(
-          text.data(), cen::color(c.red, c.green, c.blue, c.alpha)));
+    /*
+     * 下划线和删除线贯穿整行文字，无法拆分成单个字形，仍然整体绘制。
+     * 其他情况下从字形图集中逐个绘制，图集用完时也退回到整体绘制。
+     */
+    if (font_underlined || font_strikethrough ||
+        !render_glyphs(worker, font, bitmap)) {
+      render_text(worker, font, bitmap);
     }
-    if (!ptr) return;
 
-    cen::texture texture = renderer.make_texture(*ptr);
+    /* 还原字体对象 */
+    font.reset_style();
 
-    /* 根据对齐方式，设置文字绘制到 Bitmap 上的位置 */
+    /* 还原 target 为渲染栈的栈顶 */
+    stack.bind(stack.current());
+  }
+
+  /// @brief 根据文字的大小和对齐方式，计算文字绘制到 Bitmap 上的位置
+  /// @param text_width 文字的宽
+  /// @param text_height 文字的高
+  /// @return 返回 {源矩形, 目标矩形}，源矩形的左上角始终是 (0, 0)
+  [[nodiscard]] std::pair<cen::irect, cen::irect> fit(int text_width,
+                                                     int text_height) const {
     int x = r.x;
     int y = r.y;
     int width = r.width;
     int height = r.height;
 
-    int _width = ptr->width();
-    int _height = ptr->height();
+    int _width = text_width;
+    int _height = text_height;
 
     if (_height < height) {
       y += (height - _height) / 2;
@@ -476,37 +535,169 @@ struct bitmap_draw_text {
       _width = width * 5 / 3;
     }
 
+    return {cen::irect(0, 0, _width, _height),
+            cen::irect(x, y, width, height)};
+  }
+
+  /// @brief 将整行文字绘制成一个 texture，再绘制到 Bitmap 上
+  void render_text(auto& worker, cen::font& font, cen::texture& bitmap) {
+    cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
+
+    /* 绘制文字，绘制的结果是一个 cen::surface */
+    std::unique_ptr<cen::surface> ptr;
+    if (font_solid) {
+      ptr = std::make_unique<cen::surface>(font.render_solid_utf8(
+          text.data(), cen::color(c.red, c.green, c.blue, c.alpha)));
+    } else {
+      ptr = std::make_unique<cen::surface>(font.render_blended_utf8(
+          text.data(), cen::color(c.red, c.green, c.blue, c.alpha)));
+    }
+    if (!ptr) return;
+
+    cen::texture texture = renderer.make_texture(*ptr);
     texture.set_blend_mode(cen::blend_mode::blend);
 
+    /* 根据对齐方式，设置文字绘制到 Bitmap 上的位置 */
+    auto [src, dst] = fit(ptr->width(), ptr->height());
+
     renderer.set_target(bitmap);
-    renderer.render(texture, cen::irect(0, 0, _width, _height),
-                    cen::irect(x, y, width, height));
+    renderer.render(texture, src, dst);
+  }
 
-    /* 还原字体对象 */
-    font.reset_style();
+  /// @brief 从字形图集中逐个绘制字形到 Bitmap 上
+  /// @return 图集已满，无法缓存全部字形时返回 false，此时什么也不绘制
+  /// 字形的排列考虑了字距调整，缩放和裁剪的规则与 render_text 相同。
+  bool render_glyphs(auto& worker, cen::font& font, cen::texture& bitmap) {
+    cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
+    base::renderstack& stack = RGMDATA(base::renderstack);
+    glyph_cache& cache = RGMDATA(glyph_cache);
 
-    /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    int style = (font_bold ? 1 : 0) | (font_italic ? 2 : 0) |
+                (font_solid ? 4 : 0);
+    glyph_atlas& atlas = cache.atlas(font_id, font_size, style);
+
+    /* 排版，计算每个字形在整行文字中的横坐标 */
+    std::vector<std::pair<const glyph*, int>>& line = cache.line;
+    line.clear();
+
+    int pen = 0;
+    int left = 0;
+    int right = 0;
+    int text_height = TTF_FontHeight(font.get());
+    uint32_t prev = 0;
+
+    for (size_t i = 0; i < text.size();) {
+      uint32_t ch = glyph_cache::next_codepoint(text, i);
+      if (ch == 0) break;
+
+      if (prev != 0) {
+        pen += TTF_GetFontKerningSizeGlyphs32(font.get(), prev, ch);
+      }
+      prev = ch;
+
+      const glyph* g = cache.get(atlas, font, ch, font_solid, renderer, stack);
+      if (!g) {
+        /* 图集已经用完，清空后让这一次绘制整体进行 */
+        atlas.clear();
+        return false;
+      }
+
+      int gx = pen + g->offset;
+      line.emplace_back(g, gx);
+
+      left = std::min(left, gx);
+      right = std::max(right, gx + g->rect.width());
+      text_height = std::max(text_height, g->rect.height());
+      pen += g->advance;
+    }
+    if (right - left <= 0) return true;
+
+    /* 根据对齐方式，设置文字绘制到 Bitmap 上的位置 */
+    auto [src, dst] = fit(right - left, text_height);
+    if (src.width() <= 0 || src.height() <= 0) return true;
+
+    float scale = static_cast<float>(dst.width()) / src.width();
+
+    /* 所有图集页都设置为文字的颜色 */
+    for (cen::texture& page : atlas.pages) {
+      page.set_color_mod(cen::color(c.red, c.green, c.blue));
+      page.set_alpha_mod(c.alpha);
+    }
+
+    renderer.set_target(bitmap);
+    for (auto [g, gx] : line) {
+      gx -= left;
+
+      /* 将字形裁剪到源矩形的范围内 */
+      int x0 = std::max(gx, 0);
+      int x1 = std::min(gx + g->rect.width(), src.width());
+      int h = std::min(g->rect.height(), src.height());
+      if (x1 <= x0 || h <= 0) continue;
+
+      cen::irect from(g->rect.x() + x0 - gx, g->rect.y(), x1 - x0, h);
+      cen::frect to(dst.x() + x0 * scale, static_cast<float>(dst.y()),
+                    (x1 - x0) * scale, static_cast<float>(h));
+
+      renderer.render(atlas.pages[g->page], from, to);
+    }
+    return true;
+  }
+};
+
+/// @brief Bitmap 在内存中的副本，用于 get_pixel 等读取操作
+/// Bitmap 的像素只在第一次读取时从 GPU 整体读回，之后直接读取此副本。
+/// ruby 线程每次发送修改 Bitmap 的任务时，递增 version 使副本失效；
+/// 渲染线程读回像素后，将对应的 version 写入 ready。
+/// 只有 ready == version 时 ruby 线程才会读取 pixels，此时渲染线程不会写入。
+struct bitmap_shadow {
+  /// @brief bgra 格式的像素数据
+  std::vector<uint8_t> pixels;
+
+  /// @brief Bitmap 的宽和高
+  int width = 0;
+  int height = 0;
+
+  /// @brief 已经读回的版本，由渲染线程写入
+  std::atomic<uint64_t> ready = 0;
+
+  /// @brief 当前的版本，只在 ruby 线程中读写
+  uint64_t version = 1;
+
+  /// @brief 已经请求读回的版本，只在 ruby 线程中读写
+  uint64_t requested = 0;
+
+  /// @brief 副本是否与 Bitmap 一致
+  [[nodiscard]] bool valid() const {
+    return ready.load(std::memory_order_acquire) == version;
+  }
+
+  /// @brief 读取像素，转换成 RGSS 使用的 rgba 格式，超出范围时返回 0
+  [[nodiscard]] uint32_t get(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width || y >= height) return 0;
+
+    const uint8_t* p = pixels.data() + (static_cast<size_t>(y) * width + x) * 4;
+    return (p[3] << 24) + (p[2]) + (p[1] << 8) + (p[0] << 16);
   }
 };
 
-/// @brief 获取指定位置的像素值
-/// 对应于 RGSS 中的 Bitmap#get_pixel，这是一个同步函数。
-/// 这个方法通常会非常慢，不建议经常使用，请使用 Palette 类替代
+/// @brief 所有 Bitmap 的内存副本，只在 ruby 线程中访问
+/// 使用 shared_ptr 是因为 Bitmap 释放时，渲染线程可能还在写入副本。
+using bitmap_shadows =
+    std::unordered_map<uint64_t, std::shared_ptr<bitmap_shadow>>;
+
+/// @brief 将 Bitmap 的全部像素读回到内存中的副本
+/// 对应于 RGSS 中的 Bitmap#get_pixel，以及新增的 get_pixels 和 readback_async。
 /// 目前 opengl 和 direct3d9 测试通过，但 d3d11 仍然存在问题。
 /// 参见：https://github.com/libsdl-org/SDL/issues/4782
-struct bitmap_get_pixel {
+struct bitmap_readback {
   /// @brief Bitmap 的 ID
   uint64_t id;
 
-  /// @brief 像素点的 X 坐标
-  int x;
+  /// @brief 内存中的副本
+  std::shared_ptr<bitmap_shadow> shadow;
 
-  /// @brief 像素点的 Y 坐标
-  int y;
-
-  /// @brief 用来存储 Pixels 的指针
-  uint8_t* p_pixel;
+  /// @brief 请求读回时副本的版本
+  uint64_t version;
 
   void run(auto& worker) {
     cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
@@ -514,15 +705,21 @@ struct bitmap_get_pixel {
 
     cen::texture& bitmap = RGMDATA(base::textures).at(id);
 
+    shadow->width = bitmap.width();
+    shadow->height = bitmap.height();
+    shadow->pixels.resize(static_cast<size_t>(shadow->width) *
+                          shadow->height * 4);
+
+    /* 一次性获取全部的像素值 */
     renderer.set_target(bitmap);
-    /* 一次性可以获取目标矩形里的全部像素值，但是这里矩形的长和宽都是 1 */
-    SDL_Rect rect{x, y, 1, 1};
-    SDL_RenderReadPixels(renderer.get(), &rect,
-                         static_cast<uint32_t>(config::texture_format), p_pixel,
-                         bitmap.width() * 4);
+    SDL_RenderReadPixels(renderer.get(), nullptr,
+                         static_cast<uint32_t>(config::texture_format),
+                         shadow->pixels.data(), shadow->width * 4);
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
+
+    shadow->ready.store(version, std::memory_order_release);
   }
 };
 
@@ -564,7 +761,7 @@ struct bitmap_save_png {
     renderer.capture(config::texture_format).save_as_png(path.data());
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -592,6 +789,7 @@ struct bitmap_capture_screen {
     }
 
     cen::texture& bitmap = RGMDATA(base::textures).at(id);
+    RGMDATA(bitmap_versions).touch(id);
 
     /* 注意这里是 stack.current()，也就是上一帧绘制的内容 */
     renderer.set_target(bitmap);
@@ -602,7 +800,7 @@ struct bitmap_capture_screen {
         cen::irect{0, 0, bitmap.width(), bitmap.height()});
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -620,6 +818,7 @@ struct bitmap_capture_palette {
     base::renderstack& stack = RGMDATA(base::renderstack);
 
     cen::texture& bitmap = RGMDATA(base::textures).at(id);
+    RGMDATA(bitmap_versions).touch(id);
 
     cen::texture texture = renderer.make_texture(*ptr);
 
@@ -628,7 +827,7 @@ struct bitmap_capture_palette {
     renderer.render(texture, cen::ipoint(0, 0));
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -669,6 +868,8 @@ struct bitmap_make_autotile {
 
     /* 移除已经存在的自动元件，重新绘制 */
     textures.erase(id + 1);
+    /* tilemap 的区块缓存据此判断自动元件是否变化 */
+    RGMDATA(bitmap_versions).touch(id + 1);
 
     /* 如果自动元件的格式不正确，则补全成正确的格式 */
     int height = source.height();
@@ -699,7 +900,7 @@ struct bitmap_make_autotile {
       /* 将 autotile 存储到 id + 1 的位置 */
       textures.emplace(id + 1, std::move(temp));
       /* 还原 target 为渲染栈的栈顶 */
-      renderer.set_target(stack.current());
+      stack.bind(stack.current());
       return;
     }
 
@@ -734,7 +935,7 @@ struct bitmap_make_autotile {
     textures.emplace(id + 1, std::move(autotile));
 
     /* 还原 target 为渲染栈的栈顶 */
-    renderer.set_target(stack.current());
+    stack.bind(stack.current());
   }
 };
 
@@ -756,12 +957,77 @@ struct bitmap_reload_autotile {
 
 /// @brief Ruby 中 Bitmap 类的初始化类，定义了大量的操作函数。
 struct init_bitmap {
+  using data = std::tuple<bitmap_shadows>;
+
   static void before(auto& this_worker) {
     /* 静态的 worker 变量供函数的内部类 wrapper 使用 */
     static decltype(auto) worker = this_worker;
 
     /* wrapper 类，创建静态方法供 ruby 的模块绑定 */
     struct wrapper {
+      /* 修改 Bitmap 之前调用，使内存中的副本失效 */
+      static void invalidate(uint64_t id) {
+        bitmap_shadows& shadows = RGMDATA(bitmap_shadows);
+
+        auto it = shadows.find(id);
+        if (it != shadows.end()) ++it->second->version;
+      }
+
+      /* 获取 Bitmap 的内存副本，如果已经失效，则请求读回 */
+      /* wait 为 true 时等待读回完成，否则立即返回 */
+      static bitmap_shadow& readback(uint64_t id, bool wait) {
+        auto& ptr = RGMDATA(bitmap_shadows)[id];
+        if (!ptr) ptr = std::make_shared<bitmap_shadow>();
+
+        bitmap_shadow& shadow = *ptr;
+        if (shadow.valid()) return shadow;
+
+        if (shadow.requested != shadow.version) {
+          shadow.requested = shadow.version;
+          worker >> bitmap_readback{id, ptr, shadow.version};
+        }
+        if (wait) RGMWAIT(1);
+
+        return shadow;
+      }
+
+      /* ruby method: Bitmap#dispose -> bitmap_dispose */
+      static VALUE dispose(VALUE, VALUE id_) {
+        RGMLOAD(id, uint64_t);
+
+        RGMDATA(bitmap_shadows).erase(id);
+        worker >> bitmap_dispose{id};
+        return Qnil;
+      }
+
+      /* ruby method: Bitmap#hue_change -> bitmap_hue_change */
+      static VALUE hue_change(VALUE, VALUE id_, VALUE hue_) {
+        RGMLOAD(id, uint64_t);
+        RGMLOAD(hue, int);
+
+        invalidate(id);
+        worker >> bitmap_hue_change{id, hue};
+        return Qnil;
+      }
+
+      /* ruby method: Bitmap#grayscale -> bitmap_grayscale */
+      static VALUE grayscale(VALUE, VALUE id_) {
+        RGMLOAD(id, uint64_t);
+
+        invalidate(id);
+        worker >> bitmap_grayscale{id};
+        return Qnil;
+      }
+
+      /* ruby method: Bitmap#capture_screen -> bitmap_capture_screen */
+      static VALUE capture_screen(VALUE, VALUE id_) {
+        RGMLOAD(id, uint64_t);
+
+        invalidate(id);
+        worker >> bitmap_capture_screen{id};
+        return Qnil;
+      }
+
       /* ruby method: Bitmap#new -> bitmap_create */
       static VALUE create(VALUE, VALUE id_, VALUE width_, VALUE height_) {
         RGMLOAD(id, uint64_t);
@@ -797,6 +1063,7 @@ struct init_bitmap {
         rect r;
         r << rect_;
 
+        invalidate(id);
         worker >> bitmap_blt{r, id, src_id, x, y, opacity};
         return Qnil;
       }
@@ -813,6 +1080,7 @@ struct init_bitmap {
         rect src_r;
         src_r << src_rect_;
 
+        invalidate(id);
         worker >> bitmap_stretch_blt{dst_r, src_r, id, src_id, opacity};
         return Qnil;
       }
@@ -826,6 +1094,7 @@ struct init_bitmap {
         color c;
         c << color_;
 
+        invalidate(id);
         worker >> bitmap_fill_rect{r, id, c};
         return Qnil;
       }
@@ -877,6 +1146,7 @@ struct init_bitmap {
         bool font_strikethrough = detail::get<word::strikethrough, bool>(font_);
         bool font_solid = detail::get<word::solid, bool>(font_);
 
+        invalidate(id);
         worker >> bitmap_draw_text{r,
                                    id,
                                    text,
@@ -892,24 +1162,40 @@ struct init_bitmap {
         return Qnil;
       }
 
-      /* ruby method: Bitmap#get_pixel -> bitmap_get_pixel */
+      /* ruby method: Bitmap#get_pixel -> bitmap_readback */
       static VALUE get_pixel(VALUE, VALUE id_, VALUE x_, VALUE y_) {
         RGMLOAD(id, uint64_t);
         RGMLOAD(x, int);
         RGMLOAD(y, int);
 
-        std::array<uint8_t, 4> pixels{};
-        worker >> bitmap_get_pixel{id, x, y, pixels.data()};
+        /* 转换后的值可能超出了 FIXNUM 的范围，故使用 UINT2NUM 宏。 */
+        return UINT2NUM(readback(id, true).get(x, y));
+      }
+
+      /* ruby method: Bitmap#get_pixels -> bitmap_readback */
+      static VALUE get_pixels(VALUE, VALUE id_, VALUE rect_) {
+        RGMLOAD(id, uint64_t);
 
-        RGMWAIT(1);
+        rect r;
+        r << rect_;
+
+        const bitmap_shadow& shadow = readback(id, true);
+
+        /* 按行依次返回区域内的像素，格式与 get_pixel 相同 */
+        VALUE array = rb_ary_new_capa(std::max(r.width * r.height, 0));
+        for (int y = r.y; y < r.y + r.height; ++y) {
+          for (int x = r.x; x < r.x + r.width; ++x) {
+            rb_ary_push(array, UINT2NUM(shadow.get(x, y)));
+          }
+        }
+        return array;
+      }
+
+      /* ruby method: Bitmap#readback_async -> bitmap_readback */
+      static VALUE readback_async(VALUE, VALUE id_) {
+        RGMLOAD(id, uint64_t);
 
-        /*
-         * 获取的 pixels 是 bgra 格式，此处转换成 rgba 格式以适配 RGSS。
-         * 转换后的值可能超出了 FIXNUM 的范围，故使用 UINT2NUM 宏。
-         */
-        uint32_t color = (pixels[3] << 24) + (pixels[2]) + (pixels[1] << 8) +
-                         (pixels[0] << 16);
-        return UINT2NUM(color);
+        return readback(id, false).valid() ? Qtrue : Qfalse;
       }
     };
 
@@ -928,12 +1214,20 @@ struct init_bitmap {
                               wrapper::text_size, 2);
     rb_define_module_function(rb_mRGM_Base, "bitmap_get_pixel",
                               wrapper::get_pixel, 3);
+    rb_define_module_function(rb_mRGM_Base, "bitmap_get_pixels",
+                              wrapper::get_pixels, 2);
+    rb_define_module_function(rb_mRGM_Base, "bitmap_readback_async",
+                              wrapper::readback_async, 1);
+    rb_define_module_function(rb_mRGM_Base, "bitmap_dispose", wrapper::dispose,
+                              1);
+    rb_define_module_function(rb_mRGM_Base, "bitmap_hue_change",
+                              wrapper::hue_change, 2);
+    rb_define_module_function(rb_mRGM_Base, "bitmap_grayscale",
+                              wrapper::grayscale, 1);
+    rb_define_module_function(rb_mRGM_Base, "bitmap_capture_screen",
+                              wrapper::capture_screen, 1);
 
-    RGMBIND(rb_mRGM_Base, "bitmap_dispose", bitmap_dispose, 1);
-    RGMBIND(rb_mRGM_Base, "bitmap_hue_change", bitmap_hue_change, 2);
-    RGMBIND(rb_mRGM_Base, "bitmap_grayscale", bitmap_grayscale, 1);
     RGMBIND(rb_mRGM_Base, "bitmap_save_png", bitmap_save_png, 2);
-    RGMBIND(rb_mRGM_Base, "bitmap_capture_screen", bitmap_capture_screen, 1);
     RGMBIND(rb_mRGM_Base, "bitmap_reload_autotile", bitmap_reload_autotile, 1);
   }
 };
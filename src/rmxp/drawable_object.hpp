@@ -64,6 +64,8 @@ namespace rgm::rmxp {
 /// 2. @visible 在绘制的每帧都需要查询，没有保存的必要；
 /// 3. @disposed 对应 Drawable 是否存在，当 ruby 中对应的对象 dispose 时，C++
 ///    层的对象会随之销毁。所以只要对象存在，该值始终是 true，没有保存的必要。
+/// 对象类型的属性（Color、Tone 和 Rect）被修改时，ruby 层会通过 touch_object
+/// 设置 object_dirty，绘制前只刷新 object_dirty 为 true 的对象。
 
 /* viewport 类的声明 */
 struct viewport;
@@ -80,6 +82,9 @@ struct drawable_object {
   /// 禁止修改 Drawable 绑定的 Viewport
   viewport* p_viewport = nullptr;
 
+  /// @brief 对象类型的属性是否发生了变化，需要在绘制前重新读取
+  bool object_dirty = true;
+
   /// @brief 读取 ruby 对象中各个实例变量，更新自身的成员变量
   /// @param object 目标 ruby 对象，通常是任意的 Drawable 类型
   /// @return T_Drawable& 返回对自身的引用
@@ -134,6 +139,7 @@ struct drawable_object {
     T_Drawable& item = *static_cast<T_Drawable*>(this);
 
     ITERATE_OBJECTS(DO_REFRESH_OBJECT);
+    object_dirty = false;
   }
 
   /// @brief 更新特定名称的值类型的属性所对应的成员变量。
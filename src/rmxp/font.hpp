@@ -69,11 +69,188 @@ struct font_manager {
   }
 };
 
+/// @brief 图集中缓存的单个字形
+struct glyph {
+  /// @brief 字形所在的图集页
+  int page;
+
+  /// @brief 字形在图集页中的位置，不可见的字形（如空格）大小为 0
+  cen::irect rect;
+
+  /// @brief 字形相对于笔触位置的水平偏移，通常为 0 或负数
+  int offset;
+
+  /// @brief 绘制完此字形后笔触前进的距离
+  int advance;
+};
+
+/// @brief 字形图集，缓存同一字体、字号和风格下的所有字形
+/// 字形以白色绘制在若干张 page_size x page_size 的 texture 上，逐行排列。
+/// 绘制文字时使用 color_mod 和 alpha_mod 设置文字的颜色。
+struct glyph_atlas {
+  /// @brief 图集页的边长
+  static constexpr int page_size = 512;
+
+  /// @brief 图集页的数量上限，超过后整个图集会被清空
+  static constexpr int max_pages = 4;
+
+  /// @brief 所有的图集页
+  std::vector<cen::texture> pages;
+
+  /// @brief Unicode 码点 => 字形
+  std::unordered_map<uint32_t, glyph> glyphs;
+
+  /// @brief 当前行的下一个空位的坐标，以及当前行的高度
+  int cursor_x = 0;
+  int cursor_y = 0;
+  int row_height = 0;
+
+  /// @brief 为 width x height 大小的字形分配位置
+  /// @param stack 用于创建新的图集页
+  /// @param g 分配成功时写入 g.page 和 g.rect
+  /// @return 成功返回 true，图集页已经用完时返回 false
+  bool allocate(base::renderstack& stack, int width, int height, glyph& g) {
+    if (width > page_size || height > page_size) return false;
+
+    /* 当前行放不下则换行，当前页放不下则换页 */
+    if (cursor_x + width > page_size) {
+      cursor_x = 0;
+      cursor_y += row_height;
+      row_height = 0;
+    }
+    if (pages.empty() || cursor_y + height > page_size) {
+      if (static_cast<int>(pages.size()) == max_pages) return false;
+
+      pages.push_back(stack.make_empty_texture(page_size, page_size));
+      pages.back().set_blend_mode(cen::blend_mode::blend);
+      cursor_x = 0;
+      cursor_y = 0;
+      row_height = 0;
+    }
+
+    g.page = static_cast<int>(pages.size()) - 1;
+    g.rect = cen::irect(cursor_x, cursor_y, width, height);
+
+    cursor_x += width;
+    row_height = std::max(row_height, height);
+    return true;
+  }
+
+  /// @brief 清空图集，保留已经创建的图集页以便复用
+  void clear() {
+    glyphs.clear();
+    cursor_x = 0;
+    cursor_y = 0;
+    row_height = 0;
+
+    /* 先退回到第 1 页，allocate 在换页时会重新创建后面的页 */
+    if (pages.size() > 1) pages.resize(1);
+  }
+};
+
+/// @brief 渲染线程中管理所有字形图集的数据类
+/// 与 font_manager<false> 一同由 init_font<false> 引入。
+struct glyph_cache {
+  /// @brief {字体ID, 字号, 风格} => 字形图集
+  /// 风格的第 0 位表示加粗，第 1 位表示斜体，第 2 位表示 solid。
+  std::map<std::tuple<int, int, int>, glyph_atlas> atlases;
+
+  /// @brief 排版时暂存一行文字中各个字形及其横坐标，避免反复分配内存
+  std::vector<std::pair<const glyph*, int>> line;
+
+  /// @brief 绘制时查询字形的命中和未命中次数
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+
+  /// @brief 获取对应的字形图集，不存在则创建
+  [[nodiscard]] glyph_atlas& atlas(int id, int font_size, int style) {
+    return atlases[{id, font_size, style}];
+  }
+
+  /// @brief 获取字形，未命中时将其光栅化并放入图集
+  /// @param atlas 字形所属的图集
+  /// @param font 已经设置好风格的字体
+  /// @param ch 字形的 Unicode 码点
+  /// @param solid 是否使用 solid 风格绘制
+  /// @return 返回字形的指针，图集已满时返回 nullptr
+  /// 此函数会修改 renderer 的 target，调用者需要自行还原。
+  const glyph* get(glyph_atlas& atlas, cen::font& font, uint32_t ch, bool solid,
+                   cen::renderer& renderer, base::renderstack& stack) {
+    auto it = atlas.glyphs.find(ch);
+    if (it != atlas.glyphs.end()) {
+      ++hits;
+      return &(it->second);
+    }
+    ++misses;
+
+    glyph g{0, cen::irect(0, 0, 0, 0), 0, 0};
+
+    int minx, maxx, miny, maxy;
+    if (TTF_GlyphMetrics32(font.get(), ch, &minx, &maxx, &miny, &maxy,
+                           &g.advance) == 0) {
+      g.offset = std::min(minx, 0);
+    }
+
+    /* 以白色绘制字形，零宽度的字形绘制会失败，视为大小为 0 的字形 */
+    const SDL_Color white{255, 255, 255, 255};
+    SDL_Surface* ptr = solid ? TTF_RenderGlyph32_Solid(font.get(), ch, white)
+                             : TTF_RenderGlyph32_Blended(font.get(), ch, white);
+
+    if (ptr) {
+      cen::surface surface(ptr);
+
+      if (!atlas.allocate(stack, surface.width(), surface.height(), g)) {
+        return nullptr;
+      }
+
+      /* 将字形原样复制到图集页上 */
+      cen::texture texture = renderer.make_texture(surface);
+      texture.set_blend_mode(cen::blend_mode::none);
+
+      renderer.set_target(atlas.pages[g.page]);
+      renderer.render(texture, g.rect);
+    }
+
+    return &(atlas.glyphs.emplace(ch, g).first->second);
+  }
+
+  /// @brief 从 UTF-8 字符串中读取下一个 Unicode 码点
+  /// @param text UTF-8 字符串
+  /// @param i 当前的读取位置，会前进到下一个码点的位置
+  /// @return 返回码点，遇到非法的编码时返回 U+FFFD
+  [[nodiscard]] static uint32_t next_codepoint(std::string_view text,
+                                               size_t& i) {
+    const auto byte = [&text](size_t n) -> uint32_t {
+      return static_cast<uint8_t>(text[n]);
+    };
+
+    uint32_t c = byte(i++);
+    if (c < 0x80) return c;
+
+    /* 根据首字节确定后续字节的数量 */
+    int extra = (c >= 0xf0) ? 3 : (c >= 0xe0) ? 2 : (c >= 0xc0) ? 1 : 0;
+    if (extra == 0 || i + extra > text.size()) return 0xfffd;
+
+    c &= (0x3f >> extra);
+    for (int k = 0; k < extra; ++k) {
+      uint32_t next = byte(i);
+      if ((next & 0xc0) != 0x80) return 0xfffd;
+
+      c = (c << 6) | (next & 0x3f);
+      ++i;
+    }
+    return c;
+  }
+};
+
 /// @brief 数据类 font_manager 相关的初始化类
 /// @tparam owner font_manager 的模板参数
+/// 渲染线程中还会引入数据类 glyph_cache。
 template <bool owner>
 struct init_font {
-  using data = std::tuple<font_manager<owner>>;
+  using data =
+      std::conditional_t<owner, std::tuple<font_manager<true>>,
+                         std::tuple<font_manager<false>, glyph_cache>>;
 
   static void before(auto& this_worker)
     requires(owner)
@@ -106,6 +283,11 @@ struct init_font {
   static void after(auto& worker) {
     /* cen::font 要提前释放，否则会导致 Segmentation fault */
     RGMDATA(font_manager<owner>).m_data.clear();
+
+    /* 图集页是 cen::texture，同样要在 renderer 之前释放 */
+    if constexpr (!owner) {
+      RGMDATA(glyph_cache).atlases.clear();
+    }
   }
 };
 }  // namespace rgm::rmxp
\ No newline at end of file
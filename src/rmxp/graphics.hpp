@@ -23,9 +23,13 @@
 #include "bitmap.hpp"
 #include "builtin.hpp"
 #include "render_base.hpp"
+#include "render_plane.hpp"
+#include "render_sprite.hpp"
 #include "render_tilemap.hpp"
 #include "render_transition.hpp"
 #include "render_viewport.hpp"
+#include "render_window.hpp"
+#include "snapshot.hpp"
 #include "table.hpp"
 
 namespace rgm::rmxp {
@@ -33,8 +37,102 @@ namespace rgm::rmxp {
 /// 起点和终点都在 graphics.update 中
 core::stopwatch graphics_timer("graphics");
 
+/// @brief 统计 Graphics.update 中对象类型属性的刷新情况
+/// 只有 object_dirty 为 true 的 Drawable 才会重新读取 ruby 中的实例变量，
+/// 上一帧的刷新数和跳过数可用于检查推送式同步的效果。
+/// 刷新数不等于读取实例变量的次数：每个 Drawable 在 skip 中都要读取
+/// @visible，tilemap 每帧都要刷新，刷新时 Color、Tone 和 Rect 还会读取
+/// 各自的实例变量。所以另外记录 Graphics.update 中 rb_ivar_get 的次数。
+struct object_refresher {
+  /// @brief 本帧刷新的对象数量，以及跳过刷新的对象数量
+  int refresh_count = 0;
+  int skip_count = 0;
+
+  /// @brief 本帧开始发送绘制任务时 detail::ivar_reads 的值
+  uint64_t read_base = 0;
+
+  /// @brief 上一帧的统计数据
+  int last_refresh_count = 0;
+  int last_skip_count = 0;
+  uint64_t last_read_count = 0;
+
+  /// @brief 开始发送本帧的绘制任务时调用，记录读取实例变量的起点
+  void begin() { read_base = detail::ivar_reads; }
+
+  /// @brief 如有必要，刷新 item 的对象类型的成员变量
+  /// @param item 继承自 drawable_object 的对象
+  /// @param force 为 true 时总是刷新，用于无法追踪修改的属性
+  void refresh(auto& item, bool force = false) {
+    if (!item.object_dirty && !force) {
+      ++skip_count;
+      return;
+    }
+    ++refresh_count;
+    item.refresh_object();
+  }
+
+  /// @brief 一帧结束时调用，保存统计数据并清零
+  void step() {
+    last_refresh_count = refresh_count;
+    last_skip_count = skip_count;
+    last_read_count = detail::ivar_reads - read_base;
+    refresh_count = 0;
+    skip_count = 0;
+  }
+};
+
+/// @brief 任务：读取渲染线程中各个缓存和上一帧的统计数据
+/// 这是一个同步的任务，调用者需要等待渲染线程执行完毕。
+/// 所有数据在一次任务中读取，只需要同步一次。
+struct render_stats {
+  /// @brief 统计数据，每一项的含义见 Graphics.render_stats
+  struct result {
+    /// @brief 窗口背景缓存的命中次数、未命中次数、缓存的数量，
+    /// 以及上一帧绘制 window 时调用 renderer.render 的次数
+    std::array<uint64_t, 4> window;
+
+    /// @brief plane 平铺缓存的命中次数、未命中次数和缓存的数量
+    std::array<uint64_t, 3> plane;
+
+    /// @brief 渲染目标缓存池的命中次数、未命中次数、淘汰次数和空闲的字节数
+    std::array<uint64_t, 4> pool;
+
+    /// @brief 上一帧直接绘制的 viewport 数量和复制到单独的层的数量
+    std::array<uint64_t, 2> viewport;
+
+    /// @brief 上一帧 shader 的程序切换、跳过的切换、上传 uniform、
+    /// 跳过的 uniform 和查询程序的次数，只统计 opengl 渲染器
+    std::array<uint64_t, 5> shader;
+
+    /// @brief 字形缓存的命中次数和未命中次数
+    std::array<uint64_t, 2> glyph;
+  };
+
+  result* p_result;
+
+  void run(auto& worker) {
+    window_skins& skins = RGMDATA(window_skins);
+    plane_tiles& tiles = RGMDATA(plane_tiles);
+    base::renderstack& stack = RGMDATA(base::renderstack);
+    glyph_cache& glyphs = RGMDATA(glyph_cache);
+
+    p_result->window = {skins.hits, skins.misses, skins.m_data.size(),
+                        skins.last_draw_calls};
+    p_result->plane = {tiles.hits, tiles.misses, tiles.m_data.size()};
+    p_result->pool = {stack.cache.hits, stack.cache.misses,
+                      stack.cache.evictions, stack.cache.bytes};
+    p_result->viewport = {static_cast<uint64_t>(stack.last_region_count),
+                          static_cast<uint64_t>(stack.last_capture_count)};
+    p_result->shader = shader::gl_state::last_counters;
+    p_result->glyph = {glyphs.hits, glyphs.misses};
+  }
+};
+
 /// @brief 画面渲染相关操作的初始化类
 struct init_graphics {
+  /* 引入数据类型 frame_pipeline、sprite_batcher 和 object_refresher */
+  using data = std::tuple<frame_pipeline, sprite_batcher, object_refresher>;
+
   static void before(auto& this_worker) {
     /* 静态的 worker 变量供函数的内部类 wrapper 使用 */
     static decltype(auto) worker = this_worker;
@@ -42,9 +140,15 @@ struct init_graphics {
     /* wrapper 类，创建静态方法供 ruby 的模块绑定 */
     struct wrapper {
       /* 尝试尽可能多地发送 render<overlayer<tilemap>> */
-      static void render_tilemap_overlayer(z_index zi, size_t depth = 0) {
+      static void render_tilemap_overlayer(
+          z_index zi, size_t depth = 0, frame_snapshot* p_snapshot = nullptr) {
         tilemap_manager& tm = RGMDATA(tilemap_manager);
+        sprite_batcher& batcher = RGMDATA(sprite_batcher);
         tables* p_tables = &(RGMDATA(tables));
+
+        /* 流水线模式下，使用快照中的 table */
+        if (p_snapshot) p_tables = &(p_snapshot->table_copies);
+
         /*
          * 如果即将绘制的内容不是tilemap，尽可能地发送 overlayer<tilemap>
          * 的绘制任务。
@@ -56,9 +160,13 @@ struct init_graphics {
 
           auto [p_info, index] = opt.value();
 
-          if (!p_info->p_tilemap->skip()) {
-            worker >> render<overlayer<tilemap>>{p_info, p_tables, index};
-          }
+          if (p_info->p_tilemap->skip()) continue;
+
+          /* 流水线模式下，使用快照中的 tilemap_info */
+          if (p_snapshot) p_info = &(p_snapshot->infos.at(p_info->tilemap_id));
+
+          batcher.flush(worker);
+          worker >> render<overlayer<tilemap>>{p_info, p_tables, index};
         }
       }
 
@@ -66,23 +174,73 @@ struct init_graphics {
       static VALUE update(VALUE) {
         tables* p_tables = &(RGMDATA(tables));
         tilemap_manager& tm = RGMDATA(tilemap_manager);
+        sprite_batcher& batcher = RGMDATA(sprite_batcher);
+        object_refresher& refresher = RGMDATA(object_refresher);
+
+        /* 无窗口模式下，记录本帧执行 ruby 脚本的时间 */
+        base::benchmark_recorder.logic_end();
+
+        /*
+         * 流水线模式下，绘制任务只引用快照中的数据，这一帧不必等待渲染线程
+         * 绘制完成。只有渲染线程落后超过 1 帧，快照仍在使用时才会阻塞。
+         */
+        frame_snapshot* p_snapshot = nullptr;
+        if constexpr (std::remove_cvref_t<decltype(worker)>::is_asynchronized) {
+          if (config::pipelined) {
+            p_snapshot = &(RGMDATA(frame_pipeline).next());
+
+            if (p_snapshot->pending) {
+              if (!worker.is_stopped()) p_snapshot->pause.acquire();
+              p_snapshot->pending = false;
+            }
+
+            /* 将此快照记录的绘制调用次数写回 tilemap_info */
+            p_snapshot->clear();
+            for (auto& [id, info] : p_snapshot->infos) {
+              auto it = tm.infos.find(id);
+              if (it != tm.infos.end()) it->second.draw_calls = info.draw_calls;
+            }
+          }
+        }
+
+        /*
+         * 上上帧的绘制任务都已经执行完毕，此时重置内存池中它们使用的一代。
+         * 停止时渲染线程可能仍在执行任务，不作处理。
+         */
+        if (!worker.is_stopped()) worker.arena.step();
+
+        /* 返回实际交给渲染线程的数据，流水线模式下为快照中的副本 */
+        auto target = [p_snapshot]<typename T>(T& item) -> T& {
+          if (p_snapshot) return p_snapshot->copy(item);
+          return item;
+        };
 
         /* 跳过绘制的 lambda */
         auto visitor_skip = [](auto& item) -> bool { return item.skip(); };
 
         /* 发送绘制任务的 lambda */
-        auto visitor_render = [p_tables, &tm]<typename T>(T& item) {
+        auto visitor_render = [p_tables, p_snapshot, &tm, &batcher, &refresher,
+                               &target]<typename T>(T& item) {
           /* 不在这里处理 viewport */
           if constexpr (std::is_same_v<T, viewport>) return;
 
           /*
            * 刷新对象类型的成员变量对应的数据。只有以 CRTP 形式继承自
            * drawable_object 的对象是数据的拥有者，才会触发刷新。
+           * tilemap 的 @autotiles 是 Array，修改其元素无法通知 C++ 层，
+           * 所以 tilemap 每帧都要刷新。
            */
           if constexpr (std::is_base_of_v<drawable_object<T>, T>) {
-            item.refresh_object();
+            refresher.refresh(item, std::is_same_v<T, tilemap>);
           }
 
+          /* sprite 交给 batcher 合批，其他绘制任务发送前要先发送之前的批 */
+          if constexpr (std::is_same_v<T, sprite>) {
+            batcher.push(worker, &target(item));
+            return;
+          }
+          batcher.flush(worker);
+
           if constexpr (std::is_same_v<T, tilemap>) {
             /*
              * 如果是 tilemap，则还需要判断 autotiles 是否发生了变化，
@@ -92,16 +250,25 @@ struct init_graphics {
                 [](auto id) { worker >> bitmap_make_autotile{id}; };
 
             /* 向 tilemap_info 中添加当前的 tilemap */
-            tilemap_info& info = tm.insert(item);
+            tilemap_info* p_info = &(tm.insert(item));
+            tilemap* p_tilemap = &item;
+            tables* p_data = p_tables;
+
+            /* 流水线模式下，复制 tilemap、tilemap_info 及其用到的 table */
+            if (p_snapshot) {
+              p_tilemap = &(p_snapshot->copy(item));
+              p_info = &(p_snapshot->copy(*p_info, *p_tilemap, tm));
+              p_data = &(p_snapshot->table_copies);
+            }
 
             /* 设置 tilemap_info 的 autotiles */
-            worker >> tilemap_set_info{&item, &info};
+            worker >> tilemap_set_info{p_tilemap, p_info};
 
             /* 设置 layer_index = 0，发送 render<overlayer<tilemap>> */
-            worker >> render<overlayer<tilemap>>{&info, p_tables, 0};
+            worker >> render<overlayer<tilemap>>{p_info, p_data, 0};
           } else {
             /* 发送 render<T> */
-            worker >> render<T>{&item};
+            worker >> render<T>{&target(item)};
           }
         };
 
@@ -109,63 +276,109 @@ struct init_graphics {
         graphics_timer.step(4);
         graphics_timer.start();
 
-        /* 处理当前积压的事件 */
-        worker >> base::poll_event{};
+        /*
+         * 发送本帧的绘制任务。刷新对象时会读取 ruby 的实例变量，可能抛出
+         * 异常，而 ruby 的异常通过 longjmp 跳转，会跳过 batch 的析构，使
+         * 当前线程一直处于批量发送的状态。所以在 rb_protect 中发送，离开
+         * 批量发送的作用域之后再重新抛出异常。
+         */
+        auto send_tasks = [&] {
+          refresher.begin();
 
-        /* 绘制开始，计时阶段 1 */
-        graphics_timer.step(1);
+          /* 处理当前积压的事件 */
+          worker >> base::poll_event{};
 
-        /* 清空屏幕 */
-        worker >> base::clear_screen{};
+          /* 绘制开始，计时阶段 1 */
+          graphics_timer.step(1);
 
-        /* 设置 default_viewport */
-        worker >> setup_default_viewport{&default_viewport};
+          /* 清空屏幕 */
+          worker >> base::clear_screen{};
+          worker >> shader::shader_step{};
+          worker >> window_skins_step{};
 
-        /* 遍历 drawables，如果是 Viewport，则再遍历一层 */
-        drawables& data = RGMDATA(drawables);
-        for (auto& [zi, item] : data.m_data) {
-          /* 跳过绘制的场合就进入下一个 item */
-          if (std::visit(visitor_skip, item)) continue;
+          /* 设置 default_viewport */
+          worker >> setup_default_viewport{&default_viewport};
 
-          /* 尝试插入 tilemap 的 overlayer */
-          render_tilemap_overlayer(zi);
+          /* 遍历 drawables，如果是 Viewport，则再遍历一层 */
+          drawables& data = RGMDATA(drawables);
+          for (auto& [zi, item] : data.m_data) {
+            /* 跳过绘制的场合就进入下一个 item */
+            if (std::visit(visitor_skip, item)) continue;
 
-          /* 非 viewport 的情况，发送 render 任务 */
-          if (!std::holds_alternative<viewport>(item)) {
-            std::visit(visitor_render, item);
-            continue;
-          }
+            /* 尝试插入 tilemap 的 overlayer */
+            render_tilemap_overlayer(zi, 0, p_snapshot);
 
-          /* 刷新 viewport 的对象类型的成员变量对应的数据 */
-          viewport& v = std::get<viewport>(item);
-          v.refresh_object();
+            /* 非 viewport 的情况，发送 render 任务 */
+            if (!std::holds_alternative<viewport>(item)) {
+              std::visit(visitor_render, item);
+              continue;
+            }
 
-          /* viewport 的前处理 */
-          worker >> before_render_viewport{&v};
+            /* 刷新 viewport 的对象类型的成员变量对应的数据 */
+            viewport& v = std::get<viewport>(item);
+            refresher.refresh(v);
 
-          /* 遍历 viewport 中的 drawables */
-          for (auto& [sub_zi, sub_item] : v.p_drawables->m_data) {
-            if (std::visit(visitor_skip, sub_item)) continue;
-            render_tilemap_overlayer(sub_zi, 1);
+            /* viewport 的前处理 */
+            const viewport* p_viewport = &target(v);
+            batcher.flush(worker);
+            worker >> before_render_viewport{p_viewport};
 
-            std::visit(visitor_render, sub_item);
+            /* 遍历 viewport 中的 drawables */
+            for (auto& [sub_zi, sub_item] : v.p_drawables->m_data) {
+              if (std::visit(visitor_skip, sub_item)) continue;
+              render_tilemap_overlayer(sub_zi, 1, p_snapshot);
+
+              std::visit(visitor_render, sub_item);
+            }
+
+            /* 尝试插入 tilemap 的 overlayer */
+            render_tilemap_overlayer(z_index{INT32_MAX, 0}, 1, p_snapshot);
+
+            /* viewport 的后处理 */
+            batcher.flush(worker);
+            worker >> after_render_viewport{p_viewport};
           }
 
           /* 尝试插入 tilemap 的 overlayer */
-          render_tilemap_overlayer(z_index{INT32_MAX, 0}, 1);
+          render_tilemap_overlayer(z_index{INT32_MAX, 0}, 0, p_snapshot);
 
-          /* viewport 的后处理 */
-          worker >> after_render_viewport{&v};
-        }
+          /* 发送最后一批 sprite，并记录本帧的合批情况 */
+          batcher.flush(worker);
+          batcher.step();
+          refresher.step();
+        };
 
-        /* 尝试插入 tilemap 的 overlayer */
-        render_tilemap_overlayer(z_index{INT32_MAX, 0});
+        int state = 0;
+        {
+          /* 批量发送本帧的绘制任务，离开作用域时统一放入队列 */
+          auto batch = worker.batch();
+          rb_protect(
+              [](VALUE data) -> VALUE {
+                (*reinterpret_cast<decltype(send_tasks)*>(data))();
+                return Qnil;
+              },
+              reinterpret_cast<VALUE>(&send_tasks), &state);
+        }
+        if (state) {
+          /* 丢弃本帧尚未发送的 sprite，以免在下一帧中绘制 */
+          batcher.sprites.clear();
+          rb_jump_tag(state);
+        }
 
         /* 绘制任务发送完毕，计时阶段 2 */
         graphics_timer.step(2);
 
-        /* 线程进入等待，直到绘制完成 */
-        RGMWAIT(1);
+        if (p_snapshot) {
+          /* 流水线模式下，渲染线程绘制完这一帧后释放快照，不在此等待 */
+          if constexpr (std::remove_cvref_t<
+                            decltype(worker)>::is_asynchronized) {
+            p_snapshot->pending =
+                worker.send(core::synchronize_signal<1>{&(p_snapshot->pause)});
+          }
+        } else {
+          /* 线程进入等待，直到绘制完成 */
+          RGMWAIT(1);
+        }
 
         /* 绘制结束，计时阶段 3 */
         graphics_timer.step(3);
@@ -182,6 +395,9 @@ struct init_graphics {
         RGMLOAD(transition_id, uint64_t);
         RGMLOAD(vague, int);
 
+        /* 无窗口模式下，记录本帧执行 ruby 脚本的时间 */
+        base::benchmark_recorder.logic_end();
+
         /* 计时器的起点和终点 */
         graphics_timer.step(4);
         graphics_timer.start();
@@ -194,6 +410,8 @@ struct init_graphics {
 
         /* 清空屏幕 */
         worker >> base::clear_screen{};
+        worker >> shader::shader_step{};
+        worker >> window_skins_step{};
 
         /* 发送 render_transition */
         if (transition_id == 0) {
@@ -213,6 +431,55 @@ struct init_graphics {
         graphics_timer.step(3);
         return Qnil;
       }
+
+      /* ruby method: Base#graphics_sprite_stats -> sprite_batcher */
+      static VALUE sprite_stats(VALUE) {
+        sprite_batcher& batcher = RGMDATA(sprite_batcher);
+
+        return rb_ary_new_from_args(2, INT2FIX(batcher.last_sprite_count),
+                                    INT2FIX(batcher.last_batch_count));
+      }
+
+      /* ruby method: Base#graphics_arena_stats -> core::frame_arena */
+      static VALUE arena_stats(VALUE) {
+        core::frame_arena& arena = worker.arena;
+
+        return rb_ary_new_from_args(4, ULL2NUM(arena.last_bytes),
+                                    ULL2NUM(arena.last_overflows),
+                                    ULL2NUM(arena.capacity()),
+                                    ULL2NUM(arena.last_heap_allocations));
+      }
+
+      /* ruby method: Base#graphics_object_stats -> object_refresher */
+      static VALUE object_stats(VALUE) {
+        object_refresher& refresher = RGMDATA(object_refresher);
+
+        return rb_ary_new_from_args(3, INT2FIX(refresher.last_refresh_count),
+                                    INT2FIX(refresher.last_skip_count),
+                                    ULL2NUM(refresher.last_read_count));
+      }
+
+      /* ruby method: Base#graphics_render_stats -> render_stats */
+      static VALUE render_stats(VALUE) {
+        rmxp::render_stats::result stats{};
+        worker >> rmxp::render_stats{&stats};
+
+        RGMWAIT(1);
+
+        VALUE hash = rb_hash_new();
+        auto set = [hash](const char* key, const auto& values) {
+          VALUE array = rb_ary_new_capa(values.size());
+          for (uint64_t value : values) rb_ary_push(array, ULL2NUM(value));
+          rb_hash_aset(hash, ID2SYM(rb_intern(key)), array);
+        };
+        set("window", stats.window);
+        set("plane", stats.plane);
+        set("pool", stats.pool);
+        set("viewport", stats.viewport);
+        set("shader", stats.shader);
+        set("glyph", stats.glyph);
+        return hash;
+      }
     };
 
     VALUE rb_mRGM = rb_define_module("RGM");
@@ -221,6 +488,14 @@ struct init_graphics {
                               0);
     rb_define_module_function(rb_mRGM_Base, "graphics_transition",
                               wrapper::transition, 5);
+    rb_define_module_function(rb_mRGM_Base, "graphics_sprite_stats",
+                              wrapper::sprite_stats, 0);
+    rb_define_module_function(rb_mRGM_Base, "graphics_arena_stats",
+                              wrapper::arena_stats, 0);
+    rb_define_module_function(rb_mRGM_Base, "graphics_object_stats",
+                              wrapper::object_stats, 0);
+    rb_define_module_function(rb_mRGM_Base, "graphics_render_stats",
+                              wrapper::render_stats, 0);
   }
 };
-}  // namespace rgm::rmxp
\ No newline at end of file
+}  // namespace rgm::rmxp
\ No newline at end of file
@@ -21,6 +21,8 @@
 #pragma once
 #include "base/base.hpp"
 #include "drawable.hpp"
+#include "render_plane.hpp"
+#include "render_tilemap.hpp"
 #include "tilemap_manager.hpp"
 
 namespace rgm::rmxp {
@@ -31,10 +33,12 @@ namespace rgm::rmxp {
  * 2. dispose，将相应的对象从 drawables 中移除；
  * 3. set_z，修改 z 值，从而改变对象在 drawables 中的位置；
  * 4. refresh_value，刷新对象的成员变量，重新读取 ruby 中对应的实例变量。
+ * 5. touch_object，标记对象类型的属性已修改，在下次绘制前重新读取。
  * 其中，dispose 和 set_z 不关心具体的类型，直接操作整个 variant，
  * 但 create 和 refresh_value 的效果会跟随 Drawable 类型而变化。
  * 
- * 裸指针 @data_ptr，作为 create 的返回值，只在 refresh_value 用到。
+ * 裸指针 @data_ptr，作为 create 的返回值，只在 refresh_value 和
+ * touch_object 用到。
  * 对于 dispose 和 set_z，都需要通过 z_index 查找对象，但是 z_index 不保存
  * 在 C++ 层中，故必须通过传入 id，通过 id2z 获得 z 值，组合成 z_index，再去
  * drawables 中查找，仅仅通过裸指针 @data_ptr 是无法实现的。
@@ -70,8 +74,10 @@ struct init_drawable_base {
         /* 从 cache_z 中移除 id */
         cache_z.erase(id);
 
-        /* 从 tilemap_manager 的 infos 中移除 id */
-        RGMDATA(tilemap_manager).infos.erase(id);
+        /* 从 tilemap_manager 的 infos 中移除 id，并释放其区块缓存 */
+        if (RGMDATA(tilemap_manager).infos.erase(id)) {
+          worker >> tilemap_release_chunks{id};
+        }
 
         int z = opt.value();
 
@@ -86,6 +92,11 @@ struct init_drawable_base {
 
         auto node = p_data->m_data.extract(z_index{z, id});
         if (!node.empty()) {
+          /* 释放 plane 的平铺缓存 */
+          if (auto* p = std::get_if<plane>(&node.mapped())) {
+            worker >> plane_release_tiles{p->ruby_object};
+          }
+
           /* 处理 fixed delta_z overlayer */
           auto erase_visitor = [=]([[maybe_unused]] auto&& item) {
             if constexpr (requires { item.fixed_overlayer_zs; }) {
@@ -143,6 +154,7 @@ struct init_drawable_base {
 /// 方法包括：
 /// 1. create
 /// 2. refresh_value
+/// 3. touch_object
 template <typename T_Drawable>
 struct init_drawable {
   static void before(auto& this_worker) {
@@ -200,6 +212,14 @@ struct init_drawable {
         }
         return Qnil;
       }
+
+      /* ruby method: Base#drawable_touch_object -> drawable::object_dirty */
+      static VALUE touch_object(VALUE, VALUE data_ptr_) {
+        RGMLOAD(data_ptr, T_Drawable*);
+
+        if (data_ptr) data_ptr->object_dirty = true;
+        return Qnil;
+      }
     };
 
     VALUE rb_mRGM = rb_define_module("RGM");
@@ -213,6 +233,11 @@ struct init_drawable {
       rb_define_module_function(rb_mRGM_Base, name.data(),
                                 wrapper::refresh_value, 2);
     }
+    {
+      std::string name = std::string{T_Drawable::name} + "_touch_object";
+      rb_define_module_function(rb_mRGM_Base, name.data(),
+                                wrapper::touch_object, 1);
+    }
   }
 };
 }  // namespace rgm::rmxp
\ No newline at end of file
@@ -185,6 +185,55 @@ struct keystate {
   }
 };
 
+/// @brief 无窗口模式下回放录制的按键输入
+/// 录制的输入脚本由 ruby 解析，逐条添加到 events 中。每次 Input.update
+/// 时，将帧号不超过当前帧的事件直接写入 keystate，代替真实的键盘事件。
+struct input_replay {
+  /// @brief 单个按键事件
+  struct event {
+    /// @brief 事件发生的帧，即第几次调用 Input.update，从 0 开始
+    int frame;
+
+    /// @brief RGSS 虚拟按键
+    int key;
+
+    /// @brief true 表示按下，false 表示抬起
+    bool press;
+  };
+
+  /// @brief 按帧号排序的事件列表
+  std::vector<event> events;
+
+  /// @brief 下一个待回放的事件
+  size_t next = 0;
+
+  /// @brief 当前帧号
+  int frame = 0;
+
+  /// @brief 添加一个事件，帧号相同的事件保持添加的顺序
+  void insert(int frame, int key, bool press) {
+    auto it = std::upper_bound(
+        events.begin(), events.end(), frame,
+        [](int f, const event& e) { return f < e.frame; });
+    events.insert(it, event{frame, key, press});
+  }
+
+  /// @brief 回放当前帧的事件，然后进入下一帧
+  /// @param state 按键状态，已经执行过 keystate::update
+  void apply(keystate& state) {
+    while (next < events.size() && events[next].frame <= frame) {
+      const event& e = events[next];
+      if (e.press) {
+        state.press(e.key);
+      } else {
+        state.release(e.key);
+      }
+      ++next;
+    }
+    ++frame;
+  }
+};
+
 /// @brief 按键按下的事件
 struct key_press {
   /// @brief 键盘的按键
@@ -221,8 +270,8 @@ struct key_release {
 
 /// @brief 按键相关操作的初始化类
 struct init_input {
-  /* 引入数据对象 keymap 和 keystate */
-  using data = std::tuple<keymap, keystate>;
+  /* 引入数据对象 keymap、keystate 和 input_replay */
+  using data = std::tuple<keymap, keystate, input_replay>;
 
   static void before(auto& this_worker) {
     /* 静态的 worker 变量供函数的内部类 wrapper 使用 */
@@ -286,6 +335,22 @@ struct init_input {
          */
         worker.flush();
 
+        /* 无窗口模式下回放录制的按键输入 */
+        if (config::headless) {
+          RGMDATA(input_replay).apply(RGMDATA(keystate));
+        }
+
+        return Qnil;
+      }
+
+      /* ruby method: Base#input_replay -> input_replay::insert */
+      static VALUE replay(VALUE, VALUE frame_, VALUE input_key_,
+                          VALUE press_) {
+        RGMLOAD(frame, int);
+        RGMLOAD(input_key, int);
+        RGMLOAD(press, bool);
+
+        RGMDATA(input_replay).insert(frame, input_key, press);
         return Qnil;
       }
 
@@ -324,6 +389,8 @@ struct init_input {
                               wrapper::last_press, 0);
     rb_define_module_function(rb_mRGM_Base, "input_last_release",
                               wrapper::last_release, 0);
+    rb_define_module_function(rb_mRGM_Base, "input_replay", wrapper::replay,
+                              3);
   }
 };
 }  // namespace rgm::rmxp
\ No newline at end of file
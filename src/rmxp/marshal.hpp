@@ -0,0 +1,481 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#pragma once
+#include "base/base.hpp"
+#include "table.hpp"
+
+namespace rgm::rmxp {
+/// @brief 读取时 ruby 抛出的异常，state 是 rb_protect 得到的状态
+struct marshal_jump {
+  int state;
+};
+
+/**
+ * @brief 读取 rxdata 的 Marshal 数据（4.8 版本），只支持 RGSS 用到的子集
+ * @note 与 ruby 的 Marshal.load 相比有以下区别：
+ * 1. 所有的字符串直接创建为 UTF-8 编码，不需要再调用 force_utf8_encode；
+ * 2. Table 的数据直接复制到 rmxp::table 中，不创建中间的字符串；
+ * 3. 可以跳过 RPG::Event 的 @pages，等到访问时再读取（config::lazy_event_pages）。
+ * 遇到不支持的类型时抛出 std::domain_error，调用者应改用 Marshal.load。
+ * 可能抛出 ruby 异常的调用都通过 protect 转换成 marshal_jump。
+ */
+struct marshal_reader {
+  /// @brief 当前读取的位置和数据的末尾
+  const char* p;
+  const char* end;
+
+  /// @brief 对象表，用于 '@' 引用。ruby 的数组可以被 GC 标记。
+  VALUE objects;
+
+  /// @brief 符号表，用于 ';' 引用。symbol_values 是对应的 ruby 数组。
+  std::vector<ID> symbols;
+  VALUE symbol_values;
+
+  /// @brief 是否跳过 RPG::Event 的 @pages
+  bool lazy;
+
+  /// @brief 是否遇到过 '@' 引用，此时延迟读取的结果可能不正确
+  bool has_link = false;
+
+  /// @brief 存储所有 Table 的容器
+  tables* p_tables;
+
+  /// @brief 常用的类和 ID
+  VALUE cTable;
+  VALUE cEvent;
+  ID id_pages;
+  ID id_pages_source;
+
+  /// @brief 类名到 ruby 类的缓存
+  std::unordered_map<ID, VALUE> classes;
+
+  explicit marshal_reader(VALUE buffer_, tables* p_tables_, bool lazy_)
+      : p(RSTRING_PTR(buffer_)),
+        end(RSTRING_PTR(buffer_) + RSTRING_LEN(buffer_)),
+        objects(rb_ary_new()),
+        symbols(),
+        symbol_values(rb_ary_new()),
+        lazy(lazy_),
+        p_tables(p_tables_),
+        cTable(protect([] { return rb_path2class("Table"); })),
+        cEvent(protect([] { return rb_path2class("RPG::Event"); })),
+        id_pages(rb_intern("@pages")),
+        id_pages_source(rb_intern("@pages_source")) {}
+
+  /// @brief 调用可能抛出 ruby 异常的函数 f
+  /// ruby 的异常通过 longjmp 跳转，会跳过 C++ 对象的析构。这里用 rb_protect
+  /// 拦截，转换成 marshal_jump 抛出，等 C++ 的栈展开后再用 rb_jump_tag 恢复。
+  template <typename F>
+  static VALUE protect(F f) {
+    int state = 0;
+    VALUE result = rb_protect(
+        [](VALUE arg) -> VALUE {
+          F& f = *reinterpret_cast<F*>(arg);
+          if constexpr (std::is_void_v<std::invoke_result_t<F&>>) {
+            f();
+            return Qnil;
+          } else {
+            return f();
+          }
+        },
+        reinterpret_cast<VALUE>(&f), &state);
+    if (state) throw marshal_jump{state};
+    return result;
+  }
+
+  /// @brief 读取文件头和完整的对象
+  VALUE load() {
+    if (byte() != 4 || byte() != 8) {
+      throw std::domain_error{"Unsupported marshal version."};
+    }
+    return read<false>();
+  }
+
+  /// @brief 读取 1 个字节
+  uint8_t byte() {
+    if (p >= end) throw std::domain_error{"Marshal data is too short."};
+    return static_cast<uint8_t>(*p++);
+  }
+
+  /// @brief 读取 n 个字节，返回起点
+  const char* bytes(long n) {
+    if (n < 0 || end - p < n) {
+      throw std::domain_error{"Marshal data is too short."};
+    }
+    const char* ptr = p;
+    p += n;
+    return ptr;
+  }
+
+  /// @brief 读取 Marshal 格式的整数
+  long integer() {
+    const int8_t c = static_cast<int8_t>(byte());
+    if (c == 0) return 0;
+    if (c > 4) return c - 5;
+    if (c < -4) return c + 5;
+
+    long x = 0;
+    if (c > 0) {
+      for (int i = 0; i < c; ++i) x |= static_cast<long>(byte()) << (8 * i);
+    } else {
+      x = -1;
+      for (int i = 0; i < -c; ++i) {
+        x &= ~(0xffL << (8 * i));
+        x |= static_cast<long>(byte()) << (8 * i);
+      }
+    }
+    return x;
+  }
+
+  /// @brief 读取符号，包括 ':' 和 ';' 两种情况
+  ID symbol() {
+    const char type = static_cast<char>(byte());
+    if (type == ';') return symbols.at(integer());
+    if (type == 'I') {
+      /* 带编码的符号，编码信息直接忽略 */
+      const ID id = symbol();
+      skip_ivars();
+      return id;
+    }
+    if (type != ':') throw std::domain_error{"Invalid marshal symbol."};
+
+    const long n = integer();
+    const char* ptr = bytes(n);
+    const ID id = rb_intern3(ptr, n, rb_utf8_encoding());
+    symbols.push_back(id);
+    rb_ary_push(symbol_values, ID2SYM(id));
+    return id;
+  }
+
+  /// @brief 读取符号表示的类
+  VALUE klass(ID name) {
+    auto it = classes.find(name);
+    if (it != classes.end()) return it->second;
+
+    VALUE k = protect([=] { return rb_path2class(rb_id2name(name)); });
+    classes.emplace(name, k);
+    return k;
+  }
+
+  /// @brief 登记到对象表中
+  VALUE entry(VALUE object) {
+    rb_ary_push(objects, object);
+    return object;
+  }
+
+  /// @brief 读取并忽略 'I' 之后的实例变量，只用于字符串的编码信息
+  void skip_ivars() {
+    const long n = integer();
+    for (long i = 0; i < n; ++i) {
+      symbol();
+      read<true>();
+    }
+  }
+
+  /// @brief 读取 Table 的数据，直接创建 rmxp::table
+  /// 与 Table._load 的结果相同，数据格式参见 init_table 中的 load。
+  VALUE load_table(const char* ptr, long n) {
+    std::array<int32_t, 5> header;
+    if (n < static_cast<long>(sizeof(header))) {
+      throw std::domain_error{"Invalid table data."};
+    }
+    memcpy(header.data(), ptr, sizeof(header));
+
+    const int x_size = header[1];
+    const int y_size = header[2];
+    const int z_size = header[3];
+
+    /* 先检查尺寸再分配内存，避免错误的数据导致溢出或者巨大的分配 */
+    if (x_size < 0 || y_size < 0 || z_size < 0) {
+      throw std::domain_error{"Invalid table data."};
+    }
+    const int64_t count = static_cast<int64_t>(x_size) * y_size * z_size;
+    const int64_t capacity =
+        (n - static_cast<long>(sizeof(header))) / sizeof(int16_t);
+    if (count > capacity) throw std::domain_error{"Invalid table data."};
+
+    table t;
+    t.resize(x_size, y_size, z_size);
+
+    VALUE object = protect([this] { return rb_obj_alloc(cTable); });
+    const uint64_t id = NUM2ULL(rb_obj_id(object));
+
+    VALUE data_ptr_ = Qnil;
+    if (t.size() > 0) {
+      memcpy(t.data_ptr(), ptr + sizeof(header), t.size() * sizeof(int16_t));
+      data_ptr_ = ULL2NUM(reinterpret_cast<uint64_t>(t.data_ptr()));
+    }
+    p_tables->insert_or_assign(id, std::move(t));
+
+    protect([=, this] {
+      rb_ivar_set(object, rb_intern("@id"), ULL2NUM(id));
+      rb_ivar_set(object, rb_intern("@xsize"), INT2FIX(x_size));
+      rb_ivar_set(object, rb_intern("@ysize"), INT2FIX(y_size));
+      rb_ivar_set(object, rb_intern("@zsize"), INT2FIX(z_size));
+      rb_ivar_set(object, rb_intern("@observed"), Qfalse);
+      rb_ivar_set(object, rb_intern("@data_ptr"), data_ptr_);
+
+      rb_define_finalizer(object,
+                          rb_funcall(cTable, rb_intern("create_finalizer"), 0));
+    });
+    return object;
+  }
+
+  /// @brief 读取一个对象
+  /// @tparam skip 为 true 时只移动读取的位置，不创建对象（符号仍会登记）
+  template <bool skip>
+  VALUE read() {
+    const char type = static_cast<char>(byte());
+    switch (type) {
+      case '0':
+        return Qnil;
+      case 'T':
+        return Qtrue;
+      case 'F':
+        return Qfalse;
+      case 'i':
+        return LONG2NUM(integer());
+      case ':':
+      case ';':
+        --p;
+        return ID2SYM(symbol());
+      case '@': {
+        has_link = true;
+        const long index = integer();
+        if constexpr (skip) return Qnil;
+
+        if (index >= RARRAY_LEN(objects)) {
+          throw std::domain_error{"Invalid marshal link."};
+        }
+        return rb_ary_entry(objects, index);
+      }
+      case '"': {
+        const long n = integer();
+        const char* ptr = bytes(n);
+        if constexpr (skip) return entry(Qnil);
+
+        /* RGSS 的字符串都按照 UTF-8 编码处理 */
+        return entry(rb_utf8_str_new(ptr, n));
+      }
+      case 'I': {
+        /* 带实例变量的对象，只支持字符串的编码信息 */
+        if (p >= end || *p != '"') {
+          throw std::domain_error{"Unsupported marshal ivar."};
+        }
+
+        VALUE object = read<skip>();
+        skip_ivars();
+        return object;
+      }
+      case 'f': {
+        const long n = integer();
+        const char* ptr = bytes(n);
+        if constexpr (skip) return entry(Qnil);
+
+        const std::string s(ptr, n);
+        double value;
+        if (s == "nan") {
+          value = std::numeric_limits<double>::quiet_NaN();
+        } else if (s == "inf") {
+          value = std::numeric_limits<double>::infinity();
+        } else if (s == "-inf") {
+          value = -std::numeric_limits<double>::infinity();
+        } else {
+          value = std::strtod(s.c_str(), nullptr);
+        }
+        return entry(DBL2NUM(value));
+      }
+      case 'l': {
+        const char sign = static_cast<char>(byte());
+        const long n = integer() * 2;
+        const char* ptr = bytes(n);
+        if constexpr (skip) return entry(Qnil);
+
+        return entry(protect([=] {
+          VALUE value = rb_integer_unpack(ptr, n, 1, 0,
+                                          INTEGER_PACK_LITTLE_ENDIAN);
+          if (sign == '-') value = rb_funcall(value, rb_intern("-@"), 0);
+          return value;
+        }));
+      }
+      case '[': {
+        const long n = integer();
+        VALUE array = entry(skip ? Qnil : rb_ary_new_capa(n));
+        for (long i = 0; i < n; ++i) {
+          VALUE item = read<skip>();
+          if constexpr (!skip) rb_ary_push(array, item);
+        }
+        return array;
+      }
+      case '{':
+      case '}': {
+        const long n = integer();
+        VALUE hash = entry(skip ? Qnil : rb_hash_new());
+        for (long i = 0; i < n; ++i) {
+          VALUE key = read<skip>();
+          VALUE value = read<skip>();
+          if constexpr (!skip) {
+            /* rb_hash_aset 会调用 key 的 hash 方法 */
+            protect([=] { rb_hash_aset(hash, key, value); });
+          }
+        }
+        if (type == '}') {
+          VALUE value = read<skip>();
+          if constexpr (!skip) rb_hash_set_ifnone(hash, value);
+        }
+        return hash;
+      }
+      case 'u': {
+        const ID name = symbol();
+        const long n = integer();
+        const char* ptr = bytes(n);
+        if constexpr (skip) return entry(Qnil);
+
+        VALUE k = klass(name);
+        if (k == cTable) return entry(load_table(ptr, n));
+
+        /* 其他的类，例如 Color 和 Tone，调用 _load */
+        return entry(protect([=] {
+          return rb_funcall(k, rb_intern("_load"), 1, rb_str_new(ptr, n));
+        }));
+      }
+      case 'o': {
+        const ID name = symbol();
+        VALUE object = Qnil;
+        VALUE k = Qnil;
+        if constexpr (!skip) {
+          k = klass(name);
+          object = protect([=] { return rb_obj_alloc(k); });
+        }
+        entry(object);
+
+        const long n = integer();
+        for (long i = 0; i < n; ++i) {
+          const ID ivar = symbol();
+
+          if constexpr (!skip) {
+            /* 跳过 RPG::Event 的 @pages，只复制这一段数据以便之后读取 */
+            if (lazy && k == cEvent && ivar == id_pages) {
+              const char* start = p;
+              read<true>();
+
+              VALUE source = protect([=, this] {
+                VALUE slice = rb_obj_freeze(rb_str_new(start, p - start));
+                VALUE source = rb_ary_new_from_args(2, slice, symbol_values);
+                rb_ivar_set(object, id_pages_source, source);
+                return source;
+              });
+              RB_GC_GUARD(source);
+              continue;
+            }
+          }
+
+          VALUE value = read<skip>();
+          if constexpr (!skip) {
+            protect([=] { rb_ivar_set(object, ivar, value); });
+          }
+        }
+        return object;
+      }
+      default:
+        throw std::domain_error{"Unsupported marshal type."};
+    }
+  }
+};
+
+/// @brief Marshal 读取相关的初始化类
+struct init_marshal {
+  static void before(auto& this_worker) {
+    /* 静态的 worker 变量供函数的内部类 wrapper 使用 */
+    static decltype(auto) worker = this_worker;
+
+    /* wrapper 类，创建静态方法供 ruby 的模块绑定 */
+    struct wrapper {
+      /* 调用 f，将不支持的数据转换成 ruby 的 NotImplementedError */
+      /* ruby 的异常在 C++ 的栈帧全部析构之后重新抛出 */
+      static VALUE protect(auto f) {
+        VALUE result = Qnil;
+        bool ok = true;
+        int state = 0;
+        try {
+          result = f();
+        } catch (marshal_jump& e) {
+          state = e.state;
+        } catch (std::domain_error&) {
+          ok = false;
+        }
+        if (state) rb_jump_tag(state);
+        if (!ok) rb_raise(rb_eNotImpError, "Unsupported marshal data.\n");
+        return result;
+      }
+
+      /* ruby method: Base#marshal_load -> marshal_reader::load */
+      static VALUE load(VALUE, VALUE buffer_) {
+        Check_Type(buffer_, T_STRING);
+        tables* p_tables = &RGMDATA(tables);
+
+        return protect([=] {
+          const bool lazy = config::lazy_event_pages;
+          marshal_reader reader(buffer_, p_tables, lazy);
+          VALUE object = reader.load();
+          RB_GC_GUARD(object);
+
+          /* 存在引用时跳过的对象可能被其他地方引用，重新完整地读取 */
+          if (lazy && reader.has_link) {
+            marshal_reader reader2(buffer_, p_tables, false);
+            return reader2.load();
+          }
+          return object;
+        });
+      }
+
+      /* ruby method: Base#marshal_load_pages -> marshal_reader::read */
+      static VALUE load_pages(VALUE, VALUE source_) {
+        Check_Type(source_, T_ARRAY);
+        tables* p_tables = &RGMDATA(tables);
+
+        VALUE buffer_ = rb_ary_entry(source_, 0);
+        VALUE symbols_ = rb_ary_entry(source_, 1);
+        Check_Type(buffer_, T_STRING);
+        Check_Type(symbols_, T_ARRAY);
+
+        return protect([=] {
+          marshal_reader reader(buffer_, p_tables, false);
+
+          /* 还原跳过 @pages 时的符号表 */
+          const long n = RARRAY_LEN(symbols_);
+          reader.symbols.reserve(n);
+          for (long i = 0; i < n; ++i) {
+            reader.symbols.push_back(SYM2ID(rb_ary_entry(symbols_, i)));
+          }
+          return reader.read<false>();
+        });
+      }
+    };
+
+    VALUE rb_mRGM = rb_define_module("RGM");
+    VALUE rb_mRGM_Base = rb_define_module_under(rb_mRGM, "Base");
+    rb_define_module_function(rb_mRGM_Base, "marshal_load", wrapper::load, 1);
+    rb_define_module_function(rb_mRGM_Base, "marshal_load_pages",
+                              wrapper::load_pages, 1);
+  }
+};
+}  // namespace rgm::rmxp
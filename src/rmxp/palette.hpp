@@ -137,11 +137,192 @@ struct init_palette {
         if (x < 0 || x >= s.width()) return Qnil;
         if (y < 0 || y >= s.height()) return Qnil;
         size_t index = x + y * s.width();
+        ptr[index] = to_pixel(color_);
+        return Qnil;
+      }
+
+      /* 将 ruby 的 Color 对象转换成 rgba32 格式的像素 */
+      static uint32_t to_pixel(VALUE color_) {
         color c;
         c << color_;
-        uint32_t color =
-            c.red | (c.green << 8) | (c.blue << 16) | (c.alpha << 24);
-        ptr[index] = color;
+        return c.red | (c.green << 8) | (c.blue << 16) | (c.alpha << 24);
+      }
+
+      /* ruby method: Palette#fill_rect -> surface_kernel::fill */
+      static VALUE fill_rect(VALUE, VALUE id_, VALUE rect_, VALUE color_) {
+        RGMLOAD(id, uint64_t);
+
+        rect r;
+        r << rect_;
+        const uint32_t c = to_pixel(color_);
+
+        cen::surface& s = RGMDATA(base::surfaces).at(id);
+        base::surface_kernel::for_each_row(
+            s, SDL_Rect{r.x, r.y, r.width, r.height},
+            [c](uint32_t* row, int n) {
+              base::surface_kernel::fill(row, n, c);
+            });
+        return Qnil;
+      }
+
+      /* ruby method: Palette#blt -> surface_kernel::blend */
+      static VALUE blt(VALUE, VALUE id_, VALUE x_, VALUE y_, VALUE src_id_,
+                       VALUE rect_, VALUE opacity_) {
+        RGMLOAD(id, uint64_t);
+        RGMLOAD(x, int);
+        RGMLOAD(y, int);
+        RGMLOAD(src_id, uint64_t);
+        RGMLOAD(opacity, int);
+
+        rect r;
+        r << rect_;
+        opacity = std::clamp(opacity, 0, 255);
+
+        base::surfaces& surfaces = RGMDATA(base::surfaces);
+        cen::surface& dst = surfaces.at(id);
+        cen::surface& src = surfaces.at(src_id);
+
+        /* 先将源矩形裁剪到 src 的范围内，再将目标矩形裁剪到 dst 的范围内 */
+        const SDL_Rect src_bound{0, 0, src.width(), src.height()};
+        const SDL_Rect dst_bound{0, 0, dst.width(), dst.height()};
+        SDL_Rect src_rect{r.x, r.y, r.width, r.height};
+        SDL_Rect clipped;
+        if (!SDL_IntersectRect(&src_rect, &src_bound, &clipped)) return Qnil;
+
+        SDL_Rect dst_rect{x + clipped.x - r.x, y + clipped.y - r.y, clipped.w,
+                          clipped.h};
+        SDL_Rect area;
+        if (!SDL_IntersectRect(&dst_rect, &dst_bound, &area)) return Qnil;
+
+        const int sx = clipped.x + area.x - dst_rect.x;
+        const int sy = clipped.y + area.y - dst_rect.y;
+
+        auto src_row = [&src](int row) {
+          return reinterpret_cast<const uint32_t*>(
+              static_cast<const uint8_t*>(src.pixel_data()) +
+              row * src.pitch());
+        };
+        auto dst_row = [&dst](int row) {
+          return reinterpret_cast<uint32_t*>(
+              static_cast<uint8_t*>(dst.pixel_data()) + row * dst.pitch());
+        };
+
+        /* 源和目标是同一个 Palette 时，先复制源区域避免重叠 */
+        std::vector<uint32_t> copy;
+        if (src_id == id) {
+          copy.resize(static_cast<size_t>(area.w) * area.h);
+          for (int i = 0; i < area.h; ++i) {
+            std::copy_n(src_row(sy + i) + sx, area.w, copy.data() + i * area.w);
+          }
+        }
+
+        for (int i = 0; i < area.h; ++i) {
+          const uint32_t* s =
+              copy.empty() ? src_row(sy + i) + sx : copy.data() + i * area.w;
+          base::surface_kernel::blend(dst_row(area.y + i) + area.x, s, area.w,
+                                      opacity);
+        }
+        return Qnil;
+      }
+
+      /* 对 Palette 的 rect 区域应用颜色变换 */
+      static void apply(uint64_t id, VALUE rect_,
+                        const base::surface_kernel::transform& t) {
+        rect r;
+        r << rect_;
+
+        cen::surface& s = RGMDATA(base::surfaces).at(id);
+        base::surface_kernel::for_each_row(
+            s, SDL_Rect{r.x, r.y, r.width, r.height},
+            [&t](uint32_t* row, int n) {
+              base::surface_kernel::apply(row, n, t);
+            });
+      }
+
+      /* ruby method: Palette#hue_change -> surface_kernel::apply */
+      static VALUE hue_change(VALUE, VALUE id_, VALUE rect_, VALUE hue_) {
+        RGMLOAD(id, uint64_t);
+        RGMLOAD(hue, int);
+
+        apply(id, rect_, base::surface_kernel::transform::hue(hue));
+        return Qnil;
+      }
+
+      /* ruby method: Palette#tone_change -> surface_kernel::apply */
+      static VALUE tone_change(VALUE, VALUE id_, VALUE rect_, VALUE tone_) {
+        RGMLOAD(id, uint64_t);
+
+        tone t;
+        t << tone_;
+
+        apply(id, rect_,
+              base::surface_kernel::transform::tone(t.red, t.green, t.blue,
+                                                    t.gray));
+        return Qnil;
+      }
+
+      /* ruby method: Palette#grayscale -> surface_kernel::apply */
+      static VALUE grayscale(VALUE, VALUE id_, VALUE rect_) {
+        RGMLOAD(id, uint64_t);
+
+        apply(id, rect_, base::surface_kernel::transform::gray());
+        return Qnil;
+      }
+
+      /* ruby method: Palette#replace_color -> surface_kernel::replace */
+      static VALUE replace_color(VALUE, VALUE id_, VALUE from_, VALUE to_) {
+        RGMLOAD(id, uint64_t);
+
+        const uint32_t from = to_pixel(from_);
+        const uint32_t to = to_pixel(to_);
+
+        cen::surface& s = RGMDATA(base::surfaces).at(id);
+
+        int count = 0;
+        base::surface_kernel::for_each_row(
+            s, SDL_Rect{0, 0, s.width(), s.height()},
+            [&](uint32_t* row, int n) {
+              count += base::surface_kernel::replace(row, n, from, to);
+            });
+        return INT2FIX(count);
+      }
+
+      /* ruby method: Palette#export_pixels -> rb_str_new */
+      static VALUE export_pixels(VALUE, VALUE id_) {
+        RGMLOAD(id, uint64_t);
+
+        cen::surface& s = RGMDATA(base::surfaces).at(id);
+
+        /* 逐行复制，返回的字符串不包含每行末尾的填充字节 */
+        const long row_size = s.width() * 4;
+        VALUE str = rb_str_new(nullptr, row_size * s.height());
+        char* ptr = RSTRING_PTR(str);
+        const char* pixels = static_cast<const char*>(s.pixel_data());
+        for (int y = 0; y < s.height(); ++y) {
+          std::memcpy(ptr + y * row_size, pixels + y * s.pitch(), row_size);
+        }
+        return str;
+      }
+
+      /* ruby method: Palette#import_pixels -> RSTRING_PTR */
+      static VALUE import_pixels(VALUE, VALUE id_, VALUE string_) {
+        RGMLOAD(id, uint64_t);
+        Check_Type(string_, T_STRING);
+
+        cen::surface& s = RGMDATA(base::surfaces).at(id);
+
+        const long row_size = s.width() * 4;
+        if (RSTRING_LEN(string_) != row_size * s.height()) {
+          rb_raise(rb_eArgError,
+                   "Palette#import_pixels expects %ld bytes, but got %ld.\n",
+                   row_size * s.height(), RSTRING_LEN(string_));
+        }
+
+        const char* ptr = RSTRING_PTR(string_);
+        char* pixels = static_cast<char*>(s.pixel_data());
+        for (int y = 0; y < s.height(); ++y) {
+          std::memcpy(pixels + y * s.pitch(), ptr + y * row_size, row_size);
+        }
         return Qnil;
       }
 
@@ -178,6 +359,12 @@ struct init_palette {
         SDL_Rect dst{0, 0, r.width, r.height};
         SDL_BlitSurface(s.get(), &src, ptr->get(), &dst);
 
+        /* 使 Bitmap 在内存中的副本失效 */
+        bitmap_shadows& shadows = RGMDATA(bitmap_shadows);
+        if (auto it = shadows.find(bitmap_id); it != shadows.end()) {
+          ++it->second->version;
+        }
+
         worker >> bitmap_capture_palette{bitmap_id, std::move(ptr)};
 
         return Qnil;
@@ -194,6 +381,21 @@ struct init_palette {
                               wrapper::get_pixel, 3);
     rb_define_module_function(rb_mRGM_Base, "palette_set_pixel",
                               wrapper::set_pixel, 4);
+    rb_define_module_function(rb_mRGM_Base, "palette_fill_rect",
+                              wrapper::fill_rect, 3);
+    rb_define_module_function(rb_mRGM_Base, "palette_blt", wrapper::blt, 6);
+    rb_define_module_function(rb_mRGM_Base, "palette_hue_change",
+                              wrapper::hue_change, 3);
+    rb_define_module_function(rb_mRGM_Base, "palette_tone_change",
+                              wrapper::tone_change, 3);
+    rb_define_module_function(rb_mRGM_Base, "palette_grayscale",
+                              wrapper::grayscale, 2);
+    rb_define_module_function(rb_mRGM_Base, "palette_replace_color",
+                              wrapper::replace_color, 3);
+    rb_define_module_function(rb_mRGM_Base, "palette_export_pixels",
+                              wrapper::export_pixels, 1);
+    rb_define_module_function(rb_mRGM_Base, "palette_import_pixels",
+                              wrapper::import_pixels, 2);
     rb_define_module_function(rb_mRGM_Base, "palette_save_png",
                               wrapper::save_png, 2);
     rb_define_module_function(rb_mRGM_Base, "palette_convert_to_bitmap",
@@ -23,6 +23,7 @@
 #include "blend_type.hpp"
 #include "drawable.hpp"
 #include "shader/shader.hpp"
+#include "software_effect.hpp"
 #include "viewport.hpp"
 
 namespace rgm::rmxp {
@@ -40,6 +41,7 @@ struct render {
 /// @brief 辅助实现色调处理的类
 /// 当 tone 不包含灰度的处理时，直接调用 blend_mode 实现加减法，
 /// 否则调用 shader_tone 来实现。opengl 的减法需要特殊的实现方式。
+/// software 渲染器不支持 shader 和自定义混合模式，使用 software_effect 实现。
 struct render_tone_helper {
   /// @brief 色调变化的效果
   const tone t;
@@ -57,7 +59,19 @@ struct render_tone_helper {
   /// @brief 在处理特定的绘制后，应用色调的效果
   /// @param renderer 渲染器
   /// @param proc 待调制的绘制内容，在绘制之后应用色调效果。
-  void process(cen::renderer& renderer, std::function<void()> proc) const {
+  void process(cen::renderer& renderer, auto&& proc) const {
+    /* software 渲染器在绘制之后用 CPU 处理像素 */
+    if (config::driver == config::driver_type::software) {
+      proc();
+
+      if (t.red || t.green || t.blue || t.gray) {
+        software_effect::apply(
+            renderer, r,
+            software_effect::transform::tone(t.red, t.green, t.blue, t.gray));
+      }
+      return;
+    }
+
     /* 需要处理灰度时，使用 shader_tone */
     if (t.gray) {
       shader_tone shader(t);
@@ -113,4 +127,41 @@ struct render_tone_helper {
     }
   }
 };
+
+/// @brief 辅助实现颜色修饰的类
+/// 使用 blend_type::color 填充颜色，software 渲染器则使用 software_effect。
+struct render_color_helper {
+  /// @brief 修饰的颜色
+  const color c;
+
+  /// @brief 应用颜色修饰的区域
+  const cen::irect* r;
+
+  /// @brief 构造函数
+  /// @param c 修饰的颜色
+  /// @param r 颜色修饰的区域，为空时处理整个视口
+  [[nodiscard]] explicit render_color_helper(const color& c,
+                                             const cen::irect* r = nullptr)
+      : c(c), r(r) {}
+
+  /// @brief 对当前的绘制目标应用颜色修饰
+  void process(cen::renderer& renderer) const {
+    if (config::driver == config::driver_type::software) {
+      software_effect::apply(
+          renderer, r,
+          software_effect::transform::color(c.red, c.green, c.blue, c.alpha));
+      return;
+    }
+
+    const cen::color fill(c.red, c.green, c.blue, c.alpha);
+
+    renderer.set_blend_mode(blend_type::color);
+    if (r) {
+      renderer.set_color(fill);
+      renderer.fill_rect(*r);
+    } else {
+      renderer.fill_with(fill);
+    }
+  }
+};
 }  // namespace rgm::rmxp
@@ -19,47 +19,125 @@
 // 3. This notice may not be removed or altered from any source distribution.
 
 #pragma once
+#include "bitmap.hpp"
 #include "render_base.hpp"
 
 namespace rgm::rmxp {
+/// @brief plane 平铺结果的缓存
+/// plane 的内容只取决于 bitmap、缩放、tone、color 和 viewport 的大小。
+/// 将 bitmap 平铺成不小于 viewport、且边长是图块整数倍的 texture，
+/// 滚动（ox、oy 变化）时只需要从缓存中绕回地绘制至多 4 次。
+/// 每个 plane 持有一个缓存，参数变化时尽量复用原有的 texture 重新绘制。
+struct plane_tiles {
+  /// @brief 缓存的数量上限，超过时淘汰最久未使用的缓存
+  static constexpr size_t max_size = 16;
+
+  /// @brief 决定平铺结果的参数
+  struct key_t {
+    /// @brief bitmap 的 id、SDL_Texture* 和内容的版本
+    uint64_t bitmap;
+    SDL_Texture* texture;
+    uint64_t version;
+
+    /// @brief 缩放后图块的宽和高
+    int width;
+    int height;
+
+    /// @brief 平铺区域的宽和高，由 viewport 的大小决定
+    int total_width;
+    int total_height;
+
+    uint8_t scale_mode;
+    std::array<int, 4> tone;
+    std::array<int, 4> color;
+
+    auto operator<=>(const key_t&) const = default;
+  };
+
+  /// @brief 一个 plane 的缓存
+  struct entry {
+    key_t key;
+
+    /// @brief 平铺好的 texture
+    cen::texture texture;
+
+    /// @brief 最后一次使用时的序号，用于淘汰最久未使用的缓存
+    uint64_t last_used;
+  };
+
+  /// @brief 所有的缓存，按 plane 对应的 ruby 对象索引
+  /// 流水线模式下每帧绘制的是快照中的副本，地址会变化，ruby 对象则不会。
+  /// plane 释放时由 plane_release_tiles 移除。
+  std::unordered_map<VALUE, entry> m_data;
+
+  /// @brief 当前的序号，每次查询缓存时递增
+  uint64_t tick = 0;
+
+  /// @brief 查询缓存的命中和未命中次数
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+
+  /// @brief 在缓存数量超出上限时，淘汰最久未使用的缓存
+  void shrink() {
+    while (m_data.size() > max_size) {
+      auto it = std::min_element(
+          m_data.begin(), m_data.end(), [](const auto& a, const auto& b) {
+            return a.second.last_used < b.second.last_used;
+          });
+      m_data.erase(it);
+    }
+  }
+};
+
+/// @brief 数据类 plane_tiles 相关的初始化类
+struct init_plane_tiles {
+  using data = std::tuple<plane_tiles>;
+
+  static void after(auto& worker) { RGMDATA(plane_tiles).m_data.clear(); }
+};
+
+/// @brief 任务：释放 plane 的平铺缓存
+/// 在 plane 释放时由 drawable_dispose 发送。
+struct plane_release_tiles {
+  /// @brief plane 对应的 ruby 对象
+  VALUE object;
+
+  void run(auto& worker) { RGMDATA(plane_tiles).m_data.erase(object); }
+};
+
 /// @brief 绘制 plane
-/// plane 是无限平铺的类型，为了提升绘制效率，会作双层绘制。
+/// plane 是无限平铺的类型，平铺的结果缓存在 plane_tiles 中。
 template <>
 struct render<plane> {
   /// @brief plane 数据的地址
   const plane* p;
 
-  /// @brief 辅助绘制 plane 的函数，实现缩放、混合模式等特效
+  /// @brief 辅助绘制 plane 的函数，实现混合模式等特效
   /// @param renderer 渲染器
-  /// @param up 上层图，源图
+  /// @param stack 渲染栈
+  /// @param up 上层图，平铺好的缓存
   /// @param down 下层图，目标图
-  /// @param src_rect 源矩形，从源图选取要绘制的内容
-  /// up 层的内容是用 plane 的原始素材进行了少量的平铺拼合成 src_rect 的大小。
-  void blend(cen::renderer& renderer, cen::texture& up, cen::texture& down,
-             const cen::irect& src_rect) const {
+  /// up 的宽高是图块的整数倍且不小于 viewport，根据 ox 和 oy 计算起点后，
+  /// 在每个方向上至多分 2 段绘制，总共至多绘制 4 次。
+  void blend(cen::renderer& renderer, base::renderstack& stack,
+             cen::texture& up, cen::texture& down) const {
     /* 获取 viewport，如果不存在则使用 default_viewport */
     const viewport* v = p->p_viewport ? p->p_viewport : &default_viewport;
 
-    /*
-     * 从左上角 {start_x, start_y} 开始绘制，
-     * 每次绘制 {step_x, step_y} 大小，
-     * 直到铺满整个 {0, 0, total_x, total_y} 的矩形区域。
-     */
-    int start_x = 0;
-    int start_y = 0;
-    int step_x = src_rect.width();
-    int step_y = src_rect.height();
-    int total_x = v->rect.width;
-    int total_y = v->rect.height;
+    const int total_x = v->rect.width;
+    const int total_y = v->rect.height;
+    const int tile_x = up.width();
+    const int tile_y = up.height();
 
-    start_x = (-v->ox - p->ox) % step_x;
-    if (start_x > 0) start_x -= step_x;
+    /* 画面上的 (0, 0) 对应 up 中的 (start_x, start_y) */
+    int start_x = (v->ox + p->ox) % tile_x;
+    if (start_x < 0) start_x += tile_x;
 
-    start_y = (-v->oy - p->oy) % step_y;
-    if (start_y > 0) start_y -= step_y;
+    int start_y = (v->oy + p->oy) % tile_y;
+    if (start_y < 0) start_y += tile_y;
 
     /* 设置绘制目标和区域 */
-    renderer.set_target(down);
+    stack.bind(down);
     renderer.set_clip(cen::irect(0, 0, total_x, total_y));
 
     /* 设置透明度 */
@@ -92,11 +170,21 @@ struct render<plane> {
       renderer.fill_with(cen::colors::white);
     }
 
-    cen::irect dst_rect(0, 0, step_x, step_y);
-    for (int i = start_x; i < total_x; i += step_x) {
-      for (int j = start_y; j < total_y; j += step_y) {
-        dst_rect.set_position(i, j);
-        renderer.render(up, src_rect, dst_rect);
+    /* 每个方向分为 [start, tile) 和 [0, ...) 两段，第二段可能为空 */
+    const int first_x = std::min(tile_x - start_x, total_x);
+    const int first_y = std::min(tile_y - start_y, total_y);
+
+    const std::array<std::array<int, 3>, 2> segments_x = {
+        {{start_x, 0, first_x}, {0, first_x, total_x - first_x}}};
+    const std::array<std::array<int, 3>, 2> segments_y = {
+        {{start_y, 0, first_y}, {0, first_y, total_y - first_y}}};
+
+    for (const auto& [src_x, dst_x, w] : segments_x) {
+      if (w <= 0) continue;
+      for (const auto& [src_y, dst_y, h] : segments_y) {
+        if (h <= 0) continue;
+        renderer.render(up, cen::irect(src_x, src_y, w, h),
+                        cen::irect(dst_x, dst_y, w, h));
       }
     }
 
@@ -108,34 +196,12 @@ struct render<plane> {
     up.set_alpha_mod(255);
   }
 
-  void run(auto& worker) {
-    cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
-    base::textures& textures = RGMDATA(base::textures);
-    base::renderstack& stack = RGMDATA(base::renderstack);
-
-    cen::texture& bitmap = textures.at(p->bitmap);
-
-    /* 获取 viewport，如果不存在则使用 default_viewport */
-    const viewport* v = p->p_viewport ? p->p_viewport : &default_viewport;
-
-    /* 设置缩放模式 */
-    switch (p->scale_mode) {
-      case 0:
-      default:
-        bitmap.set_scale_mode(cen::scale_mode::nearest);
-        break;
-      case 1:
-        bitmap.set_scale_mode(cen::scale_mode::linear);
-        break;
-      case 2:
-        bitmap.set_scale_mode(cen::scale_mode::best);
-        break;
-    }
-
-    /* 读取 plane 的各个属性 */
-    const int width = std::max(1, static_cast<int>(bitmap.width() * p->zoom_x));
-    const int height =
-        std::max(1, static_cast<int>(bitmap.height() * p->zoom_y));
+  /// @brief 将 bitmap 平铺到 target 上，并应用 tone 和 color 的效果
+  /// @param width 缩放后图块的宽
+  /// @param height 缩放后图块的高
+  void draw_tiles(cen::renderer& renderer, base::renderstack& stack,
+                  cen::texture& bitmap, cen::texture& target, int width,
+                  int height) const {
     const color& c = p->color;
     const tone& t = p->tone;
 
@@ -149,8 +215,8 @@ struct render<plane> {
      * 把 26x18 大小再绘制 25x18 次，那么总共绘制了 26x18+25x18 =
      * 918 次，大大减少了绘制的次数。时间复杂度从 o(n^2) -> o(n)。
      */
-    const int repeat_x = 1 + static_cast<int>(sqrt(v->rect.width / width));
-    const int repeat_y = 1 + static_cast<int>(sqrt(v->rect.height / height));
+    const int repeat_x = 1 + static_cast<int>(sqrt(target.width() / width));
+    const int repeat_y = 1 + static_cast<int>(sqrt(target.height() / height));
 
     auto render = [=, &renderer, &bitmap] {
       const cen::irect src_rect(0, 0, bitmap.width(), bitmap.height());
@@ -175,17 +241,111 @@ struct render<plane> {
 
     /* 应用 color 的效果 */
     if (use_color) {
-      renderer.set_blend_mode(blend_type::color);
-      renderer.fill_with(cen::color(c.red, c.green, c.blue, c.alpha));
+      render_color_helper(c).process(renderer);
+    }
+
+    /* 将中间层平铺到 target 上，然后出栈 */
+    auto process = [&](cen::texture& up, cen::texture&) {
+      const int step_x = width * repeat_x;
+      const int step_y = height * repeat_y;
+      const cen::irect src_rect(0, 0, step_x, step_y);
+      cen::irect dst_rect(0, 0, step_x, step_y);
+
+      renderer.set_target(target);
+      up.set_blend_mode(cen::blend_mode::none);
+      for (int i = 0; i < target.width(); i += step_x) {
+        for (int j = 0; j < target.height(); j += step_y) {
+          dst_rect.set_position(i, j);
+          renderer.render(up, src_rect, dst_rect);
+        }
+      }
+    };
+    stack.merge(process);
+  }
+
+  void run(auto& worker) {
+    cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
+    base::textures& textures = RGMDATA(base::textures);
+    base::renderstack& stack = RGMDATA(base::renderstack);
+    plane_tiles& tiles = RGMDATA(plane_tiles);
+
+    cen::texture& bitmap = textures.at(p->bitmap);
+
+    /* 获取 viewport，如果不存在则使用 default_viewport */
+    const viewport* v = p->p_viewport ? p->p_viewport : &default_viewport;
+    if (v->rect.width <= 0 || v->rect.height <= 0) return;
+
+    /* 设置缩放模式 */
+    switch (p->scale_mode) {
+      case 0:
+      default:
+        bitmap.set_scale_mode(cen::scale_mode::nearest);
+        break;
+      case 1:
+        bitmap.set_scale_mode(cen::scale_mode::linear);
+        break;
+      case 2:
+        bitmap.set_scale_mode(cen::scale_mode::best);
+        break;
     }
 
+    /* 读取 plane 的各个属性 */
+    const int width = std::max(1, static_cast<int>(bitmap.width() * p->zoom_x));
+    const int height =
+        std::max(1, static_cast<int>(bitmap.height() * p->zoom_y));
+    const color& c = p->color;
+    const tone& t = p->tone;
+
+    /* 平铺区域是不小于 viewport 的图块的整数倍 */
+    const int total_width = (v->rect.width + width - 1) / width * width;
+    const int total_height = (v->rect.height + height - 1) / height * height;
+
+    const plane_tiles::key_t key{p->bitmap,
+                                 bitmap.get(),
+                                 RGMDATA(bitmap_versions).get(p->bitmap),
+                                 width,
+                                 height,
+                                 total_width,
+                                 total_height,
+                                 p->scale_mode,
+                                 {t.red, t.green, t.blue, t.gray},
+                                 {c.red, c.green, c.blue, c.alpha}};
+
+    /* 查询缓存，参数变化时重新平铺 */
+    auto it = tiles.m_data.find(p->ruby_object);
+    if (it != tiles.m_data.end() && it->second.key == key) {
+      ++tiles.hits;
+    } else {
+      ++tiles.misses;
+
+      /* 大小相同时复用原有的 texture，否则重新创建 */
+      if (it == tiles.m_data.end() ||
+          it->second.texture.width() != total_width ||
+          it->second.texture.height() != total_height) {
+        if (it != tiles.m_data.end()) tiles.m_data.erase(it);
+
+        cen::texture cached =
+            stack.make_empty_texture(total_width, total_height);
+        it = tiles.m_data
+                 .emplace(p->ruby_object,
+                          plane_tiles::entry{key, std::move(cached), 0})
+                 .first;
+      } else {
+        it->second.key = key;
+      }
+      draw_tiles(renderer, stack, bitmap, it->second.texture, width, height);
+    }
+    it->second.last_used = ++tiles.tick;
+
+    /* 淘汰多余的缓存，刚使用过的缓存序号最大，不会被淘汰 */
+    tiles.shrink();
+
     auto process = [&, this](auto& up, auto& down) {
-      this->blend(renderer, up, down,
-                  cen::irect(0, 0, width * repeat_x, height * repeat_y));
+      this->blend(renderer, stack, up, down);
     };
 
-    /* 将中间层出栈，内容绘制到新的栈顶 */
-    stack.merge(process);
+    /* 将平铺好的缓存绘制到栈顶 */
+    stack.merge(process, it->second.texture);
   }
 };
 }  // namespace rgm::rmxp
\ No newline at end of file
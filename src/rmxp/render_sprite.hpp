@@ -32,29 +32,21 @@ struct render<sprite> {
 
   /// @brief 辅助绘制 sprite 的函数，实现缩放、混合模式等特效
   /// @param renderer 渲染器
+  /// @param stack 渲染栈
   /// @param up 上层图，源图
   /// @param down 下层图，目标图
   /// @param src_rect 源矩形，从源图选取要绘制的内容
   /// @param dst_rect 目标矩形，目标图需要绘制的区域
   /// up 层通常是 bitmap 本身，但也可能是一个新层，用于处理若干绘制效果。
-  void blend(cen::renderer& renderer, cen::texture& up, cen::texture& down,
-             const cen::irect& src_rect, const cen::frect& dst_rect) const {
+  void blend(cen::renderer& renderer, base::renderstack& stack,
+             cen::texture& up, cen::texture& down, const cen::irect& src_rect,
+             const cen::frect& dst_rect) const {
     /* 设置透明度 */
     up.set_alpha_mod(s->opacity);
 
-    /* 设置混合模式 */
-    switch (s->blend_type) {
-      case 0:
-      default:
-        up.set_blend_mode(cen::blend_mode::blend);
-        break;
-      case 1:
-        up.set_blend_mode(blend_type::add);
-        break;
-      case 2:
-        up.set_blend_mode(blend_type::sub);
-        break;
-    }
+    /* 设置混合模式和缩放模式 */
+    setup(up, s);
+
     /* 判断是否为 opengl 渲染，且混合模式是减法 */
     const bool opengl_sub = (s->blend_type == 2) && config::opengl;
 
@@ -64,26 +56,12 @@ struct render<sprite> {
       renderer.set_blend_mode(blend_type::reverse);
     }
 
-    /* 设置缩放模式 */
-    switch (s->scale_mode) {
-      case 0:
-      default:
-        up.set_scale_mode(cen::scale_mode::nearest);
-        break;
-      case 1:
-        up.set_scale_mode(cen::scale_mode::linear);
-        break;
-      case 2:
-        up.set_scale_mode(cen::scale_mode::best);
-        break;
-    }
-
     /* 获取 viewport，如果不存在则使用 default_viewport */
     const viewport* v = s->p_viewport ? s->p_viewport : &default_viewport;
 
     /* 如果 down 不是目标，设置为渲染目标 */
     if (down.get() != renderer.get_target().get()) {
-      renderer.set_target(down);
+      stack.bind(down);
     }
 
     /* 设置绘制区域 */
@@ -109,13 +87,47 @@ struct render<sprite> {
     up.set_alpha_mod(255);
   }
 
-  void run(auto& worker) {
-    cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
-    base::textures& textures = RGMDATA(base::textures);
-    base::renderstack& stack = RGMDATA(base::renderstack);
+  /// @brief 根据 sprite 的属性设置 texture 的混合模式和缩放模式
+  /// @param up sprite 的 bitmap，或者是处理了特效的中间层
+  /// @param s sprite 数据的地址
+  static void setup(cen::texture& up, const sprite* s) {
+    /* 设置混合模式 */
+    switch (s->blend_type) {
+      case 0:
+      default:
+        up.set_blend_mode(cen::blend_mode::blend);
+        break;
+      case 1:
+        up.set_blend_mode(blend_type::add);
+        break;
+      case 2:
+        up.set_blend_mode(blend_type::sub);
+        break;
+    }
 
-    cen::texture& bitmap = textures.at(s->bitmap);
+    /* 设置缩放模式 */
+    switch (s->scale_mode) {
+      case 0:
+      default:
+        up.set_scale_mode(cen::scale_mode::nearest);
+        break;
+      case 1:
+        up.set_scale_mode(cen::scale_mode::linear);
+        break;
+      case 2:
+        up.set_scale_mode(cen::scale_mode::best);
+        break;
+    }
+  }
 
+  /// @brief 计算 sprite 的源矩形和目标矩形，并判断是否需要跳过绘制
+  /// @param s sprite 数据的地址
+  /// @param bitmap sprite 的 bitmap
+  /// @param src_rect 写入源矩形
+  /// @param dst_rect 写入目标矩形
+  /// @return 如果 sprite 完全在 viewport 之外，返回 false
+  [[nodiscard]] static bool layout(const sprite* s, const cen::texture& bitmap,
+                                   cen::irect& src_rect, cen::frect& dst_rect) {
     const rect& r = s->src_rect;
 
     /* src_rect 的 width 和 height 设置为 0 时，使用 bitmap 的尺寸 */
@@ -126,10 +138,10 @@ struct render<sprite> {
     const viewport* v = s->p_viewport ? s->p_viewport : &default_viewport;
 
     /* 设置源矩形和目标矩形 */
-    cen::irect src_rect(r.x, r.y, width, height);
-    const cen::frect dst_rect(s->x - s->ox * s->zoom_x - v->ox,
-                              s->y - s->oy * s->zoom_y - v->oy,
-                              width * s->zoom_x, height * s->zoom_y);
+    src_rect = cen::irect(r.x, r.y, width, height);
+    dst_rect = cen::frect(s->x - s->ox * s->zoom_x - v->ox,
+                          s->y - s->oy * s->zoom_y - v->oy, width * s->zoom_x,
+                          height * s->zoom_y);
 
     /*
      * 根据目标矩形判断是否需要跳过绘制：
@@ -144,20 +156,58 @@ struct render<sprite> {
     constexpr int d = 8;
 
     if (s->angle == 0.0) {
-      if (dst_rect.x() + dst_rect.width() < -d) return;
-      if (dst_rect.y() + dst_rect.height() < -d) return;
-      if (dst_rect.x() > target_width + d) return;
-      if (dst_rect.y() > target_height + d) return;
+      if (dst_rect.x() + dst_rect.width() < -d) return false;
+      if (dst_rect.y() + dst_rect.height() < -d) return false;
+      if (dst_rect.x() > target_width + d) return false;
+      if (dst_rect.y() > target_height + d) return false;
     } else {
       int dx = std::max(std::abs(s->ox), std::abs(width - s->ox)) * s->zoom_x;
       int dy = std::max(std::abs(s->oy), std::abs(height - s->oy)) * s->zoom_y;
       float radius = std::sqrt(dx * dx + dy * dy);
 
-      if (dst_rect.x() + radius < -d) return;
-      if (dst_rect.y() + radius < -d) return;
-      if (dst_rect.x() - radius > target_width + d) return;
-      if (dst_rect.y() - radius > target_height + d) return;
+      if (dst_rect.x() + radius < -d) return false;
+      if (dst_rect.y() + radius < -d) return false;
+      if (dst_rect.x() - radius > target_width + d) return false;
+      if (dst_rect.y() - radius > target_height + d) return false;
     }
+    return true;
+  }
+
+  /// @brief 判断 sprite 是否可以不经过中间层，直接绘制到栈顶
+  /// @param s sprite 数据的地址
+  /// @return 没有 color / bush / tone 特效，且不需要特殊处理减法时返回 true
+  [[nodiscard]] static bool plain(const sprite* s) {
+    const color& c =
+        (s->color.alpha > s->flash_color.alpha) ? s->color : s->flash_color;
+    const tone& t = s->tone;
+
+    if ((c.red != 0) | (c.green != 0) | (c.blue != 0) | (c.alpha != 0)) {
+      return false;
+    }
+    if (s->bush_depth > 0) return false;
+    if ((t.red != 0) | (t.green != 0) | (t.blue != 0) | (t.gray != 0)) {
+      return false;
+    }
+
+    /* OpenGL 的减法需要额外的反色操作 */
+    return !((s->blend_type == 2) && config::opengl);
+  }
+
+  void run(auto& worker) {
+    cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
+    base::textures& textures = RGMDATA(base::textures);
+    base::renderstack& stack = RGMDATA(base::renderstack);
+
+    cen::texture& bitmap = textures.at(s->bitmap);
+
+    /* 设置源矩形和目标矩形，完全在 viewport 之外时跳过绘制 */
+    cen::irect src_rect;
+    cen::frect dst_rect;
+    if (!layout(s, bitmap, src_rect, dst_rect)) return;
+
+    const rect& r = s->src_rect;
+    const int width = src_rect.width();
+    const int height = src_rect.height();
 
     /* 读取 sprite 的各个属性 */
     const color& c =
@@ -171,7 +221,7 @@ struct render<sprite> {
         (t.red != 0) | (t.green != 0) | (t.blue != 0) | (t.gray != 0);
 
     auto process = [&, this](auto& up, auto& down) {
-      this->blend(renderer, up, down, src_rect, dst_rect);
+      this->blend(renderer, stack, up, down, src_rect, dst_rect);
     };
 
     if (use_color | use_bush | use_tone) {
@@ -200,8 +250,7 @@ struct render<sprite> {
 
       /* 应用 color 的效果 */
       if (use_color) {
-        renderer.set_blend_mode(blend_type::color);
-        renderer.fill_with(cen::color(c.red, c.green, c.blue, c.alpha));
+        render_color_helper(c).process(renderer);
       }
 
       /* 还原 src_rect */
@@ -215,4 +264,171 @@ struct render<sprite> {
     }
   }
 };
+
+/// @brief 渲染线程中复用的顶点缓冲区，避免每批 sprite 都重新分配内存
+struct sprite_vertices {
+  std::vector<SDL_Vertex> vertices;
+  std::vector<int> indices;
+};
+
+/// @brief 绘制一批 sprite
+/// 这些 sprite 都满足 render<sprite>::plain，且 bitmap、混合模式、缩放模式
+/// 和 viewport 都相同，可以合并成一次 SDL_RenderGeometry 调用。
+/// 透明度写入顶点的颜色，旋转、翻转和缩放在计算顶点坐标时处理。
+struct render_sprite_batch {
+  /* 引入数据类型 sprite_vertices */
+  using data = std::tuple<sprite_vertices>;
+
+  /// @brief 所有 sprite 数据的地址，按照绘制的顺序排列
+  /// 从逻辑线程的逐帧内存池中分配，不会在每帧产生堆上的分配。
+  std::pmr::vector<const sprite*> sprites;
+
+  void run(auto& worker) {
+    cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
+    base::textures& textures = RGMDATA(base::textures);
+    base::renderstack& stack = RGMDATA(base::renderstack);
+    sprite_vertices& buffer = RGMDATA(sprite_vertices);
+
+    const sprite* first = sprites.front();
+    cen::texture& bitmap = textures.at(first->bitmap);
+
+    const float texture_width = static_cast<float>(bitmap.width());
+    const float texture_height = static_cast<float>(bitmap.height());
+
+    buffer.vertices.clear();
+    buffer.indices.clear();
+
+    for (const sprite* s : sprites) {
+      cen::irect src_rect;
+      cen::frect dst_rect;
+      if (!render<sprite>::layout(s, bitmap, src_rect, dst_rect)) continue;
+
+      /* 纹理坐标，水平翻转时交换左右两边 */
+      float u0 = src_rect.x() / texture_width;
+      float u1 = (src_rect.x() + src_rect.width()) / texture_width;
+      float v0 = src_rect.y() / texture_height;
+      float v1 = (src_rect.y() + src_rect.height()) / texture_height;
+      if (s->mirror) std::swap(u0, u1);
+
+      /* 旋转中心与 SDL_RenderCopyEx 一致，是 dst_rect 内的 (ox, oy) 点 */
+      const float center_x = dst_rect.x() + s->ox;
+      const float center_y = dst_rect.y() + s->oy;
+
+      const float min_x = -s->ox;
+      const float max_x = dst_rect.width() - s->ox;
+      const float min_y = -s->oy;
+      const float max_y = dst_rect.height() - s->oy;
+
+      /* 角度为顺时针方向，与 render<sprite> 中的 -angle 相对应 */
+      constexpr double pi = 3.141592653589793;
+      const double radian = -s->angle * pi / 180.0;
+      const float sin_a = static_cast<float>(std::sin(radian));
+      const float cos_a = static_cast<float>(std::cos(radian));
+
+      const SDL_Color color{255, 255, 255, static_cast<uint8_t>(s->opacity)};
+      auto vertex = [=](float x, float y, float u, float v) {
+        return SDL_Vertex{{cos_a * x - sin_a * y + center_x,
+                           sin_a * x + cos_a * y + center_y},
+                          color,
+                          {u, v}};
+      };
+
+      /* 按照左上、右上、右下、左下的顺序添加 4 个顶点和 2 个三角形 */
+      int base = static_cast<int>(buffer.vertices.size());
+      buffer.vertices.push_back(vertex(min_x, min_y, u0, v0));
+      buffer.vertices.push_back(vertex(max_x, min_y, u1, v0));
+      buffer.vertices.push_back(vertex(max_x, max_y, u1, v1));
+      buffer.vertices.push_back(vertex(min_x, max_y, u0, v1));
+
+      for (int i : {0, 1, 2, 0, 2, 3}) {
+        buffer.indices.push_back(base + i);
+      }
+    }
+    if (buffer.vertices.empty()) return;
+
+    /* 所有 sprite 的状态都相同，只需要设置一次 */
+    render<sprite>::setup(bitmap, first);
+    bitmap.set_alpha_mod(255);
+
+    const viewport* v =
+        first->p_viewport ? first->p_viewport : &default_viewport;
+
+    /* 绘制到栈顶 */
+    cen::texture& down = stack.current();
+    if (down.get() != renderer.get_target().get()) {
+      stack.bind(down);
+    }
+    renderer.set_clip(cen::irect(0, 0, v->rect.width, v->rect.height));
+
+    SDL_RenderGeometry(renderer.get(), bitmap.get(), buffer.vertices.data(),
+                       static_cast<int>(buffer.vertices.size()),
+                       buffer.indices.data(),
+                       static_cast<int>(buffer.indices.size()));
+  }
+};
+
+/// @brief 在逻辑线程中将连续的 sprite 合并成批
+/// Graphics.update 按顺序发送绘制任务，满足 render<sprite>::plain 且状态
+/// 相同的相邻 sprite 会被收集起来，作为一个 render_sprite_batch 发送。
+/// 在发送其他任何绘制任务之前，都必须先调用 flush。
+struct sprite_batcher {
+  /// @brief 当前正在收集的 sprite
+  /// 发送时复制到任务中，此数组的容量在各帧之间复用。
+  std::vector<const sprite*> sprites;
+
+  /// @brief 本帧绘制的 sprite 数量，以及实际发送的绘制任务数量
+  int sprite_count = 0;
+  int batch_count = 0;
+
+  /// @brief 上一帧的统计数据
+  int last_sprite_count = 0;
+  int last_batch_count = 0;
+
+  /// @brief 添加一个 sprite，如果不能与之前的 sprite 合批，则先发送之前的
+  /// @param worker 逻辑线程的 worker
+  /// @param s sprite 数据的地址，必须在渲染线程绘制完之前保持有效
+  void push(auto& worker, const sprite* s) {
+    ++sprite_count;
+
+    if (!render<sprite>::plain(s)) {
+      flush(worker);
+
+      ++batch_count;
+      worker >> render<sprite>{s};
+      return;
+    }
+
+    if (!sprites.empty()) {
+      const sprite* first = sprites.front();
+      if (first->bitmap != s->bitmap || first->blend_type != s->blend_type ||
+          first->scale_mode != s->scale_mode ||
+          first->p_viewport != s->p_viewport) {
+        flush(worker);
+      }
+    }
+    sprites.push_back(s);
+  }
+
+  /// @brief 发送已经收集的 sprite，只有 1 个时按普通的 sprite 发送
+  void flush(auto& worker) {
+    if (sprites.empty()) return;
+
+    ++batch_count;
+    if (sprites.size() == 1) {
+      worker >> render<sprite>{sprites.front()};
+    } else {
+      worker >> render_sprite_batch{std::pmr::vector<const sprite*>(
+                    sprites.begin(), sprites.end(), &worker.arena)};
+    }
+    sprites.clear();
+  }
+
+  /// @brief 一帧结束时调用，保存统计数据并清零
+  void step() {
+    last_sprite_count = sprite_count;
+    last_batch_count = batch_count;
+    sprite_count = 0;
+    batch_count = 0;
+  }
+};
 }  // namespace rgm::rmxp
\ No newline at end of file
@@ -19,15 +19,143 @@
 // 3. This notice may not be removed or altered from any source distribution.
 
 #pragma once
+#include "bitmap.hpp"
 #include "render_base.hpp"
 #include "table.hpp"
 #include "tilemap_manager.hpp"
 
 namespace rgm::rmxp {
+/// @brief tilemap 的一个区块
+/// 区块中的图块按优先级分组，每种优先级的图块预先绘制到一张 texture 上。
+/// 绘制 tilemap 时只需要将区块的 texture 整块或者逐行地贴到画面上，而不必
+/// 逐个图块地绘制。
+struct tilemap_chunk {
+  /// @brief 各优先级的图块绘制成的 texture，key 为优先级
+  std::map<int16_t, cen::texture> layers;
+
+  /// @brief 绘制此区块时，区块的版本号
+  uint32_t revision = 0;
+
+  /// @brief 绘制此区块时，自动元件动画的帧号
+  /// 区块中没有自动元件时为 -1，此时区块不随动画变化。
+  int frame = -1;
+
+  /// @brief 最近一次用到此区块时的 tick
+  uint64_t last_used = 0;
+
+  /// @brief 区块的内容是否有效
+  bool valid = false;
+};
+
+/// @brief 单个 tilemap 的区块缓存
+/// 区块只在以下情况下失效：
+/// 1. 区块内的图块被修改，即 tilemap_info::chunk_revisions 变化
+/// 2. 更换了 tileset 或者 autotiles，或者它们在 bitmap_versions 中的版本
+///    变化，即在 tileset 上绘制或者重新绘制了自动元件
+/// 3. 地图的优先级索引完整地重建了，即 tilemap_info::revision 变化
+/// 4. 区块中有自动元件，且自动元件动画的帧号（update_count / 16）变化
+struct tilemap_chunk_cache {
+  /// @brief 缓存的 texture 数量的上限，超出时移除最久没有用到的区块
+  static constexpr size_t max_textures = 64;
+
+  /// @brief 当前帧用到的 texture 之外，至少再保留的 texture 数量
+  /// 画面较大时可见的 texture 会超过 max_textures，此时上限随之提高，
+  /// 以免在画面边缘来回滚动时反复移除和重新绘制相邻的区块。
+  static constexpr size_t spare_textures = 32;
+
+  /// @brief 绘制区块时使用的 tileset 的 id
+  uint64_t tileset = 0;
+
+  /// @brief 绘制区块时 tileset 的版本
+  uint64_t tileset_version = 0;
+
+  /// @brief 绘制区块时使用的 autotiles 的 id
+  std::vector<uint64_t> autotile_ids;
+
+  /// @brief 绘制区块时各个自动元件的版本
+  /// 绘制区块时使用的是 id + 1 处转换好的自动元件，记录的是它的版本。
+  std::vector<uint64_t> autotile_versions;
+
+  /// @brief 绘制区块时 tilemap_info 的版本号
+  uint32_t revision = 0;
+
+  /// @brief 每帧递增 1，用于判断区块最近是否被用到
+  uint64_t tick = 0;
+
+  /// @brief 缓存的 texture 的总数
+  size_t texture_count = 0;
+
+  /// @brief 所有的区块，key 为区块的编号
+  /// 第 a 行第 b 列的区块编号为 a * tilemap_info::chunk_columns() + b。
+  std::unordered_map<int, tilemap_chunk> chunks;
+
+  /// @brief 绘制区块时收集的图块 {优先级, z, tileid, x, y}
+  /// 每次绘制区块前清空，重复使用已经分配的内存。
+  std::vector<std::tuple<int16_t, int16_t, int16_t, int, int>> tiles;
+
+  /// @brief 检查 tilemap 的整体设置，若有变化则令所有的区块失效
+  void validate(const tilemap& t, const tilemap_info& info,
+                const bitmap_versions& versions) {
+    /* 自动元件的 id 为 0 时表示没有设置 */
+    auto autotile_version = [&versions](uint64_t id) -> uint64_t {
+      return id ? versions.get(id + 1) : 0;
+    };
+
+    bool same = tileset == t.tileset &&
+                tileset_version == versions.get(t.tileset) &&
+                autotile_ids == t.autotiles.m_data &&
+                revision == info.revision;
+    for (size_t i = 0; same && i < autotile_ids.size(); ++i) {
+      same = autotile_versions[i] == autotile_version(autotile_ids[i]);
+    }
+    if (same) return;
+
+    tileset = t.tileset;
+    tileset_version = versions.get(t.tileset);
+    autotile_ids = t.autotiles.m_data;
+    autotile_versions.resize(autotile_ids.size());
+    for (size_t i = 0; i < autotile_ids.size(); ++i) {
+      autotile_versions[i] = autotile_version(autotile_ids[i]);
+    }
+    revision = info.revision;
+
+    for (auto& [key, chunk] : chunks) chunk.valid = false;
+  }
+
+  /// @brief 移除最久没有用到的区块，直到 texture 的数量不超过上限
+  /// 上限取 max_textures 和可见的 texture 数量加上 spare_textures 中的较大
+  /// 者。当前帧用到的区块不会被移除。
+  void shrink() {
+    size_t visible = 0;
+    for (auto& [key, chunk] : chunks) {
+      if (chunk.last_used == tick) visible += chunk.layers.size();
+    }
+    const size_t limit = std::max(max_textures, visible + spare_textures);
+
+    while (texture_count > limit) {
+      auto it = std::min_element(
+          chunks.begin(), chunks.end(), [](auto& a, auto& b) {
+            return a.second.last_used < b.second.last_used;
+          });
+      if (it->second.last_used == tick) break;
+
+      texture_count -= it->second.layers.size();
+      chunks.erase(it);
+    }
+  }
+};
+
+/// @brief 存储所有 tilemap 的区块缓存的类，key 为 tilemap 的 id
+/// 区块缓存在渲染线程中创建和销毁，和 tilemap_info 分开存储。
+using tilemap_chunks = std::unordered_map<uint64_t, tilemap_chunk_cache>;
+
 /// @brief 辅助绘制 tilemap 的类，提供了对图块的迭代等函数
 /// tilemap 本体和 overlayer 的绘制的内容区别很小，主要是根据各图块的优先级
 /// 来决定图块绘制在哪一层。此外，本体那层还需要绘制图块的闪烁。
 struct render_tilemap_helper {
+  /// @brief 区块的边长，以图块为单位
+  static constexpr int chunk_size = tilemap_info::chunk_size;
+
   /// @brief tilemap 数据的地址
   const tilemap* p_tilemap;
 
@@ -38,14 +166,15 @@ struct render_tilemap_helper {
   const table* p_priorities;
 
   /// @brief 管理 tilemap 多层数据的 info 对象的地址
-  const tilemap_info* p_info;
+  /// 渲染时会写入 info 中的 draw_calls。
+  tilemap_info* p_info;
 
   /// @brief 当前绘制的层级
   int layer_index;
 
   /// @brief 构造函数
   explicit render_tilemap_helper(const tilemap* t, const tables* p_tables,
-                                 const tilemap_info* info, int index)
+                                 tilemap_info* info, int index)
       : p_tilemap(t),
         p_map(&p_tables->at(t->map_data)),
         p_priorities(&p_tables->at(t->priorities)),
@@ -57,7 +186,7 @@ struct render_tilemap_helper {
   /// proc 的 4 个参数分别是 x, y, x_index, y_index，代表图块的数据
   /// 其中 x 和 y 是在 viewport 上此图块的左上角坐标，
   /// x_index 和 y_index 是此图块在 tilemap 中的横、纵格子位置。
-  void iterate_tiles(std::function<void(int, int, int, int)> proc) const {
+  void iterate_tiles(auto&& proc) const {
     /* 获取 viewport，如果不存在则使用 default_viewport */
     const viewport* p_viewport =
         p_tilemap->p_viewport ? p_tilemap->p_viewport : &default_viewport;
@@ -119,116 +248,389 @@ struct render_tilemap_helper {
     }
   }
 
-  /// @brief 创建 tilemap 单个图片的 render 函数
+  /// @brief 对画面上可见的区块进行迭代
+  /// @param proc 接受 6 个整型参数的 proc 处理区块的回调
+  /// proc 的 6 个参数分别是 x, y, x_index, y_index, columns, rows。
+  /// 画面上可见的图块被划分成若干个矩形，每个矩形都位于同一个区块内。
+  /// 其中 x 和 y 是在 viewport 上此矩形的左上角坐标，x_index 和 y_index
+  /// 是矩形左上角的图块在 tilemap 中的位置，columns 和 rows 是矩形的列数
+  /// 和行数。同一个区块在地图重复平铺时可能出现多次。
+  void iterate_chunks(auto&& proc) const {
+    /* 地图为空时无需绘制，同时避免对 0 求余数 */
+    if (p_map->x_size == 0 || p_map->y_size == 0) return;
+
+    /* 获取 viewport，如果不存在则使用 default_viewport */
+    const viewport* p_viewport =
+        p_tilemap->p_viewport ? p_tilemap->p_viewport : &default_viewport;
+
+    /* 获取 viewport 的长宽，tilemap 会平铺此 viewport */
+    int width = p_viewport->rect.width;
+    int height = p_viewport->rect.height;
+
+    /* 左上角第一个可能需要绘制的图块，与 iterate_tiles 相同 */
+    int start_x = (-p_viewport->ox - p_tilemap->ox) % 32;
+    if (start_x > 0) start_x -= 32;
+    int start_x_index = (start_x - (-p_viewport->ox - p_tilemap->ox)) / 32;
+
+    int start_y = (-p_viewport->oy - p_tilemap->oy) % 32;
+    if (start_y > 0) start_y -= 32;
+    int start_y_index = (start_y - (-p_viewport->oy - p_tilemap->oy)) / 32;
+
+    /*
+     * 将一个方向上可见的图块划分成若干段，每一段都位于同一个区块内。
+     * 每一段记录为 {坐标, 图块位置, 图块数量}，其中图块位置已经对地图的
+     * 大小求过余数。不重复平铺时，超出地图范围的段被跳过。
+     * 段的数量不超过可见的图块数量，先在栈上的缓冲区中分配，每帧都会调用
+     * 多次，这样可以避免堆上的分配。
+     */
+    std::array<std::byte, 4096> buffer;
+    std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size());
+
+    auto split = [&resource](int start, int start_index, int length, int size,
+                             bool repeat) {
+      std::pmr::vector<std::array<int, 3>> runs(&resource);
+      runs.reserve((length - start) / 32 + 1);
+
+      int position = start;
+      int index = start_index;
+      while (position < length) {
+        int wrapped = index % size;
+        if (wrapped < 0) wrapped += size;
+
+        /* 段不能跨越区块的边界和地图的边界，也不必超出画面 */
+        int count = std::min(chunk_size - wrapped % chunk_size, size - wrapped);
+        count = std::min(count, (length - position + 31) / 32);
+
+        if (repeat || (index >= 0 && index < size)) {
+          runs.push_back({position, wrapped, count});
+        }
+
+        position += count * 32;
+        index += count;
+      }
+      return runs;
+    };
+
+    auto rows = split(start_y, start_y_index, height, p_map->y_size,
+                      p_tilemap->repeat_y);
+    auto columns = split(start_x, start_x_index, width, p_map->x_size,
+                         p_tilemap->repeat_x);
+
+    for (const auto& [y, y_index, n_rows] : rows) {
+      for (const auto& [x, x_index, n_columns] : columns) {
+        proc(x, y, x_index, y_index, n_columns, n_rows);
+      }
+    }
+  }
+
+  /// @brief 检查图块的 tileid 是否能够绘制
+  /// @param tileid 图块的 tileid
+  /// @param x_index 图块在 tilemap 中的横向位置，用于输出日志
+  /// @param y_index 图块在 tilemap 中的纵向位置，用于输出日志
+  /// @return 能够绘制则返回 true
+  [[nodiscard]] bool valid_tile(int16_t tileid, int x_index,
+                                int y_index) const {
+    /* 图块的 tileid = 0 是透明图块，跳过绘制 */
+    if (tileid == 0) return false;
+
+    /*
+     * 图块的 tileid < 0 也跳过绘制。这可能是数据出现了错误。
+     */
+    if (tileid < 0) {
+      cen::log_info(
+          "The tile at <%d, %d> has invalid tileid %d, which should "
+          "greater than or equal to 0.",
+          x_index, y_index, tileid);
+      return false;
+    }
+
+    /*
+     * 图块的 tileid 没有对应的优先级数据也跳过绘制
+     * 这可能是在绘制完地图后，更换了更短的 tileset 导致的。
+     */
+    if (static_cast<size_t>(tileid) >= p_priorities->size()) {
+      cen::log_info(
+          "The tile at <%d, %d> has invalid tileid %d, which should less "
+          "than %lld.",
+          x_index, y_index, tileid, p_priorities->size());
+      return false;
+    }
+    return true;
+  }
+
+  /// @brief 绘制单个图块
   /// @param renderer 渲染器
   /// @param tileset tilemap 使用的图片素材
-  /// @return render 函数，在 iterate_tiles 中调用
-  [[nodiscard]] auto make_render_proc(cen::renderer& renderer,
-                                      const cen::texture& tileset) const
-      -> std::function<void(int, int, int, int)> {
-    /* render 的 4 个参数的含义详见 iterate_tiles */
-    auto render = [&](int x, int y, int x_index, int y_index) {
-      /* 目标矩形，代表图块将绘制到 viewport 上的位置 */
-      cen::irect dst_rect(x, y, 32, 32);
-
-      /* 源矩形，代表图块在 tileset 上或者 autotiles 上的位置 */
-      cen::irect src_rect(0, 0, 32, 32);
-
-      /* 对 tilemap 的全部层依次处理 */
-      for (int z_index = 0; z_index < p_map->z_size; ++z_index) {
-        /* 获取图块的 tileid */
-        const int16_t tileid = p_map->get(x_index, y_index, z_index);
-
-        /* 图块的 tileid = 0 是透明图块，跳过绘制 */
-        if (tileid == 0) continue;
-
-        /*
-         * 图块的 tileid < 0 也跳过绘制。这可能是数据出现了错误。
-         */
-        if (tileid < 0) {
-          cen::log_info(
-              "The tile at <%d, %d> has invalid tileid %d, which should "
-              "greater than or equal to 0.",
-              x_index, y_index);
-          continue;
-        }
+  /// @param tileid 图块的 tileid，必须是有效的值
+  /// @param dst_rect 图块绘制的目标矩形
+  void render_tile(cen::renderer& renderer, const cen::texture& tileset,
+                   int16_t tileid, const cen::irect& dst_rect) const {
+    /* 源矩形，代表图块在 tileset 上或者 autotiles 上的位置 */
+    cen::irect src_rect(0, 0, 32, 32);
+
+    if (tileid >= 384) {
+      /* 普通图块的场合，从 tileset 上提取 */
+      int x = tileid % 8 * 32;
+      int y = (tileid - 384) / 8 * 32;
+
+      /*
+       * texture 的长和宽是有限的，一般是 16384 或者 32768。为了支持更大的
+       * tileset，实际操作中以 config::tileset_texture_height = 8192 为
+       * 单位进行分割。然后横向拼接起来。分割的这部分工作使用了 Palette 类，
+       * 在 ruby 中执行，参考 ./src/scripts/rpgcache.rb。
+       *
+       * 比如说一个高 30000，宽 256 的 tileset，对应的 texture 大小应该是高
+       * 8192，宽 1024。由于 tileid 是 int16_t，最大不超过 32767，那么最终
+       * 拼合而成的 texture 宽度也不会超过 4096，就不会超出图块大小限制。
+       */
+      x = x + 256 * (y / config::tileset_texture_height);
+      y = y % config::tileset_texture_height;
+      src_rect.set_position(x, y);
+
+      renderer.render(tileset, src_rect, dst_rect);
+      ++p_info->draw_calls;
+    } else {
+      /* 自动元件的场合，从 autotiles 上提取 */
+
+      /* 查找此图块使用的 autotile */
+      size_t autotile_index = tileid / 48 - 1;
+      const cen::texture* p_autotile =
+          p_info->autotile_textures.at(autotile_index);
+
+      /* autotile 不存在的情况下，跳过绘制 */
+      if (!p_autotile) return;
+
+      /* 实现 autotile 的动画效果 */
+      int x = (p_tilemap->update_count / 16 * 32) % p_autotile->width();
+
+      /*
+       * 对于高度为 32 的单行 autotile，只存在一种模式。
+       * 否则，根据不同的 tileid 绘制不同的模式。
+       */
+      int y = (p_autotile->height() == 32) ? 0 : tileid % 48 * 32;
+
+      src_rect.set_position(x, y);
+
+      renderer.render(*p_autotile, src_rect, dst_rect);
+      ++p_info->draw_calls;
+    }
+  }
 
-        /*
-         * 图块的 tileid 没有对应的优先级数据也跳过绘制
-         * 这可能是在绘制完地图后，更换了更短的 tileset 导致的。
-         */
-        if (static_cast<size_t>(tileid) >= p_priorities->size()) {
-          cen::log_info(
-              "The tile at <%d, %d> has invalid tileid %d, which should less "
-              "than %lld.",
-              x_index, y_index, p_priorities->size());
-          continue;
-        }
+  /// @brief 重新绘制一个区块
+  /// @param renderer 渲染器
+  /// @param stack 渲染栈，用于创建空白的 texture
+  /// @param tileset tilemap 使用的图片素材
+  /// @param cache 区块所属的区块缓存
+  /// @param chunk 需要重新绘制的区块
+  /// @param x_chunk 区块的横向位置
+  /// @param y_chunk 区块的纵向位置
+  /// 区块中每种出现的优先级对应一张 texture，图块绘制在 texture 上相对于
+  /// 区块左上角的位置。绘制完成后 renderer 的 target 不会还原。
+  void compose_chunk(cen::renderer& renderer, base::renderstack& stack,
+                     const cen::texture& tileset, tilemap_chunk_cache& cache,
+                     tilemap_chunk& chunk, int x_chunk, int y_chunk) const {
+    /* 区块在地图中的范围，地图边缘的区块可能不完整 */
+    const int x_begin = x_chunk * chunk_size;
+    const int y_begin = y_chunk * chunk_size;
+    const int x_end = std::min(x_begin + chunk_size, p_map->x_size);
+    const int y_end = std::min(y_begin + chunk_size, p_map->y_size);
+
+    /*
+     * 收集区块中所有需要绘制的图块，记录为 {优先级, z, tileid, x, y}。
+     * 按优先级排序，优先级相同时按 z 排序，从而同一格子内相同优先级的
+     * 图块仍然按照 z 的顺序绘制。优先级和 z 都相同的图块位于不同的格子，
+     * 互不重叠，不需要稳定排序。
+     */
+    auto& tiles = cache.tiles;
+    tiles.clear();
 
-        /* 获取此图块的优先级数据 */
-        const int16_t priority = p_priorities->get(tileid);
-
-        /* priority 需要和 layer_index 等匹配，否则此图块应在其他层绘制 */
-        if (layer_index == 0 && priority != 0) continue;
-
-        if (layer_index > 0 && priority != layer_index - y_index) continue;
-
-        if (tileid >= 384) {
-          /* 普通图块的场合，从 tileset 上提取 */
-          int x = tileid % 8 * 32;
-          int y = (tileid - 384) / 8 * 32;
-
-          /*
-           * texture 的长和宽是有限的，一般是 16384 或者 32768。为了支持更大的
-           * tileset，实际操作中以 config::tileset_texture_height = 8192 为
-           * 单位进行分割。然后横向拼接起来。分割的这部分工作使用了 Palette 类，
-           * 在 ruby 中执行，参考 ./src/scripts/rpgcache.rb。
-           *
-           * 比如说一个高 30000，宽 256 的 tileset，对应的 texture 大小应该是高
-           * 8192，宽 1024。由于 tileid 是 int16_t，最大不超过 32767，那么最终
-           * 拼合而成的 texture 宽度也不会超过 4096，就不会超出图块大小限制。
-           */
-          x = x + 256 * (y / config::tileset_texture_height);
-          y = y % config::tileset_texture_height;
-          src_rect.set_position(x, y);
-
-          renderer.render(tileset, src_rect, dst_rect);
-        } else {
-          /* 自动元件的场合，从 autotiles 上提取 */
-
-          /* 查找此图块使用的 autotile */
-          size_t autotile_index = tileid / 48 - 1;
-          const cen::texture* p_autotile =
-              p_info->autotile_textures.at(autotile_index);
-
-          /* autotile 不存在的情况下，跳过绘制 */
-          if (!p_autotile) continue;
-
-          /* 实现 autotile 的动画效果 */
-          int x = (p_tilemap->update_count / 16 * 32) % p_autotile->width();
-
-          /*
-           * 对于高度为 32 的单行 autotile，只存在一种模式。
-           * 否则，根据不同的 tileid 绘制不同的模式。
-           */
-          int y = (p_autotile->height() == 32) ? 0 : tileid % 48 * 32;
-
-          src_rect.set_position(x, y);
-
-          renderer.render(*p_autotile, src_rect, dst_rect);
+    bool has_autotile = false;
+    for (int z_index = 0; z_index < p_map->z_size; ++z_index) {
+      for (int y_index = y_begin; y_index < y_end; ++y_index) {
+        for (int x_index = x_begin; x_index < x_end; ++x_index) {
+          const int16_t tileid = p_map->get(x_index, y_index, z_index);
+
+          if (!valid_tile(tileid, x_index, y_index)) continue;
+          if (tileid < 384) has_autotile = true;
+
+          tiles.emplace_back(p_priorities->get(tileid), z_index, tileid,
+                             (x_index - x_begin) * 32,
+                             (y_index - y_begin) * 32);
         }
       }
+    }
+    std::sort(tiles.begin(), tiles.end(), [](auto& a, auto& b) {
+      return std::tie(std::get<0>(a), std::get<1>(a)) <
+             std::tie(std::get<0>(b), std::get<1>(b));
+    });
+
+    /* 移除区块中不再出现的优先级对应的 texture */
+    auto absent = [&](const auto& item) {
+      auto it = std::find_if(tiles.begin(), tiles.end(), [&](auto& tile) {
+        return std::get<0>(tile) == item.first;
+      });
+      if (it != tiles.end()) return false;
+
+      --cache.texture_count;
+      return true;
+    };
+    std::erase_if(chunk.layers, absent);
+
+    /* 逐个绘制图块，切换优先级时切换绘制目标 */
+    const cen::texture* p_target = nullptr;
+    for (const auto& [priority, z, tileid, x, y] : tiles) {
+      auto it = chunk.layers.find(priority);
+
+      if (it == chunk.layers.end()) {
+        /* 新出现的优先级，创建一张新的 texture */
+        cen::texture layer = stack.make_empty_texture(chunk_size * 32,
+                                                      chunk_size * 32);
+        it = chunk.layers.emplace(priority, std::move(layer)).first;
+        ++cache.texture_count;
+      }
+
+      cen::texture& layer = it->second;
+      if (p_target != &layer) {
+        p_target = &layer;
+
+        renderer.set_target(layer);
+        renderer.reset_clip();
+        renderer.set_blend_mode(cen::blend_mode::none);
+        renderer.clear_with(cen::colors::transparent);
+      }
+
+      render_tile(renderer, tileset, tileid, cen::irect(x, y, 32, 32));
+    }
+
+    /*
+     * 图块以 alpha 叠加的方式绘制在透明的 texture 上，颜色已经乘过透明度，
+     * 故区块使用 blend2 混合模式绘制，与直接逐个绘制图块的效果相同。
+     */
+    for (auto& [priority, layer] : chunk.layers) {
+      layer.set_blend_mode(blend_type::blend2);
+    }
+
+    chunk.frame = has_autotile ? (p_tilemap->update_count / 16) : -1;
+  }
+
+  /// @brief 更新区块缓存，重新绘制画面上可见的失效区块
+  /// @param renderer 渲染器
+  /// @param stack 渲染栈
+  /// @param tileset tilemap 使用的图片素材
+  /// @param cache 此 tilemap 的区块缓存
+  /// @param versions 各个 Bitmap 的版本，用于判断素材是否被修改
+  /// 每帧只在绘制第 0 层之前调用一次，其余各层使用相同的区块。
+  void update_chunks(cen::renderer& renderer, base::renderstack& stack,
+                     const cen::texture& tileset, tilemap_chunk_cache& cache,
+                     const bitmap_versions& versions) const {
+    cache.validate(*p_tilemap, *p_info, versions);
+    ++cache.tick;
+
+    const int columns = p_info->chunk_columns();
+    const int frame = p_tilemap->update_count / 16;
+
+    bool composed = false;
+    auto update = [&](int, int, int x_index, int y_index, int, int) {
+      const int x_chunk = x_index / chunk_size;
+      const int y_chunk = y_index / chunk_size;
+      const int key = y_chunk * columns + x_chunk;
+
+      tilemap_chunk& chunk = cache.chunks[key];
+      chunk.last_used = cache.tick;
+
+      /* 检查区块是否仍然有效 */
+      const uint32_t revision = p_info->chunk_revisions.at(key);
+      if (chunk.valid && chunk.revision == revision &&
+          (chunk.frame < 0 || chunk.frame == frame))
+        return;
+
+      compose_chunk(renderer, stack, tileset, cache, chunk, x_chunk, y_chunk);
+      chunk.revision = revision;
+      chunk.valid = true;
+      composed = true;
     };
-    return render;
+    iterate_chunks(update);
+
+    cache.shrink();
+
+    /* 还原 target 为渲染栈的栈顶 */
+    if (composed) stack.bind(stack.current());
+  }
+
+  /// @brief 将区块中属于当前 layer 的部分绘制到画面上
+  /// @param renderer 渲染器
+  /// @param cache 此 tilemap 的区块缓存
+  /// 第 0 层每个可见的矩形只需要贴图一次，其他层每行各贴图一次，
+  /// 并利用优先级数据概况跳过不需要绘制的行。
+  void render_chunks(cen::renderer& renderer,
+                     const tilemap_chunk_cache& cache) const {
+    const int columns = p_info->chunk_columns();
+
+    /* render 的 6 个参数的含义详见 iterate_chunks */
+    auto render = [&](int x, int y, int x_index, int y_index, int n_columns,
+                      int n_rows) {
+      const int key = y_index / chunk_size * columns + x_index / chunk_size;
+
+      auto it = cache.chunks.find(key);
+      if (it == cache.chunks.end()) return;
+      const tilemap_chunk& chunk = it->second;
+
+      /* 矩形左上角在区块的 texture 上的坐标 */
+      const int src_x = x_index % chunk_size * 32;
+      const int src_y = y_index % chunk_size * 32;
+
+      if (layer_index == 0) {
+        auto layer = chunk.layers.find(0);
+        if (layer == chunk.layers.end()) return;
+
+        cen::irect src_rect(src_x, src_y, n_columns * 32, n_rows * 32);
+        cen::irect dst_rect(x, y, n_columns * 32, n_rows * 32);
+        renderer.render(layer->second, src_rect, dst_rect);
+        ++p_info->draw_calls;
+        return;
+      }
+
+      for (int i = 0; i < n_rows; ++i) {
+        /* 第 y_index + i 行的图块只有一种优先级属于当前层 */
+        const int priority = layer_index - (y_index + i);
+        if (p_info->skip_row(y_index + i, priority)) continue;
+
+        auto layer = chunk.layers.find(static_cast<int16_t>(priority));
+        if (layer == chunk.layers.end()) continue;
+
+        cen::irect src_rect(src_x, src_y + i * 32, n_columns * 32, 32);
+        cen::irect dst_rect(x, y + i * 32, n_columns * 32, 32);
+        renderer.render(layer->second, src_rect, dst_rect);
+        ++p_info->draw_calls;
+      }
+    };
+    iterate_chunks(render);
   }
 };
 
+/// @brief 数据类 tilemap_chunks 相关的初始化类
+struct init_tilemap_chunks {
+  using data = std::tuple<tilemap_chunks>;
+
+  static void after(auto& worker) { RGMDATA(tilemap_chunks).clear(); }
+};
+
+/// @brief 任务：释放 tilemap 的区块缓存
+/// 在 tilemap 释放时由 drawable_dispose 发送。
+struct tilemap_release_chunks {
+  /// @brief tilemap 的 id
+  uint64_t id;
+
+  void run(auto& worker) { RGMDATA(tilemap_chunks).erase(id); }
+};
+
 /// @brief 绘制 tilemap
 /// tilemap 的不同层都在这里绘制，只是第 0 层需要绘制闪烁效果。
+/// 图块预先绘制到区块缓存中，各层从区块中取出相应的部分绘制到画面上。
 template <>
 struct render<overlayer<tilemap>> {
   /// @brief 管理 tilemap 多层数据的 info 对象的地址
-  const tilemap_info* info;
+  tilemap_info* info;
 
   /// @brief 管理所有 table 的容器的指针。
   const tables* p_tables;
@@ -244,6 +646,9 @@ struct render<overlayer<tilemap>> {
     /* 获取 tilemap 的数据 */
     const tilemap* t = info->p_tilemap;
 
+    /* 获取此 tilemap 的区块缓存 */
+    tilemap_chunk_cache& cache = RGMDATA(tilemap_chunks)[info->tilemap_id];
+
     /* 获取 viewport，如果不存在则使用 default_viewport */
     const viewport* p_viewport =
         t->p_viewport ? t->p_viewport : &default_viewport;
@@ -252,30 +657,27 @@ struct render<overlayer<tilemap>> {
     int width = p_viewport->rect.width;
     int height = p_viewport->rect.height;
 
-    /* z > 0 的层处理相对简单，直接绘制到 viewport 上 */
-    if (layer_index > 0) {
-      /* 创建 render_tilemap_helper 对象辅助绘制 */
-      render_tilemap_helper helper(t, p_tables, info, layer_index);
-
-      cen::texture& tileset = textures.at(t->tileset);
-      auto render = helper.make_render_proc(renderer, tileset);
+    /* 创建 render_tilemap_helper 对象辅助绘制 */
+    render_tilemap_helper helper(t, p_tables, info, layer_index);
 
-      /* 逐个绘制图块 */
-      helper.iterate_tiles(render);
+    /* z > 0 的层处理相对简单，直接从区块中绘制到 viewport 上 */
+    if (layer_index > 0) {
+      helper.render_chunks(renderer, cache);
       return;
     }
 
-    /* 添加一个中间层 */
-    stack.push_empty_layer(width, height);
-
-    /* 创建 render_tilemap_helper 对象辅助绘制 */
-    render_tilemap_helper helper(t, p_tables, info, layer_index);
+    /* 第 0 层是每帧最先绘制的层，在此重置计数并更新区块缓存 */
+    info->draw_calls = 0;
 
     cen::texture& tileset = textures.at(t->tileset);
-    auto render = helper.make_render_proc(renderer, tileset);
+    helper.update_chunks(renderer, stack, tileset, cache,
+                         RGMDATA(bitmap_versions));
+
+    /* 添加一个中间层 */
+    stack.push_empty_layer(width, height);
 
-    /* 逐个绘制图块 */
-    helper.iterate_tiles(render);
+    /* 从区块中绘制第 0 层的图块 */
+    helper.render_chunks(renderer, cache);
 
     /* 处理闪烁的效果 */
     if (t->flash_data) {
@@ -312,7 +714,7 @@ struct render<overlayer<tilemap>> {
       cen::irect rect(0, 0, width, height);
 
       /* 设置绘制目标和区域 */
-      renderer.set_target(down);
+      stack.bind(down);
       renderer.set_clip(rect);
 
       /* 设置透明度 */
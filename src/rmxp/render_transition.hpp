@@ -22,6 +22,116 @@
 #include "render_base.hpp"
 
 namespace rgm::rmxp {
+/// @brief 渐变的缓存数据
+/// 渐变图缩放到画面大小后只保留红色分量，作为 8 位的透明度数据缓存起来，
+/// 同一张渐变图只需要解码一次。software 渲染器在渐变开始时读取 freeze 和
+/// current 的像素，之后每帧只在 CPU 上计算透明度并混合，再更新到画面上，
+/// 渐变过程中不会再分配内存。
+struct transition_cache {
+  /// @brief 最多缓存的渐变图数量
+  static constexpr size_t max_size = 8;
+
+  /// @brief 缩放到画面大小的渐变图
+  struct mask {
+    uint64_t id;
+    int width;
+    int height;
+    std::vector<uint8_t> data;
+  };
+
+  /// @brief 缓存的渐变图，按使用的先后顺序排列
+  std::vector<mask> masks;
+
+  /// @brief 当前读取的 freeze 和 current 的 id
+  uint64_t freeze_id = 0;
+  uint64_t current_id = 0;
+
+  /// @brief 画面的宽度和高度
+  int width = 0;
+  int height = 0;
+
+  /* 像素和透明度的缓冲区 */
+  std::vector<uint32_t> freeze;
+  std::vector<uint32_t> current;
+  std::vector<uint32_t> output;
+  std::vector<uint8_t> alpha;
+
+  /// @brief 将 texture 的全部像素读取到 pixels 中
+  static void read(cen::renderer& renderer, cen::texture& texture,
+                   std::vector<uint32_t>& pixels) {
+    pixels.resize(static_cast<size_t>(texture.width()) * texture.height());
+
+    renderer.set_target(texture);
+    SDL_RenderReadPixels(renderer.get(), nullptr,
+                         static_cast<uint32_t>(config::texture_format),
+                         pixels.data(), texture.width() * 4);
+  }
+
+  /// @brief 读取 freeze 和 current 的像素
+  void load(cen::renderer& renderer, uint64_t freeze_id_, cen::texture& f,
+            uint64_t current_id_, cen::texture& c) {
+    freeze_id = freeze_id_;
+    current_id = current_id_;
+    width = std::min(f.width(), c.width());
+    height = std::min(f.height(), c.height());
+
+    read(renderer, f, freeze);
+    read(renderer, c, current);
+
+    /* 两者大小不同时，按较小的尺寸重新排列 */
+    auto crop = [this](std::vector<uint32_t>& pixels, int pitch) {
+      if (pitch == width) return;
+      for (int y = 0; y < height; ++y) {
+        std::copy_n(pixels.begin() + y * pitch, width,
+                    pixels.begin() + y * width);
+      }
+    };
+    crop(freeze, f.width());
+    crop(current, c.width());
+
+    output.resize(static_cast<size_t>(width) * height);
+    alpha.resize(static_cast<size_t>(width) * height);
+  }
+
+  /// @brief 查找渐变图，不存在时解码并缩放到画面大小
+  const std::vector<uint8_t>& find(cen::renderer& renderer, uint64_t id,
+                                   cen::texture& texture) {
+    auto it = std::find_if(masks.begin(), masks.end(), [&](const mask& m) {
+      return m.id == id && m.width == width && m.height == height;
+    });
+
+    /* 命中时移动到末尾，表示最近使用过 */
+    if (it != masks.end()) {
+      std::rotate(it, it + 1, masks.end());
+      return masks.back().data;
+    }
+
+    if (masks.size() >= max_size) masks.erase(masks.begin());
+
+    std::vector<uint32_t> pixels;
+    read(renderer, texture, pixels);
+
+    /* 最近邻缩放，只保留红色分量 */
+    const int w = texture.width();
+    const int h = texture.height();
+    mask& m = masks.emplace_back(mask{id, width, height, {}});
+    m.data.resize(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+      const size_t src_y = static_cast<size_t>(y * h / height);
+      const uint32_t* row = pixels.data() + src_y * w;
+      for (int x = 0; x < width; ++x) {
+        m.data[y * width + x] = (row[x * w / width] >> 16) & 255;
+      }
+    }
+    return m.data;
+  }
+};
+
+/// @brief 数据类 transition_cache 相关的初始化类
+struct init_transition {
+  using data = std::tuple<transition_cache>;
+};
+
 /// @brief 执行渐变绘制的任务，有多种不同的特化方式。
 /// @tparam size_t 绘制方式
 template <size_t>
@@ -96,6 +206,43 @@ struct render_transition<2> {
     /* 获取渐变图对应的 Bitmap */
     cen::texture& transition = textures.at(transition_id);
 
+    if (config::driver == config::driver_type::software) {
+      transition_cache& cache = RGMDATA(transition_cache);
+
+      /* 渐变的第一帧读取 freeze 和 current，freeze 和 current 会被复用，
+       * 所以不能只比较 id */
+      if (rate == 0 || cache.freeze_id != freeze_id ||
+          cache.current_id != current_id) {
+        cache.load(renderer, freeze_id, freeze, current_id, current);
+      }
+      const std::vector<uint8_t>& mask =
+          cache.find(renderer, transition_id, transition);
+
+      const int width = cache.width;
+      const int threshold = static_cast<int>(std::lround(rate * 255));
+      base::band_pool::instance().run(
+          cache.height, width, [&](int begin, int end) {
+            const size_t offset = static_cast<size_t>(begin) * width;
+            const int n = (end - begin) * width;
+
+            base::surface_kernel::ramp(cache.alpha.data() + offset,
+                                       mask.data() + offset, n, threshold,
+                                       vague);
+            base::surface_kernel::mix(
+                cache.output.data() + offset, cache.freeze.data() + offset,
+                cache.current.data() + offset, cache.alpha.data() + offset, n);
+          });
+
+      /* 将混合的结果更新到画面上 */
+      cen::texture& screen = stack.current();
+      const SDL_Rect rect{0, 0, std::min(width, screen.width()),
+                          std::min(cache.height, screen.height())};
+      SDL_UpdateTexture(screen.get(), &rect, cache.output.data(), width * 4);
+
+      renderer.set_target(stack.current());
+      return;
+    }
+
     /* 使用 shader 修改 freeze 每个像素的透明度 */
     if (rate > 0) {
       transition.set_blend_mode(blend_type::alpha);
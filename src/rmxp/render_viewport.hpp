@@ -22,7 +22,25 @@
 #include "render_base.hpp"
 
 namespace rgm::rmxp {
+/// @brief 判断 viewport 是否需要后期处理，即存在 tone、color 或 flash 的效果
+/// @param v viewport 数据的地址
+/// @return 需要后期处理时返回 true，此时 viewport 的内容需要绘制到单独的层上
+[[nodiscard]] inline bool viewport_has_effect(const viewport* v) {
+  const color& c =
+      (v->color.alpha > v->flash_color.alpha) ? v->color : v->flash_color;
+  const tone& t = v->tone;
+
+  const bool use_color =
+      (c.red != 0) | (c.green != 0) | (c.blue != 0) | (c.alpha != 0);
+  const bool use_tone =
+      (t.red != 0) | (t.green != 0) | (t.blue != 0) | (t.gray != 0);
+
+  return use_color | use_tone;
+}
+
 /// @brief 任务：渲染 Viewport 中内容之前的处理
+/// 没有后期处理的 viewport 直接绘制到下层的对应区域，
+/// 否则复制下层的对应区域作为新的层，绘制完毕后再合并回去。
 struct before_render_viewport {
   /// @brief viewport 数据的地址
   const viewport* v;
@@ -30,6 +48,12 @@ struct before_render_viewport {
   void run(auto& worker) {
     base::renderstack& stack = RGMDATA(base::renderstack);
 
+    if (!viewport_has_effect(v)) {
+      /* 设置直接绘制的区域，不需要新的层 */
+      stack.push_region(v->rect.x, v->rect.y, v->rect.width, v->rect.height);
+      return;
+    }
+
     /* 向 renderstack 添加新的空层 */
     stack.push_capture_layer(v->rect.x, v->rect.y, v->rect.width,
                              v->rect.height);
@@ -46,9 +70,16 @@ struct after_render_viewport {
     cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
     base::renderstack& stack = RGMDATA(base::renderstack);
 
-    auto process = [&renderer, this](cen::texture& up, cen::texture& down) {
+    /* 直接绘制的场合，还原视口即可 */
+    if (stack.region) {
+      stack.pop_region();
+      return;
+    }
+
+    auto process = [&renderer, &stack, this](cen::texture& up,
+                                            cen::texture& down) {
       /* 设置绘制目标为下层 */
-      renderer.set_target(down);
+      stack.bind(down);
 
       /* 读取 viewport 的各个属性 */
       const rect& r = v->rect;
@@ -72,9 +103,7 @@ struct after_render_viewport {
 
       /* 应用 color 的效果 */
       if (use_color) {
-        renderer.set_blend_mode(blend_type::color);
-        renderer.set_color(cen::color(c.red, c.green, c.blue, c.alpha));
-        renderer.fill_rect(dst_rect);
+        render_color_helper(c, &dst_rect).process(renderer);
       }
     };
 
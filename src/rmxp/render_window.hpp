@@ -19,32 +19,104 @@
 // 3. This notice may not be removed or altered from any source distribution.
 
 #pragma once
+#include "bitmap.hpp"
 #include "render_base.hpp"
 
 namespace rgm::rmxp {
+/// @brief 缓存的窗口背景
+struct window_skin {
+  /// @brief 绘制好的窗口背景，包括背景图和边框
+  cen::texture texture;
+
+  /// @brief 最后一次使用时的序号，用于淘汰最久未使用的缓存
+  uint64_t last_used;
+};
+
+/// @brief 窗口背景的缓存
+/// 窗口背景只取决于 windowskin 的内容、尺寸、back_opacity 和 stretch，对于静态的
+/// 菜单，每帧重新拼接数十次 renderer.render 是不必要的。相同参数的窗口
+/// 共享同一个缓存，参数变化时才重新绘制。
+struct window_skins {
+  /// @brief 缓存的数量上限，超过时淘汰最久未使用的缓存
+  static constexpr size_t max_size = 32;
+
+  /// @brief {windowskin, skin 的版本, 宽, 高, back_opacity, stretch}
+  /// 记录 bitmap_versions 中的版本，在 windowskin 被修改（如 blt、fill_rect）
+  /// 或者被释放并重新创建后使缓存失效。
+  using key_t = std::tuple<uint64_t, uint64_t, int, int, int, bool>;
+
+  /// @brief 所有的缓存
+  std::map<key_t, window_skin> m_data;
+
+  /// @brief 当前的序号，每次查询缓存时递增
+  uint64_t tick = 0;
+
+  /// @brief 查询缓存的命中和未命中次数
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+
+  /// @brief 当前帧绘制 window 时调用 renderer.render 的次数
+  uint64_t draw_calls = 0;
+
+  /// @brief 上一帧的 draw_calls
+  uint64_t last_draw_calls = 0;
+
+  /// @brief 一帧开始时调用，保存上一帧的 draw_calls 并清零
+  void step() {
+    last_draw_calls = draw_calls;
+    draw_calls = 0;
+  }
+
+  /// @brief 在缓存数量超出上限时，淘汰最久未使用的缓存
+  void shrink() {
+    while (m_data.size() > max_size) {
+      auto it = std::min_element(
+          m_data.begin(), m_data.end(), [](const auto& a, const auto& b) {
+            return a.second.last_used < b.second.last_used;
+          });
+      m_data.erase(it);
+    }
+  }
+};
+
+/// @brief 数据类 window_skins 相关的初始化类
+struct init_window_skins {
+  using data = std::tuple<window_skins>;
+
+  static void after(auto& worker) { RGMDATA(window_skins).m_data.clear(); }
+};
+
+/// @brief 任务：进入下一帧，保存 window 的绘制次数
+struct window_skins_step {
+  void run(auto& worker) { RGMDATA(window_skins).step(); }
+};
+
 /// @brief 绘制 window 的窗口背景层
 /// window 有 2 层，分别是窗口背景和窗口内容，窗口内容的 z 值多 2，
 /// 在 overlayer<window> 中绘制。以下内容也在 overlayer 层中绘制：
 /// 滚动标记、暂停标记和 cursor_rect。
+/// 窗口背景绘制一次后缓存在 window_skins 中，之后每帧只需绘制 1 次。
 template <>
 struct render<window> {
   /// @brief window 数据的地址
   const window* w;
 
-  void run(auto& worker) {
-    cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
-    base::textures& textures = RGMDATA(base::textures);
-    base::renderstack& stack = RGMDATA(base::renderstack);
-
-    /* 获取窗口皮肤对应的 Bitmap */
-    cen::texture& skin = textures.at(w->windowskin);
+  /// @brief 将窗口背景绘制到当前的渲染目标上
+  /// @param renderer 渲染器
+  /// @param skin 窗口皮肤对应的 Bitmap
+  /// @param skins 记录 renderer.render 的次数
+  /// 渲染目标的内容需要预先清空。
+  void draw_skin(cen::renderer& renderer, cen::texture& skin,
+                 window_skins& skins) const {
+    /* 调用 renderer.render 并计入 window 的绘制次数 */
+    auto render = [&](auto&&... args) {
+      renderer.render(std::forward<decltype(args)>(args)...);
+      ++skins.draw_calls;
+    };
 
     const int width = w->width;
     const int height = w->height;
 
-    /* 添加一个中间层 */
-    stack.push_empty_layer(width, height);
-
     /* 1. 绘制背景图（拉伸或者平铺）*/
     if (w->back_opacity > 0) {
       /* 最外部的一圈像素点不受影响 */
@@ -57,14 +129,14 @@ struct render<window> {
 
       if (w->stretch) {
         /* 拉伸 */
-        renderer.render(skin, src_rect, cen::irect(0, 0, width, height));
+        render(skin, src_rect, cen::irect(0, 0, width, height));
       } else {
         /* 平铺 */
         cen::irect dst_rect(0, 0, 128, 128);
         for (int x = 0; x < width; x += 128) {
           for (int y = 0; y < height; y += 128) {
             dst_rect.set_position({x, y});
-            renderer.render(skin, src_rect, dst_rect);
+            render(skin, src_rect, dst_rect);
           }
         }
       }
@@ -84,7 +156,7 @@ struct render<window> {
     dst_rect = cen::irect(0, 0, 32, 16);
     for (int x = 0; x < width; x += 32) {
       dst_rect.set_x(x);
-      renderer.render(skin, src_rect, dst_rect);
+      render(skin, src_rect, dst_rect);
     }
 
     /* 下边 */
@@ -92,7 +164,7 @@ struct render<window> {
     dst_rect = cen::irect(0, height - 16, 32, 16);
     for (int x = 0; x < width; x += 32) {
       dst_rect.set_x(x);
-      renderer.render(skin, src_rect, dst_rect);
+      render(skin, src_rect, dst_rect);
     }
 
     /* 左边 */
@@ -101,7 +173,7 @@ struct render<window> {
     dst_rect = cen::irect(0, 0, 16, 32);
     for (int y = 0; y < height; y += 32) {
       dst_rect.set_y(y);
-      renderer.render(skin, src_rect, dst_rect);
+      render(skin, src_rect, dst_rect);
     }
 
     /* 右边 */
@@ -109,29 +181,69 @@ struct render<window> {
     dst_rect = cen::irect(width - 16, 0, 16, 32);
     for (int y = 0; y < height; y += 32) {
       dst_rect.set_y(y);
-      renderer.render(skin, src_rect, dst_rect);
+      render(skin, src_rect, dst_rect);
     }
 
     /* 边框四角 */
     renderer.reset_clip();
     /* 左上角 */
-    renderer.render(skin, cen::irect(128, 0, 16, 16), cen::irect(0, 0, 16, 16));
+    render(skin, cen::irect(128, 0, 16, 16), cen::irect(0, 0, 16, 16));
     /* 右上角 */
-    renderer.render(skin, cen::irect(128 + 64 - 16, 0, 16, 16),
-                    cen::irect(width - 16, 0, 16, 16));
+    render(skin, cen::irect(128 + 64 - 16, 0, 16, 16),
+           cen::irect(width - 16, 0, 16, 16));
     /* 左下角 */
-    renderer.render(skin, cen::irect(128, 64 - 16, 16, 16),
-                    cen::irect(0, height - 16, 16, 16));
+    render(skin, cen::irect(128, 64 - 16, 16, 16),
+           cen::irect(0, height - 16, 16, 16));
     /* 右下角 */
-    renderer.render(skin, cen::irect(128 + 64 - 16, 64 - 16, 16, 16),
-                    cen::irect(width - 16, height - 16, 16, 16));
+    render(skin, cen::irect(128 + 64 - 16, 64 - 16, 16, 16),
+           cen::irect(width - 16, height - 16, 16, 16));
+  }
+
+  void run(auto& worker) {
+    cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
+    base::textures& textures = RGMDATA(base::textures);
+    base::renderstack& stack = RGMDATA(base::renderstack);
+    window_skins& skins = RGMDATA(window_skins);
+
+    const int width = w->width;
+    const int height = w->height;
+    if (width <= 0 || height <= 0) return;
+
+    /* 获取窗口皮肤对应的 Bitmap */
+    cen::texture& skin = textures.at(w->windowskin);
+
+    /* 查询缓存，不存在时绘制新的窗口背景 */
+    const window_skins::key_t key{w->windowskin,
+                                  RGMDATA(bitmap_versions).get(w->windowskin),
+                                  width,
+                                  height,
+                                  w->back_opacity,
+                                  w->stretch};
+
+    auto it = skins.m_data.find(key);
+    if (it != skins.m_data.end()) {
+      ++skins.hits;
+    } else {
+      ++skins.misses;
+
+      /* 使用 base::renderstack::make_empty_texture 创建空白的 texture */
+      cen::texture cached = stack.make_empty_texture(width, height);
+      renderer.set_target(cached);
+      draw_skin(renderer, skin, skins);
+
+      it = skins.m_data.emplace(key, window_skin{std::move(cached), 0}).first;
+    }
+    it->second.last_used = ++skins.tick;
+
+    /* 淘汰多余的缓存，刚使用过的缓存序号最大，不会被淘汰 */
+    skins.shrink();
 
     auto process = [&, this](auto& up, auto& down) {
       /* 获取 viewport，如果不存在则使用 default_viewport */
       const viewport* v = w->p_viewport ? w->p_viewport : &default_viewport;
 
       /* 设置绘制目标和区域 */
-      renderer.set_target(down);
+      stack.bind(down);
       renderer.set_clip(cen::irect(0, 0, v->rect.width, v->rect.height));
 
       /* 设置透明度 */
@@ -141,13 +253,14 @@ struct render<window> {
       up.set_blend_mode(cen::blend_mode::blend);
       renderer.render(up, cen::irect(0, 0, width, height),
                       cen::irect(w->x - v->ox, w->y - v->oy, width, height));
+      ++skins.draw_calls;
 
       /* 还原透明度 */
       up.set_alpha_mod(255);
     };
 
-    /* 将中间层出栈，内容绘制到新的栈顶 */
-    stack.merge(process);
+    /* 将缓存的窗口背景绘制到栈顶 */
+    stack.merge(process, it->second.texture);
   }
 };
 
@@ -162,6 +275,13 @@ struct render<overlayer<window>> {
   void run(auto& worker) {
     cen::renderer& renderer = RGMDATA(base::cen_library).renderer;
     base::textures& textures = RGMDATA(base::textures);
+    window_skins& skins = RGMDATA(window_skins);
+
+    /* 调用 renderer.render 并计入 window 的绘制次数 */
+    auto render = [&](auto&&... args) {
+      renderer.render(std::forward<decltype(args)>(args)...);
+      ++skins.draw_calls;
+    };
 
     /* 获取对应的 window 数据 */
     const window* w = o->p_drawable;
@@ -196,32 +316,27 @@ struct render<overlayer<window>> {
         int dst_y = w->y + r.y + 16 - v->oy;
 
         /* 中心 */
-        renderer.render(
-            skin, cen::irect(128 + 1, 64 + 1, 32 - 2, 32 - 2),
-            cen::irect(dst_x + 1, dst_y + 1, r.width - 2, r.height - 2));
+        render(skin, cen::irect(128 + 1, 64 + 1, 32 - 2, 32 - 2),
+               cen::irect(dst_x + 1, dst_y + 1, r.width - 2, r.height - 2));
 
         /* 四边 */
-        renderer.render(skin, cen::irect(128 + 1, 64, 30, 1),
-                        cen::irect(dst_x + 1, dst_y, r.width - 2, 1));
-        renderer.render(skin, cen::irect(128, 64 + 1, 1, 30),
-                        cen::irect(dst_x, dst_y + 1, 1, r.height - 2));
-        renderer.render(
-            skin, cen::irect(128 + 1, 64 + 31, 30, 1),
-            cen::irect(dst_x + 1, dst_y + r.height - 1, r.width - 2, 1));
-        renderer.render(
-            skin, cen::irect(128 + 31, 64 + 1, 1, 30),
-            cen::irect(dst_x + r.width - 1, dst_y + 1, 1, r.height - 2));
+        render(skin, cen::irect(128 + 1, 64, 30, 1),
+               cen::irect(dst_x + 1, dst_y, r.width - 2, 1));
+        render(skin, cen::irect(128, 64 + 1, 1, 30),
+               cen::irect(dst_x, dst_y + 1, 1, r.height - 2));
+        render(skin, cen::irect(128 + 1, 64 + 31, 30, 1),
+               cen::irect(dst_x + 1, dst_y + r.height - 1, r.width - 2, 1));
+        render(skin, cen::irect(128 + 31, 64 + 1, 1, 30),
+               cen::irect(dst_x + r.width - 1, dst_y + 1, 1, r.height - 2));
 
         /* 四角 */
-        renderer.render(skin, cen::irect(128, 64, 1, 1),
-                        cen::irect(dst_x, dst_y, 1, 1));
-        renderer.render(skin, cen::irect(128 + 31, 64, 1, 1),
-                        cen::irect(dst_x + r.width - 1, dst_y, 1, 1));
-        renderer.render(skin, cen::irect(128, 64 + 31, 1, 1),
-                        cen::irect(dst_x, dst_y + r.height - 1, 1, 1));
-        renderer.render(
-            skin, cen::irect(128 + 31, 64 + 31, 1, 1),
-            cen::irect(dst_x + r.width - 1, dst_y + r.height - 1, 1, 1));
+        render(skin, cen::irect(128, 64, 1, 1), cen::irect(dst_x, dst_y, 1, 1));
+        render(skin, cen::irect(128 + 31, 64, 1, 1),
+               cen::irect(dst_x + r.width - 1, dst_y, 1, 1));
+        render(skin, cen::irect(128, 64 + 31, 1, 1),
+               cen::irect(dst_x, dst_y + r.height - 1, 1, 1));
+        render(skin, cen::irect(128 + 31, 64 + 31, 1, 1),
+               cen::irect(dst_x + r.width - 1, dst_y + r.height - 1, 1, 1));
 
         /* 还原 skin 的透明度 */
         skin.set_alpha_mod(255);
@@ -244,8 +359,8 @@ struct render<overlayer<window>> {
       renderer.set_clip(cen::irect(w->x - v->ox + 16, w->y - v->oy + 16,
                                    w->width - 32, w->height - 32));
 
-      renderer.render(contents, cen::ipoint(w->x - w->ox - v->ox + 16,
-                                            w->y - w->oy - v->oy + 16));
+      render(contents, cen::ipoint(w->x - w->ox - v->ox + 16,
+                                   w->y - w->oy - v->oy + 16));
 
       renderer.reset_clip();
 
@@ -269,28 +384,28 @@ struct render<overlayer<window>> {
           cen::irect src_rect(128 + 16, 24, 8, 16);
           cen::irect dst_rect(w->x + 4 - v->ox,
                               (w->y + w->height) / 2 - 8 - v->oy, 8, 16);
-          renderer.render(skin, src_rect, dst_rect);
+          render(skin, src_rect, dst_rect);
         }
         /* 右边 */
         if (contents.width() - w->ox > w->width - 32) {
           cen::irect src_rect(128 + 40, 24, 8, 16);
           cen::irect dst_rect(w->x + w->width - 12 - v->ox,
                               w->y + w->height / 2 - 8 - v->oy, 8, 16);
-          renderer.render(skin, src_rect, dst_rect);
+          render(skin, src_rect, dst_rect);
         }
         /* 上边 */
         if (0 - w->oy < 0) {
           cen::irect src_rect(128 + 24, 16, 16, 8);
           cen::irect dst_rect(w->x + w->width / 2 - 8 - v->ox, w->y + 4 - v->oy,
                               16, 8);
-          renderer.render(skin, src_rect, dst_rect);
+          render(skin, src_rect, dst_rect);
         }
         /* 下边 */
         if (contents.height() - w->oy > w->height - 32) {
           cen::irect src_rect(128 + 24, 40, 16, 8);
           cen::irect dst_rect(w->x + w->width / 2 - 8 - v->ox,
                               w->y + w->height - 12 - v->oy, 16, 8);
-          renderer.render(skin, src_rect, dst_rect);
+          render(skin, src_rect, dst_rect);
         }
       }
 
@@ -304,7 +419,7 @@ struct render<overlayer<window>> {
         cen::irect dst_rect(w->x + w->width / 2 - 8 - v->ox,
                             w->y + w->height - 16 - v->oy, 16, 16);
 
-        renderer.render(skin, src_rect, dst_rect);
+        render(skin, src_rect, dst_rect);
       }
     }
   }
@@ -32,6 +32,7 @@
 #include "graphics.hpp"
 #include "init_drawable.hpp"
 #include "input.hpp"
+#include "marshal.hpp"
 #include "messagebox.hpp"
 #include "overlayer.hpp"
 #include "palette.hpp"
@@ -43,6 +44,8 @@
 #include "render_viewport.hpp"
 #include "render_window.hpp"
 #include "shader/shader.hpp"
+#include "snapshot.hpp"
+#include "software_effect.hpp"
 #include "table.hpp"
 #include "tilemap_manager.hpp"
 #include "viewport.hpp"
@@ -50,27 +53,41 @@
 
 namespace rgm::rmxp {
 /// @brief 执行 ruby 脚本的 task，运行游戏的主要逻辑（即 RGSS 脚本）
-using tasks_ruby =
+/// 测试用的 task 只在 develop 模式下加入。
+using tasks_ruby = core::traits::expand_tuples_t<
     std::tuple<init_extension, init_word, init_bitmap, init_table,
-               init_tilemap_manager, init_viewport, init_graphics, init_input,
-               init_controller, init_drawable_base, init_drawable<sprite>,
-               init_drawable<window>, init_drawable<plane>,
-               init_drawable<tilemap>, init_font<true>, init_palette,
-               init_message, key_release, key_press, controller_axis_move,
-               controller_button_release, controller_button_press>;
+               init_marshal, init_tilemap_manager, init_viewport,
+               init_graphics, init_input, init_controller, init_drawable_base,
+               init_drawable<sprite>, init_drawable<window>,
+               init_drawable<plane>, init_drawable<tilemap>, init_font<true>,
+               init_palette, init_message, key_release, key_press,
+               controller_axis_move, controller_button_release,
+               controller_button_press>,
+    std::conditional_t<config::develop, std::tuple<init_software_effect>,
+                       std::tuple<>>>;
 
 /// @brief 执行渲染流程的 task，使用 SDL2 创建窗口，绘制画面并处理事件
-using tasks_render = std::tuple<
-    shader::init_shader, init_event, init_blend_type, init_font<false>,
-    bitmap_create<1>, bitmap_create<2>, bitmap_create<3>, bitmap_dispose,
-    bitmap_save_png, bitmap_capture_screen, bitmap_blt, bitmap_stretch_blt,
-    bitmap_fill_rect, bitmap_hue_change, bitmap_grayscale, bitmap_draw_text,
-    bitmap_get_pixel, bitmap_capture_palette, bitmap_make_autotile,
-    bitmap_reload_autotile, setup_default_viewport, before_render_viewport,
-    after_render_viewport, render<sprite>, render<plane>, render<window>,
-    render<overlayer<window>>, render<tilemap>, render<overlayer<tilemap>>,
-    render_transition<1>, render_transition<2>, tilemap_set_info, message_show,
-    controller_rumble, controller_rumble_triggers>;
+/// 测试用的 task 只在 develop 模式下加入。
+using tasks_render = core::traits::expand_tuples_t<
+    std::tuple<shader::init_shader, init_event, init_blend_type,
+               init_font<false>, init_bitmap_versions, bitmap_create<1>,
+               bitmap_create<2>, bitmap_create<3>, bitmap_dispose,
+               bitmap_save_png, bitmap_capture_screen, bitmap_blt,
+               bitmap_stretch_blt, bitmap_fill_rect, bitmap_hue_change,
+               bitmap_grayscale, bitmap_draw_text, bitmap_readback,
+               bitmap_capture_palette, bitmap_make_autotile,
+               bitmap_reload_autotile, setup_default_viewport,
+               before_render_viewport, after_render_viewport, render<sprite>,
+               render<plane>, render<window>, render<overlayer<window>>,
+               render<tilemap>, render<overlayer<tilemap>>, init_transition,
+               render_transition<1>, render_transition<2>, init_tilemap_chunks,
+               tilemap_set_info, tilemap_release_chunks, message_show,
+               controller_rumble, controller_rumble_triggers,
+               render_sprite_batch, init_window_skins, window_skins_step,
+               init_plane_tiles, plane_release_tiles, shader::shader_step,
+               render_stats>,
+    std::conditional_t<config::develop,
+                       std::tuple<software_effect_benchmark>, std::tuple<>>>;
 
 /// @brief 执行音乐播放的 task，使用 SDL2 Mixer 播放音乐和音效
 using tasks_audio = std::tuple<>;
@@ -0,0 +1,202 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#pragma once
+#include "base/base.hpp"
+#include "drawable.hpp"
+#include "table.hpp"
+#include "tilemap_manager.hpp"
+
+namespace rgm::rmxp {
+/// @brief 一帧画面的数据快照
+/// 流水线模式下，逻辑线程在 Graphics.update 中将需要绘制的数据复制到快照中，
+/// 发送给渲染线程的任务只引用快照里的数据。这样逻辑线程可以在渲染线程绘制
+/// 这一帧的同时，继续执行下一帧的逻辑，而不会修改正在绘制的数据。
+/// 渲染任务只读取 C++ 层的成员变量，不会访问 ruby 对象。
+struct frame_snapshot {
+  /// @brief 复制的 drawable，deque 保证元素的地址不会变化
+  std::deque<drawable> items;
+
+  /// @brief 原 viewport 的地址到复制的 viewport 的地址的映射
+  std::unordered_map<const viewport*, viewport*> viewports;
+
+  /// @brief 原 window 的地址到复制的 window 的地址的映射
+  std::unordered_map<const window*, const window*> windows;
+
+  /// @brief 复制的 tilemap_info，key 为 tilemap 的 id
+  /// 跨帧保留，优先级索引没有变化时不必重新复制。
+  std::map<uint64_t, tilemap_info> infos;
+
+  /// @brief 复制的 table，只包含 tilemap 用到的 table
+  /// 跨帧保留，table 没有被修改时不必重新复制。
+  tables table_copies;
+
+  /// @brief 复制 table 时 tilemap_manager::table_versions 中的版本
+  std::unordered_map<uint64_t, uint64_t> table_versions;
+
+  /// @brief 这一帧用到的 tilemap_info 和 table 的 id
+  /// 下次使用此快照时，移除没有用到的副本。
+  std::unordered_set<uint64_t> used_infos;
+  std::unordered_set<uint64_t> used_tables;
+
+  /// @brief 等待渲染线程绘制完此快照的信号量
+  core::semaphore pause;
+
+  /// @brief 是否有尚未完成的绘制任务引用了此快照
+  bool pending = false;
+
+  /// @brief 清空快照中的数据，只保留上一次用到的 tilemap_info 和 table
+  void clear() {
+    items.clear();
+    viewports.clear();
+    windows.clear();
+
+    std::erase_if(infos, [this](const auto& pair) {
+      return !used_infos.contains(pair.first);
+    });
+    std::erase_if(table_copies, [this](const auto& pair) {
+      return !used_tables.contains(pair.first);
+    });
+    std::erase_if(table_versions, [this](const auto& pair) {
+      return !used_tables.contains(pair.first);
+    });
+    used_infos.clear();
+    used_tables.clear();
+  }
+
+  /// @brief 复制一个 drawable
+  /// @tparam T drawable 的类型
+  /// @param item 原 drawable
+  /// @return 复制的 drawable，其 viewport 指针指向复制的 viewport
+  template <typename T>
+  T& copy(const T& item) {
+    T& t = std::get<T>(items.emplace_back(std::in_place_type<T>, item));
+
+    if (item.p_viewport) {
+      auto it = viewports.find(item.p_viewport);
+      if (it != viewports.end()) t.p_viewport = it->second;
+    }
+
+    if constexpr (std::is_same_v<T, window>) {
+      windows[&item] = &t;
+    }
+    return t;
+  }
+
+  /// @brief 复制一个 viewport
+  /// viewport 中的 p_drawables 不可复制，渲染任务也不会用到，故逐个复制
+  /// 其他的成员变量。
+  viewport& copy(const viewport& item) {
+    viewport& v = std::get<viewport>(
+        items.emplace_back(std::in_place_type<viewport>));
+
+    v.ruby_object = item.ruby_object;
+    v.p_viewport = item.p_viewport;
+    v.flash_color = item.flash_color;
+    v.rect = item.rect;
+    v.color = item.color;
+    v.tone = item.tone;
+    v.ox = item.ox;
+    v.oy = item.oy;
+    v.flash_hidden = item.flash_hidden;
+
+    viewports[&item] = &v;
+    return v;
+  }
+
+  /// @brief 复制一个 window 的 overlayer
+  /// 对应的 window 可能因为不可见而没有被复制，此时一并复制。
+  overlayer<window>& copy(const overlayer<window>& item) {
+    auto it = windows.find(item.p_drawable);
+    const window* w =
+        (it != windows.end()) ? it->second : &copy(*item.p_drawable);
+
+    return std::get<overlayer<window>>(items.emplace_back(
+        std::in_place_type<overlayer<window>>,
+        overlayer<window>{w, item.m_index}));
+  }
+
+  /// @brief 复制一个 tilemap_info 及其用到的 table
+  /// @param info 原 tilemap_info
+  /// @param t 复制的 tilemap
+  /// @param tm 管理所有 tilemap 的类，提供 table 及其版本
+  /// @return 复制的 tilemap_info，其 p_tilemap 指向复制的 tilemap
+  /// 优先级索引和 table 都只在变化后才重新复制，静止的地图每帧只复制
+  /// tilemap_info 中的几个标量。
+  tilemap_info& copy(const tilemap_info& info, const tilemap& t,
+                     const tilemap_manager& tm) {
+    auto [info_it, inserted] = infos.try_emplace(info.tilemap_id);
+    tilemap_info& i = info_it->second;
+    used_infos.insert(info.tilemap_id);
+
+    if (inserted || i.revision != info.revision ||
+        i.tile_edits != info.tile_edits) {
+      i = info;
+    } else {
+      /* 索引没有变化，只复制每帧都可能变化的成员 */
+      i.draw_calls = info.draw_calls;
+      i.tilemap_id = info.tilemap_id;
+      i.tilemap_z = info.tilemap_z;
+      i.current_index = info.current_index;
+      i.max_index = info.max_index;
+      i.dirty = info.dirty;
+      i.max_index_dirty = info.max_index_dirty;
+    }
+    i.p_tilemap = &t;
+
+    for (uint64_t id : {t.map_data, t.priorities, t.flash_data}) {
+      if (id == 0) continue;
+
+      auto it = tm.p_tables->find(id);
+      if (it == tm.p_tables->end()) continue;
+      used_tables.insert(id);
+
+      /* Table#resize 不会通知 C++ 层，通过比较尺寸来发现这种变化 */
+      const table& source = it->second;
+      const uint64_t version = tm.table_version(id);
+      auto [version_it, added] = table_versions.try_emplace(id, version);
+      table& target = table_copies[id];
+      if (added || version_it->second != version ||
+          target.x_size != source.x_size || target.y_size != source.y_size ||
+          target.z_size != source.z_size) {
+        target = source;
+        version_it->second = version;
+      }
+    }
+    return i;
+  }
+};
+
+/// @brief 流水线模式下轮流使用的 2 个快照
+/// 第 N 帧使用 snapshots[N % 2]。在复制第 N 帧的数据前，只需要等待使用同
+/// 一个快照的第 N - 2 帧绘制完成，故渲染线程落后不超过 1 帧时逻辑线程不会
+/// 阻塞。
+struct frame_pipeline {
+  /// @brief 2 个快照
+  std::array<frame_snapshot, 2> snapshots;
+
+  /// @brief 已经开始复制的帧数
+  uint64_t frame = 0;
+
+  /// @brief 返回下一帧要使用的快照
+  /// 如果此快照仍被渲染线程使用，需要调用者先等待 pause。
+  [[nodiscard]] frame_snapshot& next() { return snapshots[frame++ % 2]; }
+};
+}  // namespace rgm::rmxp
\ No newline at end of file
@@ -0,0 +1,182 @@
+// zlib License
+//
+// copyright (C) 2023 Guoxiaomi and Krimiston
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+#pragma once
+#include "base/base.hpp"
+
+namespace rgm::rmxp {
+/// @brief 使用 CPU 实现 tone、hue、gray 和 color 等效果
+/// software 渲染器不支持 shader 和自定义混合模式，这里读取绘制目标的像素，
+/// 按扫描线分段并行地应用 base::surface_kernel::transform，再写回 texture。
+/// 计算的结果与 ./src/shader/opengl 中对应的 glsl 相差不超过 1。
+struct software_effect {
+  using transform = base::surface_kernel::transform;
+
+  /* 像素的缓冲区，只在渲染线程中使用 */
+  inline static std::vector<uint32_t> buffer;
+
+  /// @brief 对 width * height 个 texture_format 格式的像素应用变换
+  static void apply(uint32_t* pixels, int width, int height,
+                    const transform& t) {
+    static_assert(config::texture_format == cen::pixel_format::bgra32);
+    const transform t_bgra = t.swap_rb();
+
+    base::band_pool::instance().run(height, width, [&](int begin, int end) {
+      for (int y = begin; y < end; ++y) {
+        base::surface_kernel::apply(pixels + y * width, width, t_bgra);
+      }
+    });
+  }
+
+  /// @brief 对当前绘制目标中的区域 r 应用变换
+  /// @param renderer 渲染器
+  /// @param r 相对于当前视口的区域，为空时处理整个视口
+  /// @param t 颜色变换
+  static void apply(cen::renderer& renderer, const cen::irect* r,
+                    const transform& t) {
+    SDL_Texture* target = SDL_GetRenderTarget(renderer.get());
+    if (!target) return;
+
+    /* 换算成 texture 中的坐标，并裁剪到 texture 的范围内 */
+    SDL_Rect viewport;
+    SDL_RenderGetViewport(renderer.get(), &viewport);
+
+    SDL_Rect rect{0, 0, viewport.w, viewport.h};
+    if (r) rect = SDL_Rect{r->x(), r->y(), r->width(), r->height()};
+    rect.x += viewport.x;
+    rect.y += viewport.y;
+
+    SDL_Rect bound{0, 0, 0, 0};
+    SDL_QueryTexture(target, nullptr, nullptr, &bound.w, &bound.h);
+    if (!SDL_IntersectRect(&rect, &bound, &rect)) return;
+
+    buffer.resize(static_cast<size_t>(rect.w) * rect.h);
+    const int pitch = rect.w * 4;
+
+    /* 读取时取消视口，使坐标与 texture 中的一致 */
+    SDL_RenderSetViewport(renderer.get(), nullptr);
+    SDL_RenderReadPixels(renderer.get(), &rect,
+                         static_cast<uint32_t>(config::texture_format),
+                         buffer.data(), pitch);
+    SDL_RenderSetViewport(renderer.get(), &viewport);
+
+    apply(buffer.data(), rect.w, rect.h, t);
+    SDL_UpdateTexture(target, &rect, buffer.data(), pitch);
+  }
+
+  /// @brief 对整个 texture 应用变换，会修改 renderer 的绘制目标
+  static void apply(cen::renderer& renderer, cen::texture& texture,
+                    const transform& t) {
+    renderer.set_target(texture);
+    apply(renderer, nullptr, t);
+  }
+};
+
+/// @brief 任务：测试 software_effect 的吞吐量
+/// 测试在渲染线程中进行，调用者等待任务完成后再读取 p_result。
+/// 只在 develop 模式下加入 tasks_render，见 rmxp.hpp。
+struct software_effect_benchmark {
+  /// @brief 测试图像的宽度
+  int width;
+
+  /// @brief 测试图像的高度
+  int height;
+
+  /// @brief 依次写入 tone、hue、gray、color 和单线程 tone 的速度，
+  /// 单位是百万像素每秒
+  double* p_result;
+
+  void run(auto&) {
+    using transform = software_effect::transform;
+
+    std::vector<uint32_t> pixels(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+      pixels[i] = static_cast<uint32_t>(i * 2654435761u) | 0xff000000u;
+    }
+
+    /* 重复执行至少 100 毫秒，返回每秒处理的百万像素数 */
+    auto measure = [&](auto f) {
+      const auto start = std::chrono::steady_clock::now();
+      double elapsed = 0;
+      int count = 0;
+      do {
+        f();
+        ++count;
+        elapsed = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+      } while (elapsed < 0.1);
+      return static_cast<double>(pixels.size()) * count / elapsed / 1e6;
+    };
+
+    const std::array<transform, 4> transforms = {
+        transform::tone(68, -34, 17, 128), transform::hue(120),
+        transform::gray(), transform::color(255, 128, 0, 96)};
+
+    for (size_t i = 0; i < transforms.size(); ++i) {
+      p_result[i] = measure([&] {
+        software_effect::apply(pixels.data(), width, height, transforms[i]);
+      });
+    }
+
+    const transform t = transforms[0].swap_rb();
+    p_result[4] = measure([&] {
+      base::surface_kernel::apply(pixels.data(),
+                                  static_cast<int>(pixels.size()), t);
+    });
+  }
+};
+
+/// @brief software_effect 相关的初始化类
+/// 只定义了测试用的方法，只在 develop 模式下加入 tasks_ruby。
+struct init_software_effect {
+  static void before(auto& this_worker) {
+    static decltype(auto) worker = this_worker;
+
+    struct wrapper {
+      /* ruby method: Base#software_effect_benchmark ->
+       * software_effect_benchmark */
+      static VALUE benchmark(VALUE, VALUE width_, VALUE height_) {
+        RGMLOAD(width, int);
+        RGMLOAD(height, int);
+
+        if (width <= 0 || height <= 0) {
+          rb_raise(rb_eArgError, "width and height must be positive");
+        }
+
+        std::array<double, 5> result{};
+        worker >> software_effect_benchmark{width, height, result.data()};
+
+        RGMWAIT(1);
+
+        return rb_ary_new_from_args(
+            5, DBL2NUM(result[0]), DBL2NUM(result[1]), DBL2NUM(result[2]),
+            DBL2NUM(result[3]), DBL2NUM(result[4]));
+      }
+    };
+
+    VALUE rb_mRGM = rb_define_module("RGM");
+    VALUE rb_mRGM_Base = rb_define_module_under(rb_mRGM, "Base");
+    rb_define_module_function(rb_mRGM_Base, "software_effect_benchmark",
+                              wrapper::benchmark, 2);
+  }
+};
+}  // namespace rgm::rmxp
@@ -22,6 +22,12 @@
 #include "base/base.hpp"
 #include "word.hpp"
 
+/* 根据编译选项选择 SIMD 指令集，不支持时使用标量的实现 */
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RGM_TABLE_SSE2
+#endif
+
 namespace rgm::rmxp {
 /**
  * @brief 储存所有 Table 的类，其中的元素都是 std::vector<int16_t>
@@ -116,6 +122,94 @@ struct table {
   /// @brief 返回 table 在堆上的数据指针
   /// @return 返回堆上的指针
   [[nodiscard]] int16_t* data_ptr() { return &(m_data.front()); }
+
+  /*
+   * 以下是批量操作的接口，操作的区域是 table 中的一个长方体，
+   * 起点为 (x, y, z)，三个维度的大小为 (w, h, d)。
+   * 调用者需要先用 contains 检查一次范围，之后的操作不再检查索引。
+   */
+
+  /// @brief 检查长方体是否完全位于 table 内
+  /// 参数来自 ruby，使用减法比较以免 x + w 等溢出。
+  [[nodiscard]] bool contains(int x, int y, int z, int w, int h,
+                              int d) const {
+    if (x < 0 || y < 0 || z < 0 || w < 0 || h < 0 || d < 0) return false;
+    return w <= x_size - x && h <= y_size - y && d <= z_size - z;
+  }
+
+  /// @brief 返回 (0, y, z) 处的数据指针，不检查范围
+  [[nodiscard]] int16_t* row(int y, int z) {
+    return m_data.data() + (static_cast<size_t>(z) * y_size + y) * x_size;
+  }
+
+  /// @brief 用 value 填充长方体
+  void fill(int x, int y, int z, int w, int h, int d, int16_t value) {
+    for (int k = z; k < z + d; ++k) {
+      for (int j = y; j < y + h; ++j) std::fill_n(row(j, k) + x, w, value);
+    }
+  }
+
+  /// @brief 将 src 中起点为 (sx, sy, sz) 的长方体复制到 (x, y, z) 处
+  /// src 可以是 table 自身，此时按照重叠的方向选择遍历顺序。
+  void copy(table& src, int sx, int sy, int sz, int x, int y, int z, int w,
+            int h, int d) {
+    const bool backward =
+        (&src == this) && ((z - sz) * y_size + (y - sy) > 0);
+    for (int n = 0; n < d * h; ++n) {
+      const int i = backward ? d * h - 1 - n : n;
+      const int k = i / h;
+      const int j = i % h;
+      std::memmove(row(y + j, z + k) + x, src.row(sy + j, sz + k) + sx,
+                   w * sizeof(int16_t));
+    }
+  }
+
+  /// @brief 调用 f(index) 处理 [begin, end) 范围内所有等于 value 的元素
+  void find(size_t begin, size_t end, int16_t value, auto f) const {
+    const int16_t* p = m_data.data();
+    size_t i = begin;
+#if defined(RGM_TABLE_SSE2)
+    /* 每次比较 8 个元素，没有匹配时直接跳过 */
+    const __m128i v = _mm_set1_epi16(value);
+    for (; i + 8 <= end; i += 8) {
+      const __m128i x =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+      unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi16(x, v));
+      while (mask) {
+        const int bit = std::countr_zero(mask);
+        f(i + bit / 2);
+        mask &= ~(3u << bit);
+      }
+    }
+#endif
+    for (; i < end; ++i) {
+      if (p[i] == value) f(i);
+    }
+  }
+
+  /// @brief 统计 [begin, end) 范围内各个值出现的次数
+  /// 使用 4 组计数器交替累加，减少相邻元素相同时的写后读依赖。
+  [[nodiscard]] std::vector<uint32_t> histogram(size_t begin,
+                                                size_t end) const {
+    std::vector<uint32_t> counts(4 * 65536, 0);
+    const uint16_t* p = reinterpret_cast<const uint16_t*>(m_data.data());
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+      ++counts[p[i]];
+      ++counts[65536 + p[i + 1]];
+      ++counts[2 * 65536 + p[i + 2]];
+      ++counts[3 * 65536 + p[i + 3]];
+    }
+    for (; i < end; ++i) ++counts[p[i]];
+
+    for (size_t k = 0; k < 65536; ++k) {
+      counts[k] += counts[65536 + k] + counts[2 * 65536 + k] +
+                   counts[3 * 65536 + k];
+    }
+    counts.resize(65536);
+    return counts;
+  }
 };
 
 /// @brief 存储所有 table，即 Table 对象的类
@@ -228,6 +322,140 @@ struct init_table {
         return Qnil;
       }
 
+      /* 检查长方体是否位于 table 内，否则抛出 ruby 的异常 */
+      static void check(const table& t, int x, int y, int z, int w, int h,
+                        int d) {
+        if (!t.contains(x, y, z, w, h, d)) {
+          rb_raise(rb_eIndexError,
+                   "Box (%d, %d, %d) + (%d, %d, %d) is out of table (%d, %d, "
+                   "%d).\n",
+                   x, y, z, w, h, d, t.x_size, t.y_size, t.z_size);
+        }
+      }
+
+      /* ruby method: Base#table_fill -> table::fill */
+      static VALUE fill(VALUE, VALUE id_, VALUE value_, VALUE x_, VALUE y_,
+                        VALUE z_, VALUE w_, VALUE h_, VALUE d_) {
+        RGMLOAD(id, uint64_t);
+        RGMLOAD(value, int);
+        RGMLOAD(x, int);
+        RGMLOAD(y, int);
+        RGMLOAD(z, int);
+        RGMLOAD(w, int);
+        RGMLOAD(h, int);
+        RGMLOAD(d, int);
+
+        table& t = RGMDATA(tables).at(id);
+        check(t, x, y, z, w, h, d);
+
+        t.fill(x, y, z, w, h, d, static_cast<int16_t>(value));
+        return Qnil;
+      }
+
+      /* ruby method: Base#table_copy -> table::copy */
+      static VALUE copy(VALUE, VALUE id_, VALUE src_id_, VALUE x_, VALUE y_,
+                        VALUE z_, VALUE sx_, VALUE sy_, VALUE sz_, VALUE w_,
+                        VALUE h_, VALUE d_) {
+        RGMLOAD(id, uint64_t);
+        RGMLOAD(src_id, uint64_t);
+        RGMLOAD(x, int);
+        RGMLOAD(y, int);
+        RGMLOAD(z, int);
+        RGMLOAD(sx, int);
+        RGMLOAD(sy, int);
+        RGMLOAD(sz, int);
+        RGMLOAD(w, int);
+        RGMLOAD(h, int);
+        RGMLOAD(d, int);
+
+        tables& data = RGMDATA(tables);
+        table& t = data.at(id);
+        table& src = data.at(src_id);
+        check(t, x, y, z, w, h, d);
+        check(src, sx, sy, sz, w, h, d);
+
+        t.copy(src, sx, sy, sz, x, y, z, w, h, d);
+        return Qnil;
+      }
+
+      /* ruby method: Base#table_get_layer -> String */
+      static VALUE get_layer(VALUE, VALUE id_, VALUE z_) {
+        RGMLOAD(id, uint64_t);
+        RGMLOAD(z, int);
+
+        table& t = RGMDATA(tables).at(id);
+        check(t, 0, 0, z, t.x_size, t.y_size, 1);
+
+        return rb_str_new(reinterpret_cast<const char*>(t.row(0, z)),
+                          t.x_size * t.y_size * sizeof(int16_t));
+      }
+
+      /* ruby method: Base#table_set_layer -> RSTRING_PTR */
+      static VALUE set_layer(VALUE, VALUE id_, VALUE z_, VALUE string_) {
+        RGMLOAD(id, uint64_t);
+        RGMLOAD(z, int);
+        Check_Type(string_, T_STRING);
+
+        table& t = RGMDATA(tables).at(id);
+        check(t, 0, 0, z, t.x_size, t.y_size, 1);
+
+        const long size = t.x_size * t.y_size * sizeof(int16_t);
+        if (RSTRING_LEN(string_) != size) {
+          rb_raise(rb_eArgError,
+                   "Table#set_layer expects %ld bytes, but got %ld.\n", size,
+                   RSTRING_LEN(string_));
+        }
+        memcpy(t.row(0, z), RSTRING_PTR(string_), size);
+        return Qnil;
+      }
+
+      /* ruby method: Base#table_find -> table::find */
+      /* z 为 nil 时查找整个 table，返回所有匹配元素展开成 1 列时的位置 */
+      static VALUE find(VALUE, VALUE id_, VALUE value_, VALUE z_) {
+        RGMLOAD(id, uint64_t);
+        RGMLOAD(value, int);
+
+        table& t = RGMDATA(tables).at(id);
+
+        size_t begin = 0;
+        size_t end = t.size();
+        if (z_ != Qnil) {
+          RGMLOAD(z, int);
+          check(t, 0, 0, z, t.x_size, t.y_size, 1);
+
+          begin = static_cast<size_t>(z) * t.x_size * t.y_size;
+          end = begin + static_cast<size_t>(t.x_size) * t.y_size;
+        }
+
+        VALUE array = rb_ary_new();
+        t.find(begin, end, static_cast<int16_t>(value),
+               [array](size_t index) { rb_ary_push(array, ULL2NUM(index)); });
+        return array;
+      }
+
+      /* ruby method: Base#table_histogram -> table::histogram */
+      static VALUE histogram(VALUE, VALUE id_, VALUE z_) {
+        RGMLOAD(id, uint64_t);
+        RGMLOAD(z, int);
+
+        table& t = RGMDATA(tables).at(id);
+        check(t, 0, 0, z, t.x_size, t.y_size, 1);
+
+        const size_t begin = static_cast<size_t>(z) * t.x_size * t.y_size;
+        const size_t end = begin + static_cast<size_t>(t.x_size) * t.y_size;
+        const std::vector<uint32_t> counts = t.histogram(begin, end);
+
+        /* 返回 Hash，键是 table 中出现过的值，值是出现的次数 */
+        VALUE hash = rb_hash_new();
+        for (size_t k = 0; k < counts.size(); ++k) {
+          if (counts[k] == 0) continue;
+
+          const int16_t value = static_cast<int16_t>(static_cast<uint16_t>(k));
+          rb_hash_aset(hash, INT2FIX(value), UINT2NUM(counts[k]));
+        }
+        return hash;
+      }
+
       /* ruby method: Base#table_dump -> String */
       static VALUE dump(VALUE, VALUE id_) {
         RGMLOAD(id, uint64_t);
@@ -255,6 +483,15 @@ struct init_table {
     rb_define_module_function(rb_mRGM_Base, "table_get", wrapper::get, 2);
     rb_define_module_function(rb_mRGM_Base, "table_set", wrapper::set, 3);
     rb_define_module_function(rb_mRGM_Base, "table_resize", wrapper::resize, 4);
+    rb_define_module_function(rb_mRGM_Base, "table_fill", wrapper::fill, 8);
+    rb_define_module_function(rb_mRGM_Base, "table_copy", wrapper::copy, 11);
+    rb_define_module_function(rb_mRGM_Base, "table_get_layer",
+                              wrapper::get_layer, 2);
+    rb_define_module_function(rb_mRGM_Base, "table_set_layer",
+                              wrapper::set_layer, 3);
+    rb_define_module_function(rb_mRGM_Base, "table_find", wrapper::find, 3);
+    rb_define_module_function(rb_mRGM_Base, "table_histogram",
+                              wrapper::histogram, 2);
   }
 
   static void after(auto& worker) { RGMDATA(tables).clear(); }
@@ -30,6 +30,14 @@ namespace rgm::rmxp {
 /// y 有关，那么大多数时候不需要完整地遍历整个 table，可以缓存一部分结果。
 /// tilemap_info 的作用就是辅助 render<overlayer<tilemap>>> 以加速绘制。
 struct tilemap_info {
+  /// @brief 优先级的种类数，对应 x_cache 和 y_cache 中 uint16_t 的位数
+  static constexpr int priority_bits = 16;
+
+  /// @brief 区块的边长，以图块为单位
+  /// 渲染时地图按 chunk_size x chunk_size 个图块分成区块缓存起来。
+  /// @see ./src/rmxp/render_tilemap.hpp
+  static constexpr int chunk_size = 16;
+
   /// @brief 储存地图图块每列的优先级数据概况。
   /// x_cache 通常大小是 map 的 x_size，第 a 个值记录的是 x = a 的那一列
   /// 所有图块的优先级数据概况。若此列存在优先级为 b 的图块，则：x_cache[a]
@@ -43,6 +51,53 @@ struct tilemap_info {
   /// b + 1 的图块。
   std::vector<uint16_t> y_cache;
 
+  /// @brief 每列中各优先级的图块数量，是 x_cache 的计数版本。
+  /// 第 a 列中优先级对应第 b 位的图块数量为 x_count[a * priority_bits + b]，
+  /// 从而移除一个图块时可以知道该位是否应当清零。
+  std::vector<uint32_t> x_count;
+
+  /// @brief 每行中各优先级的图块数量，是 y_cache 的计数版本。
+  std::vector<uint32_t> y_count;
+
+  /// @brief 每行中优先级 >= 16 的图块的最大优先级，只用于计算 max_index。
+  /// 这个值在增量更新时只增不减，完整重建索引时才会重置。
+  std::vector<int16_t> y_overflow;
+
+  /// @brief 建立索引时所用的 map_data 的 id
+  uint64_t map_data_id = 0;
+
+  /// @brief 建立索引时所用的 priorities 的 id
+  uint64_t priorities_id = 0;
+
+  /// @brief 建立索引时 map_data 的 3 个维度，以及 priorities 的大小
+  /// Table#resize 不会通知 C++ 层，通过比较尺寸来发现这种变化。
+  int x_size = 0;
+  int y_size = 0;
+  int z_size = 0;
+  size_t priorities_size = 0;
+
+  /// @brief 索引是否需要完整地重建
+  bool dirty = true;
+
+  /// @brief max_index 是否可能偏大，需要重新计算
+  bool max_index_dirty = false;
+
+  /// @brief 索引的版本号，每次完整地重建索引时递增
+  /// 渲染线程据此判断缓存的区块是否全部失效。
+  uint32_t revision = 0;
+
+  /// @brief 每个区块的版本号，区块内的图块被修改时递增
+  /// 第 a 行第 b 列的区块对应 chunk_revisions[a * chunk_columns() + b]。
+  std::vector<uint32_t> chunk_revisions;
+
+  /// @brief 增量更新图块的次数，每次修改 map_data 的图块时递增
+  /// 索引只在重建或者增量更新时变化，快照据此判断是否需要重新复制索引。
+  uint64_t tile_edits = 0;
+
+  /// @brief 上一帧绘制此 tilemap 时调用 renderer.render 的次数
+  /// 由渲染线程写入，包括重新绘制区块和将区块贴到画面上的次数。
+  int draw_calls = 0;
+
   /// @brief 关联的 tilemap 数据
   const tilemap* p_tilemap;
 
@@ -62,11 +117,36 @@ struct tilemap_info {
   /// @brief 储存所有自动元件的 texture 的容器
   std::vector<cen::texture*> autotile_textures;
 
-  /// @brief 设置自身的各个属性
+  /// @brief 地图在 x 方向上的区块数
+  [[nodiscard]] int chunk_columns() const {
+    return (x_size + chunk_size - 1) / chunk_size;
+  }
+
+  /// @brief 地图在 y 方向上的区块数
+  [[nodiscard]] int chunk_rows() const {
+    return (y_size + chunk_size - 1) / chunk_size;
+  }
+
+  /// @brief 读取图块的优先级
+  /// @param priorities 储存了图块优先级数据的 table
+  /// @param tileid 图块的 tileid
+  /// @return 图块的优先级，tileid 越界时视为 0
+  [[nodiscard]] static int16_t priority_of(const table& priorities,
+                                           int16_t tileid) {
+    /* 在不越界的情况下读取 priority */
+    if (tileid > 0 && static_cast<size_t>(tileid) < priorities.size()) {
+      return priorities.get(tileid);
+    }
+    return 0;
+  }
+
+  /// @brief 设置自身的各个属性，每帧都会调用
   /// @param zi tilemap 的 z_index
   /// @param t 关联的 tilemap 对象
   /// @param map_data 储存了地图的图块数据的 table
   /// @param priorities 储存了图块优先级数据的 table
+  /// 优先级索引只在首次调用、更换了 table 或者 table 的尺寸变化时才完整地
+  /// 重建，其他时候由 on_table_set 增量更新，开销与地图的大小无关。
   void setup(z_index zi, const tilemap& t, const table& map_data,
              const table& priorities) {
     tilemap_id = zi.id;
@@ -74,44 +154,87 @@ struct tilemap_info {
     p_tilemap = &t;
 
     current_index = 1;
-    max_index = map_data.y_size;
 
-    x_cache.resize(map_data.x_size, 0);
-    y_cache.resize(map_data.y_size, 0);
+    /* 判断索引是否已经失效 */
+    if (map_data_id != t.map_data || priorities_id != t.priorities) {
+      dirty = true;
+    }
+    if (x_size != map_data.x_size || y_size != map_data.y_size ||
+        z_size != map_data.z_size || priorities_size != priorities.size()) {
+      dirty = true;
+    }
 
-    /* 遍历 map_data，设置 x_cache，y_cache 和 max_index 的值 */
-    for (int x_index = 0; x_index < map_data.x_size; ++x_index) {
-      for (int y_index = 0; y_index < map_data.y_size; ++y_index) {
-        for (int z_index = 0; z_index < map_data.z_size; ++z_index) {
-          int16_t priority = 0;
-          /* 获取 tileid */
-          int16_t tileid = map_data.get(x_index, y_index, z_index);
+    if (dirty) {
+      map_data_id = t.map_data;
+      priorities_id = t.priorities;
+      rebuild(map_data, priorities);
+    } else if (max_index_dirty) {
+      refresh_max_index();
+    }
+  }
 
-          /* 在不越界的情况下读取 priority */
-          if (tileid > 0 && static_cast<size_t>(tileid) < priorities.size()) {
-            priority = priorities.get(tileid);
-          }
+  /// @brief 遍历 map_data，完整地重建优先级索引
+  /// @param map_data 储存了地图的图块数据的 table
+  /// @param priorities 储存了图块优先级数据的 table
+  void rebuild(const table& map_data, const table& priorities) {
+    x_size = map_data.x_size;
+    y_size = map_data.y_size;
+    z_size = map_data.z_size;
+    priorities_size = priorities.size();
 
-          /* 设置 max_index */
-          if (max_index < y_index + priority) {
-            max_index = y_index + priority;
-          }
+    ++revision;
+    chunk_revisions.assign(chunk_columns() * chunk_rows(), 0);
 
-          /* priority = 0 属于平凡情况，不需要操作 */
-          if (priority <= 0) continue;
+    x_cache.assign(x_size, 0);
+    y_cache.assign(y_size, 0);
+    x_count.assign(x_size * priority_bits, 0);
+    y_count.assign(y_size * priority_bits, 0);
+    y_overflow.assign(y_size, 0);
 
-          /* 操作 x_cache 和 y_cache 的单个 bit */
-          uint16_t flag = 1;
-          flag <<= ((priority >= 16) ? 15 : (priority - 1));
+    /* 遵循前闭后开原则，current_index 的值要始终小于 max_index */
+    max_index = y_size + 1;
 
-          x_cache[x_index] = x_cache[x_index] | flag;
-          y_cache[y_index] = y_cache[y_index] | flag;
+    /* 遍历 map_data，设置 x_cache，y_cache 和 max_index 的值 */
+    for (int z_index = 0; z_index < z_size; ++z_index) {
+      for (int y_index = 0; y_index < y_size; ++y_index) {
+        for (int x_index = 0; x_index < x_size; ++x_index) {
+          /* 获取 tileid */
+          int16_t tileid = map_data.get(x_index, y_index, z_index);
+
+          add_tile(x_index, y_index, priority_of(priorities, tileid));
         }
       }
     }
 
-    /* 遵循前闭后开原则，current_index 的值要始终小于 max_index */
-    ++max_index;
+    dirty = false;
+    max_index_dirty = false;
+  }
+
+  /// @brief map_data 中的单个图块发生了变化，使其所在的区块失效
+  /// @param index 图块在 map_data 中展开成 1 列时的位置
+  void touch_tile(int index) {
+    if (dirty) return;
+
+    int x_index = index % x_size;
+    int y_index = index / x_size % y_size;
+
+    ++chunk_revisions[y_index / chunk_size * chunk_columns() +
+                      x_index / chunk_size];
+    ++tile_edits;
+  }
+
+  /// @brief map_data 中的单个图块发生了变化，增量更新优先级索引
+  /// @param index 图块在 map_data 中展开成 1 列时的位置
+  /// @param old_priority 修改前图块的优先级
+  /// @param new_priority 修改后图块的优先级
+  void update_tile(int index, int16_t old_priority, int16_t new_priority) {
+    if (dirty || old_priority == new_priority) return;
+
+    int x_index = index % x_size;
+    int y_index = index / x_size % y_size;
+
+    remove_tile(x_index, y_index, old_priority);
+    add_tile(x_index, y_index, new_priority);
   }
 
   /// @brief 在 z_index 前是否存在可以绘制的 overlayer
@@ -165,6 +288,73 @@ struct tilemap_info {
     if (diff >= 16) return (flag & 0x8000) == 0;
     return (flag & (1u << (diff - 1))) == 0;
   }
+
+  /* 以下函数维护优先级索引，只在 ruby worker 中调用 */
+
+  /// @brief 向索引中添加一个图块
+  void add_tile(int x_index, int y_index, int16_t priority) {
+    /* 设置 max_index，遵循前闭后开原则 */
+    if (max_index < y_index + priority + 1) {
+      max_index = y_index + priority + 1;
+    }
+
+    /* priority = 0 属于平凡情况，不需要操作 */
+    if (priority <= 0) return;
+
+    /* 操作 x_cache 和 y_cache 的单个 bit */
+    int bit = (priority >= 16) ? 15 : (priority - 1);
+    uint16_t flag = 1u << bit;
+
+    if (x_count[x_index * priority_bits + bit]++ == 0) {
+      x_cache[x_index] = x_cache[x_index] | flag;
+    }
+    if (y_count[y_index * priority_bits + bit]++ == 0) {
+      y_cache[y_index] = y_cache[y_index] | flag;
+    }
+    if (priority >= 16 && y_overflow[y_index] < priority) {
+      y_overflow[y_index] = priority;
+    }
+  }
+
+  /// @brief 从索引中移除一个图块
+  void remove_tile(int x_index, int y_index, int16_t priority) {
+    if (priority <= 0) return;
+
+    int bit = (priority >= 16) ? 15 : (priority - 1);
+    uint16_t flag = 1u << bit;
+
+    if (--x_count[x_index * priority_bits + bit] == 0) {
+      x_cache[x_index] = x_cache[x_index] & ~flag;
+    }
+    if (--y_count[y_index * priority_bits + bit] == 0) {
+      y_cache[y_index] = y_cache[y_index] & ~flag;
+    }
+
+    /* 移除的图块可能决定了 max_index，下一帧重新计算 */
+    if (y_index + priority + 1 >= max_index) max_index_dirty = true;
+  }
+
+  /// @brief 根据 y_count 重新计算 max_index，开销只与地图的行数有关
+  void refresh_max_index() {
+    max_index = y_size + 1;
+
+    for (int y_index = 0; y_index < y_size; ++y_index) {
+      /* 找到此行中最高的优先级 */
+      int16_t priority = 0;
+      for (int bit = priority_bits - 1; bit >= 0; --bit) {
+        if (y_count[y_index * priority_bits + bit] == 0) continue;
+
+        priority = (bit == 15) ? y_overflow[y_index] : (bit + 1);
+        break;
+      }
+
+      if (max_index < y_index + priority + 1) {
+        max_index = y_index + priority + 1;
+      }
+    }
+
+    max_index_dirty = false;
+  }
 };
 
 /// @brief 设置 tilemap_info
@@ -215,10 +405,30 @@ struct tilemap_manager {
   /// drawable_create 和 drawable_dispose 中。
   std::map<uint64_t, tilemap_info> infos;
 
+  /// @brief layers 使用的资源池
+  /// layers 的元素每帧都会插入和删除，释放的节点留在池中供下一帧复用。
+  std::pmr::unsynchronized_pool_resource layers_pool;
+
   /// @brief 分层管理所有的 tilemap 的 z_index
   /// layers[0] 储存无 viewport 的 tilemap，
   /// layers[1] 储存有 viewport 的 tilemap。
-  std::array<std::set<z_index>, 2> layers;
+  std::array<std::pmr::set<z_index>, 2> layers{
+      std::pmr::set<z_index>(&layers_pool),
+      std::pmr::set<z_index>(&layers_pool)};
+
+  /// @brief 被 tilemap 引用的 table 的版本
+  /// 通过 Table#[]= 和批量操作修改 table 时更新，流水线模式下的快照据此判断
+  /// 是否需要重新复制 table。版本取自全局递增的序号，未修改过的 table 为 0。
+  std::unordered_map<uint64_t, uint64_t> table_versions;
+
+  /// @brief 全局递增的序号
+  uint64_t table_counter = 0;
+
+  /// @brief 获取 table 的版本
+  [[nodiscard]] uint64_t table_version(uint64_t id) const {
+    auto it = table_versions.find(id);
+    return it == table_versions.end() ? 0 : it->second;
+  }
 
   /// @brief 添加一个 tilemap
   /// @param t 需要添加的 tilemap
@@ -240,12 +450,59 @@ struct tilemap_manager {
     return ti;
   }
 
+  /// @brief 响应 Table#[]= 对 table 单个元素的修改，更新相关的优先级索引
+  /// @param id 被修改的 table 的 id
+  /// @param index 被修改的元素在 table 中展开成 1 列时的位置
+  /// @param old_value 修改前的值
+  /// @param new_value 修改后的值
+  /// 修改 map_data 只需增量更新单个图块；修改 priorities 会影响所有使用了该
+  /// tileid 的图块，直接标记为需要重建。
+  void on_table_set(uint64_t id, int index, int16_t old_value,
+                    int16_t new_value) {
+    table_versions[id] = ++table_counter;
+
+    for (auto& [tilemap_id, info] : infos) {
+      if (info.dirty) continue;
+
+      if (info.priorities_id == id) {
+        info.dirty = true;
+        continue;
+      }
+
+      if (info.map_data_id != id) continue;
+
+      /* priorities 可能已经被释放，此时等下一帧重建 */
+      auto it = p_tables->find(info.priorities_id);
+      if (it == p_tables->end()) {
+        info.dirty = true;
+        continue;
+      }
+
+      const table& priorities = it->second;
+      info.touch_tile(index);
+      info.update_tile(index, tilemap_info::priority_of(priorities, old_value),
+                       tilemap_info::priority_of(priorities, new_value));
+    }
+  }
+
+  /// @brief 响应 Table 的批量修改，使用了该 table 的索引都需要完整地重建
+  /// @param id 被修改的 table 的 id
+  void on_table_reset(uint64_t id) {
+    table_versions[id] = ++table_counter;
+
+    for (auto& [tilemap_id, info] : infos) {
+      if (info.map_data_id == id || info.priorities_id == id) {
+        info.dirty = true;
+      }
+    }
+  }
+
   /// @brief 返回下一个可绘制的 overlayer 层
   /// @return 返回下一层的 tilemap_info 和 index，不存在则返回 std::nullopt
   [[nodiscard]] auto next_layer(z_index zi, size_t depth = 0)
       -> std::optional<std::pair<tilemap_info*, int>> {
     /* layer 中什么也没有则返回空 */
-    std::set<z_index>& s = layers[depth];
+    std::pmr::set<z_index>& s = layers[depth];
     if (s.empty()) return std::nullopt;
 
     /* 读取 layer 中的第一个元素，获取最小的 z_index */
@@ -266,9 +523,10 @@ struct tilemap_manager {
     /* index = 0 说明在当前范围不能产生新的层，需要等下一个更大的 z 值 */
     if (index == 0) return std::nullopt;
 
-    /* 将 front_zi 的 z 值改为 tilemap_info 当前的值 */
-    s.erase(s.begin());
-    s.insert({front_info.current_z(), front_zi.id});
+    /* 将 front_zi 的 z 值改为 tilemap_info 当前的值，复用原来的节点 */
+    auto node = s.extract(s.begin());
+    node.value() = {front_info.current_z(), front_zi.id};
+    s.insert(std::move(node));
 
     /* 返回 tilemap_info 的指针和 index */
     return std::pair{&front_info, index};
@@ -280,11 +538,66 @@ struct init_tilemap_manager {
   /* 引入数据类型 tilemap_manager */
   using data = std::tuple<tilemap_manager>;
 
-  static void before(auto& worker) {
+  static void before(auto& this_worker) {
+    /* 静态的 worker 变量供函数的内部类 wrapper 使用 */
+    static decltype(auto) worker = this_worker;
+
     tilemap_manager& tm = RGMDATA(tilemap_manager);
 
     /* 将 tables 的指针保存为 tilemap_manager 的成员变量 */
     tm.p_tables = &(RGMDATA(tables));
+
+    /* wrapper 类，创建静态方法供 ruby 的模块绑定 */
+    struct wrapper {
+      /* ruby method: Base#table_set_observed -> tilemap_manager::on_table_set */
+      static VALUE set_observed(VALUE, VALUE id_, VALUE index_, VALUE value_) {
+        RGMLOAD(id, uint64_t);
+        RGMLOAD(index, int);
+        RGMLOAD(value, int);
+
+        tilemap_manager& tm = RGMDATA(tilemap_manager);
+        table& t = tm.p_tables->at(id);
+
+        /* 记录修改前的值，以便从优先级索引中移除 */
+        const int16_t old_value = t.get(index);
+        const int16_t new_value = static_cast<int16_t>(value);
+        t.set(index, new_value);
+
+        if (old_value != new_value) {
+          tm.on_table_set(id, index, old_value, new_value);
+        }
+        return value_;
+      }
+
+      /* ruby method: Base#table_reset_observed ->
+       * tilemap_manager::on_table_reset */
+      static VALUE reset_observed(VALUE, VALUE id_) {
+        RGMLOAD(id, uint64_t);
+
+        RGMDATA(tilemap_manager).on_table_reset(id);
+        return Qnil;
+      }
+
+      /* ruby method: Base#tilemap_draw_calls -> tilemap_info::draw_calls */
+      static VALUE draw_calls(VALUE, VALUE id_) {
+        RGMLOAD(id, uint64_t);
+
+        tilemap_manager& tm = RGMDATA(tilemap_manager);
+        auto it = tm.infos.find(id);
+        if (it == tm.infos.end()) return INT2FIX(0);
+
+        return INT2FIX(it->second.draw_calls);
+      }
+    };
+
+    VALUE rb_mRGM = rb_define_module("RGM");
+    VALUE rb_mRGM_Base = rb_define_module_under(rb_mRGM, "Base");
+    rb_define_module_function(rb_mRGM_Base, "table_set_observed",
+                              wrapper::set_observed, 3);
+    rb_define_module_function(rb_mRGM_Base, "table_reset_observed",
+                              wrapper::reset_observed, 1);
+    rb_define_module_function(rb_mRGM_Base, "tilemap_draw_calls",
+                              wrapper::draw_calls, 1);
   }
 };
 }  // namespace rgm::rmxp
\ No newline at end of file
@@ -63,6 +63,7 @@ struct setup_default_viewport {
 ///    同时释放所有绑定到该 viewport 的其他 drawable。
 /// 3. set_z，修改 viewport 的 z 值
 /// 4. refresh_value，同步更新值类型的属性
+/// 5. touch_object，标记对象类型的属性已修改
 /// @see ./src/rmxp/init_drawable.hpp
 struct init_viewport {
   static void before(auto& this_worker) {
@@ -150,6 +151,14 @@ struct init_viewport {
         }
         return Qnil;
       }
+
+      /* ruby method: Base#viewport_touch_object -> viewport::object_dirty */
+      static VALUE touch_object(VALUE, VALUE data_ptr_) {
+        RGMLOAD(data_ptr, viewport*);
+
+        if (data_ptr) data_ptr->object_dirty = true;
+        return Qnil;
+      }
     };
 
     VALUE rb_mRGM = rb_define_module("RGM");
@@ -162,6 +171,8 @@ struct init_viewport {
                               2);
     rb_define_module_function(rb_mRGM_Base, "viewport_refresh_value",
                               wrapper::refresh_value, 2);
+    rb_define_module_function(rb_mRGM_Base, "viewport_touch_object",
+                              wrapper::touch_object, 1);
   }
 };
 }  // namespace rgm::rmxp
\ No newline at end of file
@@ -0,0 +1,354 @@
+# zlib License
+#
+# copyright (C) 2023 Guoxiaomi and Krimiston
+#
+# This software is provided 'as-is', without any express or implied
+# warranty.  In no event will the authors be held liable for any damages
+# arising from the use of this software.
+#
+# Permission is granted to anyone to use this software for any purpose,
+# including commercial applications, and to alter it and redistribute it
+# freely, subject to the following restrictions:
+#
+# 1. The origin of this software must not be misrepresented; you must not
+#    claim that you wrote the original software. If you use this software
+#    in a product, an acknowledgment in the product documentation would be
+#    appreciated but is not required.
+# 2. Altered source versions must be plainly marked as such, and must not be
+#    misrepresented as being the original software.
+# 3. This notice may not be removed or altered from any source distribution.
+
+# 开发用的基准测试和检查，只在 Build_Mode < 2 时加载。
+# 各项测试共用 RGM::Benchmark 计时，返回的耗时单位都是毫秒。
+
+module RGM::Benchmark
+  module_function
+
+  # 单调时钟的当前时间，单位是毫秒
+  def clock
+    Process.clock_gettime(Process::CLOCK_MONOTONIC) * 1000
+  end
+
+  # 执行 block，返回其耗时，单位是毫秒
+  def measure
+    t = clock
+    yield
+    clock - t
+  end
+
+  # 向渲染线程发送 count 个空任务并等待执行完毕，返回逐个发送和批量发送时每秒处理的任务数，
+  # {single:, batched:}
+  def kernel(count = 100_000)
+    {
+      single: count / RGM::Base.kernel_benchmark(count, false),
+      batched: count / RGM::Base.kernel_benchmark(count, true)
+    }
+  end
+
+  # 与渲染、音频和旁路线程各同步 count 次，返回 {worker_id => 平均每次往返的耗时}，单位是毫秒
+  # 对空闲的 worker 调用 RGMWAIT，耗时主要是唤醒阻塞的线程所需的时间。
+  def synchronize(count = 10_000)
+    [1, 2, 3].to_h do |id|
+      [id, measure { count.times { RGM::Base.synchronize(id) } } / count]
+    end
+  end
+end
+
+module Graphics
+  module_function
+
+  # 用 32x32 的雾图铺满 1280x720 的 Viewport，每帧滚动 ox 和 oy，
+  # 返回平均每帧的耗时（毫秒）以及期间 Plane 平铺缓存的变化，{ms:, hits:, misses:}
+  def plane_benchmark(frames = 300)
+    bitmap = Bitmap.new(32, 32)
+    bitmap.fill_rect(bitmap.rect, Color.new(255, 255, 255, 64))
+    bitmap.fill_rect(8, 8, 16, 16, Color.new(128, 160, 255, 160))
+
+    viewport = Viewport.new(0, 0, 1280, 720)
+    plane = Plane.new(viewport)
+    plane.bitmap = bitmap
+    plane.blend_type = 1
+
+    last_frame_rate = @@frame_rate
+    @@frame_rate = 100_000
+    hits, misses, = render_stats[:plane]
+
+    elapsed = RGM::Benchmark.measure do
+      frames.times do |i|
+        plane.ox = i * 3
+        plane.oy = i
+        update
+      end
+    end
+
+    @@frame_rate = last_frame_rate
+    hits2, misses2, = render_stats[:plane]
+
+    plane.dispose
+    viewport.dispose
+    bitmap.dispose
+    { ms: elapsed / frames, hits: hits2 - hits, misses: misses2 - misses }
+  end
+
+  # 打开 count 个不同尺寸的窗口并连续执行 frames 帧，
+  # 返回平均每帧的耗时（毫秒）、期间窗口背景缓存的变化，以及最近一帧绘制窗口时
+  # 调用 renderer.render 的次数，{ms:, hits:, misses:, draw_calls:}
+  def window_benchmark(count = 20, frames = 300)
+    skin = Bitmap.new(192, 128)
+    skin.fill_rect(0, 0, 128, 128, Color.new(32, 48, 96, 224))
+    skin.fill_rect(128, 0, 64, 64, Color.new(255, 255, 255, 255))
+
+    windows = Array.new(count) do |i|
+      window = Window.new
+      window.windowskin = skin
+      window.x = i % 5 * 128
+      window.y = i / 5 * 120
+      window.width = 160 + i % 4 * 80
+      window.height = 96 + i % 3 * 64
+      window
+    end
+
+    last_frame_rate = @@frame_rate
+    @@frame_rate = 100_000
+    hits, misses, = render_stats[:window]
+
+    elapsed = RGM::Benchmark.measure do
+      frames.times do
+        windows.each(&:update)
+        update
+      end
+    end
+
+    @@frame_rate = last_frame_rate
+    hits2, misses2, _, draw_calls = render_stats[:window]
+
+    windows.each(&:dispose)
+    skin.dispose
+    { ms: elapsed / frames, hits: hits2 - hits, misses: misses2 - misses,
+      draw_calls: draw_calls }
+  end
+
+  # 在边长为 sizes 的 3 层地图上连续执行 frames 帧，每帧用 Table#[]= 修改 10 个图块，
+  # 返回 {边长 => 平均每帧的耗时}，单位是毫秒。优先级索引是增量更新的，耗时不应随地图变大。
+  def tilemap_benchmark(sizes = [100, 250, 500], frames = 120)
+    tileset = Bitmap.new(256, 1024)
+    priorities = Table.new(384 + 1280)
+    priorities.xsize.times { |i| priorities[i] = i % 5 == 0 ? 1 + i % 3 : 0 }
+
+    last_frame_rate = @@frame_rate
+    @@frame_rate = 100_000
+
+    result = sizes.to_h do |size|
+      map_data = Table.new(size, size, 3)
+      3.times { |z| map_data.set_layer(z, Array.new(size * size) { 384 + rand(1280) }.pack('s*')) }
+
+      tilemap = Tilemap.new
+      tilemap.tileset = tileset
+      tilemap.priorities = priorities
+      tilemap.map_data = map_data
+      update
+
+      elapsed = RGM::Benchmark.measure do
+        frames.times do
+          10.times { map_data[rand(size), rand(size), rand(3)] = 384 + rand(1280) }
+          update
+        end
+      end
+
+      tilemap.dispose
+      [size, elapsed / frames]
+    end
+
+    @@frame_rate = last_frame_rate
+    tileset.dispose
+    result
+  end
+
+  # software 渲染器中用 CPU 实现 tone、hue、gray 和 color 的速度，单位是百万像素每秒，
+  # 返回 {效果 => 速度}，其中 :tone_single 是不使用多线程时 tone 的速度
+  def effect_benchmark(width = 640, height = 480)
+    keys = [:tone, :hue, :gray, :color, :tone_single]
+    keys.zip(RGM::Base.software_effect_benchmark(width, height)).to_h
+  end
+end
+
+class Table
+  # 比较批量操作和 ruby 中逐个元素循环的耗时，返回 {操作 => [ruby, bulk]}，单位是毫秒
+  def self.benchmark(xsize = 500, ysize = 500, zsize = 3)
+    measure = RGM::Benchmark.method(:measure)
+
+    table = Table.new(xsize, ysize, zsize)
+    other = Table.new(xsize, ysize, zsize)
+    result = {}
+
+    result[:fill] = [
+      measure.call do
+        zsize.times { |z| ysize.times { |y| xsize.times { |x| table[x, y, z] = (x + y) % 7 } } }
+      end,
+      measure.call { table.fill(3) }
+    ]
+
+    table.set_layer(0, Array.new(xsize * ysize) { |i| i % 7 }.pack('s*'))
+    result[:copy] = [
+      measure.call do
+        zsize.times { |z| ysize.times { |y| xsize.times { |x| other[x, y, z] = table[x, y, z] } } }
+      end,
+      measure.call { other.copy_from(table, 0, 0, 0, 0, 0, 0, xsize, ysize, zsize) }
+    ]
+
+    result[:layer] = [
+      measure.call { ysize.times.collect { |y| xsize.times.collect { |x| table[x, y, 0] } }.flatten.pack('s*') },
+      measure.call { table.layer(0) }
+    ]
+
+    result[:find] = [
+      measure.call do
+        found = []
+        zsize.times { |z| ysize.times { |y| xsize.times { |x| found << [x, y, z] if table[x, y, z] == 5 } } }
+      end,
+      measure.call { table.find(5) }
+    ]
+
+    result[:histogram] = [
+      measure.call do
+        counts = Hash.new(0)
+        ysize.times { |y| xsize.times { |x| counts[table[x, y, 0]] += 1 } }
+      end,
+      measure.call { table.histogram(0) }
+    ]
+
+    result
+  end
+end
+
+class Bitmap
+  # 在 640x480 的 Bitmap 上绘制 count 个字符串，返回总耗时（毫秒）以及期间字形缓存的变化，{ms:, hits:, misses:}
+  # 需要比较软件渲染器的结果时，在 config.ini 中设置 RenderDriver=software，或者使用无窗口模式。
+  def self.draw_text_benchmark(count = 10_000)
+    bitmap = Bitmap.new(640, 480)
+    lines = Array.new(count) { |i| "Lv #{i % 99 + 1}  HP #{i % 9999}/9999  Potion x#{i % 40}" }
+    hits, misses = Graphics.render_stats[:glyph]
+
+    elapsed = RGM::Benchmark.measure do
+      lines.each_with_index { |line, i| bitmap.draw_text(i * 37 % 300, i * 53 % 440, 320, 32, line) }
+      RGM::Base.synchronize(1)
+    end
+
+    hits2, misses2 = Graphics.render_stats[:glyph]
+    bitmap.dispose
+    { ms: elapsed, hits: hits2 - hits, misses: misses2 - misses }
+  end
+end
+
+class Palette
+  # 比较批量操作和 ruby 中逐像素循环的耗时，返回 {操作 => [ruby, bulk]}，单位是毫秒
+  def self.benchmark(width = 256, height = 256)
+    measure = RGM::Benchmark.method(:measure)
+
+    dst = Palette.new(width, height)
+    src = Palette.new(width, height)
+    color = Color.new(40, 80, 120, 160)
+    white = Color.new(255, 255, 255, 255)
+    result = {}
+
+    result[:fill_rect] = [
+      measure.call { height.times { |y| width.times { |x| dst.set_pixel(x, y, color) } } },
+      measure.call { dst.fill_rect(dst.rect, color) }
+    ]
+
+    src.fill_rect(src.rect, color)
+    result[:blt] = [
+      measure.call do
+        height.times do |y|
+          width.times do |x|
+            s = src.get_pixel(x, y)
+            d = dst.get_pixel(x, y)
+            a = s.alpha / 255.0
+            dst.set_pixel(x, y, Color.new(s.red * a + d.red * (1 - a),
+                                          s.green * a + d.green * (1 - a),
+                                          s.blue * a + d.blue * (1 - a),
+                                          s.alpha + d.alpha * (1 - a)))
+          end
+        end
+      end,
+      measure.call { dst.blt(0, 0, src, src.rect) }
+    ]
+
+    result[:grayscale] = [
+      measure.call do
+        height.times do |y|
+          width.times do |x|
+            c = dst.get_pixel(x, y)
+            g = c.red * 0.299 + c.green * 0.587 + c.blue * 0.114
+            dst.set_pixel(x, y, Color.new(g, g, g, c.alpha))
+          end
+        end
+      end,
+      measure.call { dst.grayscale }
+    ]
+
+    result[:replace_color] = [
+      measure.call do
+        height.times do |y|
+          width.times do |x|
+            dst.set_pixel(x, y, white) if dst.get_pixel(x, y) == color
+          end
+        end
+      end,
+      measure.call { dst.replace_color(color, white) }
+    ]
+
+    dst.dispose
+    src.dispose
+    result
+  end
+end
+
+# 比较 Marshal.load 和 C++ 实现读取 rxdata 的耗时，返回 [ruby, native]，单位是毫秒
+def load_data_benchmark(pattern = 'Data/*.rxdata')
+  bins = Dir.glob(pattern).collect { |fn| File.binread(fn) }
+
+  [
+    RGM::Benchmark.measure { bins.each { |bin| force_utf8_encode(Marshal.load(bin)) } },
+    RGM::Benchmark.measure { bins.each { |bin| load_marshal_data(bin) } }
+  ]
+end
+
+# 检查 C++ 实现读取的结果与 Marshal.load 和 force_utf8_encode 是否完全一致，
+# 返回结果不一致的文件名。开启 LazyEventPages 时会通过 pages 读取跳过的 @pages。
+def load_data_check(pattern = 'Data/*.rxdata')
+  same = lambda do |a, b|
+    return false unless a.class == b.class
+
+    case a
+    when Array
+      a.size == b.size && a.zip(b).all? { |x, y| same.call(x, y) }
+    when Hash
+      a.keys == b.keys && a.all? { |key, x| same.call(x, b[key]) }
+    when String
+      a == b && a.encoding == b.encoding
+    when Float
+      a == b || (a.nan? && b.nan?)
+    else
+      if a.respond_to?(:_dump)
+        a._dump == b._dump
+      elsif a.instance_variables.empty?
+        a == b
+      else
+        b.pages if b.is_a?(RPG::Event)
+        a.instance_variables.sort == b.instance_variables.sort &&
+          a.instance_variables.all? do |name|
+            x = a.instance_variable_get(name)
+            same.call(x, b.instance_variable_get(name))
+          end
+      end
+    end
+  end
+
+  Dir.glob(pattern).reject do |fn|
+    bin = File.binread(fn)
+    expected = Marshal.load(bin)
+    force_utf8_encode(expected)
+    same.call(expected, load_marshal_data(bin))
+  end
+end
@@ -165,29 +165,61 @@ class Bitmap
 
   # get_pixel(x, y)
   # Gets the color (Color) at the specified pixel (x, y).
-  # get_pixel 运行较慢的原因如下：
-  # 1. 该 Bitmap 可能有绘制任务等待异步执行，必须等待绘制完毕才能获得正确的颜色；
-  # 2. 获取 texture 中的颜色需要从 GPU 中读取数据，效率极低；
-  # 3. RGSS 里没有调用过该方法。
-  # 故这个方法不建议经常使用。
+  # RGM 会在内存中保存 Bitmap 像素的副本，第一次调用时从 GPU 整体读回，
+  # 之后直接读取副本，直到 Bitmap 被修改（blt、fill_rect 等）。
+  # 读回需要等待该 Bitmap 的绘制任务执行完毕，可以提前调用 readback_async。
   # RGM 实现了 Palette 类来方便像素操作，Palette 的数据操作都是同步的。
   def get_pixel(x, y)
-    puts '[Warning] Bitmap#get_pixel is a very slow operation, and should not be used frequently.'
     c = RGM::Base.bitmap_get_pixel(@id, x.to_i, y.to_i)
     Color.new(c & 255, (c >> 8) & 255, (c >> 16) & 255, c >> 24)
   end
 
+  # get_pixels(rect)
+  # 一次性获取矩形区域内的像素，按行依次返回 Color 的数组。
+  def get_pixels(rect)
+    RGM::Base.bitmap_get_pixels(@id, rect).collect do |c|
+      Color.new(c & 255, (c >> 8) & 255, (c >> 16) & 255, c >> 24)
+    end
+  end
+
+  # readback_async
+  # 异步地读回像素的副本，不会等待。副本已经可用时返回 true。
+  # 可以在修改 Bitmap 后调用，之后的 get_pixel 就不需要等待读回。
+  def readback_async
+    RGM::Base.bitmap_readback_async(@id)
+  end
+
   if RGM::Config::Render_Driver == RGM::Driver::Direct3D11
     if RGM::Config::Build_Mode >= 2
       def get_pixel(_x, _y)
         Color.new(0, 0, 0, 0)
       end
+
+      def get_pixels(_rect)
+        []
+      end
+
+      def readback_async
+        false
+      end
     else
       def get_pixel(_x, _y)
         puts '[Warning] Bitmap#get_pixel may return invalid result with Direct3d11 driver.'
         puts 'Bitmap#get_pixel is deprecated in this situation, Use Palette#get_pixel instead.'
         raise
       end
+
+      def get_pixels(_rect)
+        puts '[Warning] Bitmap#get_pixels may return invalid result with Direct3d11 driver.'
+        puts 'Bitmap#get_pixels is deprecated in this situation, Use Palette#get_pixel instead.'
+        raise
+      end
+
+      def readback_async
+        puts '[Warning] Bitmap#readback_async may return invalid result with Direct3d11 driver.'
+        puts 'Bitmap#readback_async is deprecated in this situation, Use Palette instead.'
+        raise
+      end
     end
   end
 
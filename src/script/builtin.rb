@@ -79,6 +79,7 @@ RGM::Base.decorate_builtin_setter(Color, :red, 0, 255)
 RGM::Base.decorate_builtin_setter(Color, :green, 0, 255)
 RGM::Base.decorate_builtin_setter(Color, :blue, 0, 255)
 RGM::Base.decorate_builtin_setter(Color, :alpha, 0, 255)
+RGM::Base.decorate_builtin_observable(Color)
 
 class Tone
   # ---------------------------------------------------------------------------
@@ -144,6 +145,7 @@ RGM::Base.decorate_builtin_setter(Tone, :red, -255, 255)
 RGM::Base.decorate_builtin_setter(Tone, :green, -255, 255)
 RGM::Base.decorate_builtin_setter(Tone, :blue, -255, 255)
 RGM::Base.decorate_builtin_setter(Tone, :gray, 0, 255)
+RGM::Base.decorate_builtin_observable(Tone)
 
 class Rect
   # ---------------------------------------------------------------------------
@@ -215,3 +217,4 @@ RGM::Base.decorate_builtin_setter(Rect, :x, Rect::Lower_Limit, Rect::Upper_Limit
 RGM::Base.decorate_builtin_setter(Rect, :y, Rect::Lower_Limit, Rect::Upper_Limit)
 RGM::Base.decorate_builtin_setter(Rect, :width, Rect::Lower_Limit, Rect::Upper_Limit)
 RGM::Base.decorate_builtin_setter(Rect, :height, Rect::Lower_Limit, Rect::Upper_Limit)
+RGM::Base.decorate_builtin_observable(Rect)
@@ -42,6 +42,7 @@ File.open(RGM::Config::Config_Path, 'r') do |f|
       flag = :Keymap if line == '[Keymap]'
       flag = :Font if line == '[Font]'
       flag = :Kernel if line == '[Kernel]'
+      flag = :Benchmark if line == '[Benchmark]'
       next
     end
 
@@ -117,3 +118,6 @@ File.open(RGM::Config::Config_Path, 'r') do |f|
     next if flag == :Kernel
   end
 end
+
+# 无窗口的基准测试模式，回放录制的按键输入
+Input.load_replay(RGM::Config::Benchmark_Input) if RGM::Config::Headless && !RGM::Config::Benchmark_Input.empty?
@@ -42,10 +42,15 @@ module RGM::Base
     # opacity-type attributes, automatically corrected in range 0-255
     opacities = %i[back_opacity contents_opacity opacity]
     decorate_drawable_setter klass, Code_SetOpacity, *opacities
+
+    # object-type attributes, as Color / Tone / Rect observed by the drawable
+    objects = %i[color cursor_rect src_rect tone]
+    decorate_drawable_setter klass, Code_SetObject, *objects
   end
 
   def decorate_drawable_base(klass)
     drawable_create = RGM::Base.method("#{klass.name.downcase}_create".to_sym)
+    drawable_touch = RGM::Base.method("#{klass.name.downcase}_touch_object".to_sym)
 
     klass.class_eval do
       # -----------------------------------------------------------------------
@@ -59,6 +64,9 @@ module RGM::Base
 
       define_method(:drawable_create, ->(obj) { drawable_create.call(obj) })
 
+      # 对象类型的属性（Color、Tone 和 Rect）被修改时调用，通知 C++ 层在下次绘制前重新读取
+      define_method(:touch_object, -> { drawable_touch.call(@data_ptr) unless @disposed })
+
       attr_reader :viewport, :visible, :z
 
       alias_method :origin_initialize, :initialize
@@ -81,6 +89,9 @@ module RGM::Base
         # 初始化其他实例变量
         origin_initialize
 
+        # 监听对象类型的属性，其修改会通知到此 Drawable
+        RGM::Base.observe_objects(self)
+
         # 构建 C++ 层的 Drawable 对象并互相绑定
         @data_ptr = drawable_create(self)
 
@@ -101,6 +112,7 @@ module RGM::Base
         @visible = false
         @disposed = true
         @data_ptr = nil
+        RGM::Base.unobserve_objects(self)
         RGM::Base.drawable_dispose(@viewport, @id)
       end
 
@@ -128,6 +140,34 @@ module RGM::Base
     end
   end
 
+  # 让 Color、Tone 和 Rect 记录引用了自身的 Drawable。
+  # 这些对象可能被多个 Drawable 共享（比如 $game_screen.tone），属性被修改时
+  # 会调用每个 Drawable 的 touch_object，Graphics.update 就不必每帧重新读取。
+  def decorate_builtin_observable(klass)
+    klass.class_eval(Code_Observable)
+  end
+
+  Observed_Objects = %i[@color @cursor_rect @flash_color @rect @src_rect @tone].freeze
+
+  def observe_objects(drawable)
+    Observed_Objects.each do |name|
+      next unless drawable.instance_variable_defined?(name)
+
+      object = drawable.instance_variable_get(name)
+      object.observe(drawable) if object.respond_to?(:observe)
+    end
+  end
+
+  # dispose 时取消监听，之后修改共享的 Color 等对象不再通知此 Drawable
+  def unobserve_objects(drawable)
+    Observed_Objects.each do |name|
+      next unless drawable.instance_variable_defined?(name)
+
+      object = drawable.instance_variable_get(name)
+      object.unobserve(drawable) if object.respond_to?(:unobserve)
+    end
+  end
+
   def decorate_builtin_setter(klass, name, min, max)
     klass.class_eval(
       Code_SetBounded
@@ -170,6 +210,7 @@ module RGM::Base
         raise ArgumentError, 'Argument 1 should be nil or Table.' if table && !table.is_a?(Table)
         if @__attr__ != table
           @__attr__ = table
+          table.observe if table
           RGM::Base.__class___refresh_value(@data_ptr, RGM::Word::Attribute___attr__) unless @disposed
         end
         @__attr__
@@ -193,13 +234,50 @@ module RGM::Base
     end
   END
 
+  Code_SetObject = <<~END
+    if defined? :@__attr__
+      def __attr__=(object)
+        unless @__attr__.equal?(object)
+          @__attr__.unobserve(self) if @__attr__
+          @__attr__ = object
+          object.observe(self)
+          touch_object unless @disposed
+        end
+        @__attr__
+      end
+    end
+  END
+
+  Code_Observable = <<~END
+    # 使用 WeakMap 弱引用监听者，共享的对象不会阻止 Drawable 被垃圾回收。
+    # ruby 3.2 的 WeakMap 不能删除元素，取消监听时将值设为 false。
+    def observe(drawable)
+      @observers ||= ObjectSpace::WeakMap.new
+      @observers[drawable] = true
+    end
+
+    def unobserve(drawable)
+      @observers[drawable] = false if @observers&.key?(drawable)
+    end
+
+    # clone 和 dup 得到的对象不继承原对象的监听者
+    def initialize_copy(other)
+      super
+      @observers = nil
+    end
+  END
+
   Code_SetBounded = <<~END
     def __attr__=(value)
       value = value.to_i
       value = __max__ if value > __max__
       value = __min__ if value < __min__
 
-      @__attr__ = value
+      if @__attr__ != value
+        @__attr__ = value
+        @observers&.each { |drawable, active| drawable.touch_object if active }
+      end
+      @__attr__
     end
   END
 end
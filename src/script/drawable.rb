@@ -59,8 +59,11 @@ class Sprite
     if color
       @flash_type = 0
       @flash_count = duration
+      @flash_color.unobserve(self)
       @flash_color = color
+      @flash_color.observe(self)
       @flash_hidden = false
+      touch_object
     else
       @flash_type = 1
       @flash_count = duration
@@ -178,6 +181,11 @@ class Tilemap
     @update_count = (@update_count + 1) % 1_073_741_824
     RGM::Base.tilemap_refresh_value(@data_ptr, RGM::Word::Attribute_update_count)
   end
+
+  # 上一帧绘制此 Tilemap 时的绘制调用次数，用于检查区块缓存的效果
+  def draw_calls
+    RGM::Base.tilemap_draw_calls(@id)
+  end
 end
 
 # apply decorator
@@ -37,13 +37,23 @@ module Graphics
       return if @@low_fps_countdown < @@low_fps_ratio
     end
 
-    unless @@freeze_bitmap
+    unless @@frozen
       RGM::Base.graphics_update
-      RGM::Base::Temp.clear
+      update_temp
     end
     present
   end
 
+  def update_temp
+    # 流水线模式下，Graphics.update 返回时只保证 2 帧之前的绘制已经完成，
+    # 最近 2 帧内 keep_alive 的对象仍可能被渲染线程使用，需要多保留 2 帧。
+    if RGM::Config::Pipelined
+      @@temp_generations << RGM::Base::Temp.dup
+      @@temp_generations.shift while @@temp_generations.size > 2
+    end
+    RGM::Base::Temp.clear
+  end
+
   def update_synchronize
     return unless @@flag_synchronize
 
@@ -87,7 +97,8 @@ module Graphics
   def freeze
     # Fixes the current screen in preparation for transitions.
     # Screen rewrites are prohibited until the transition method is called.
-    @@freeze_bitmap = snap_to_bitmap
+    @@freeze_bitmap = snap_to_bitmap(@@freeze_bitmap)
+    @@frozen = true
   end
 
   def transition(duration = 8, filename = '', vague = 40)
@@ -100,18 +111,16 @@ module Graphics
     #            File extensions may be omitted.
     # [vague] sets the ambiguity of the borderline between the graphic's starting and ending points.
     #         The larger the value, the greater the ambiguity. When omitted, this value is set to 40.
-    if duration <= 0
-      @@freeze_bitmap.dispose if @@freeze_bitmap
-      @@freeze_bitmap = nil
-    end
+    @@frozen = false if duration <= 0
 
-    @@freeze_bitmap ||= snap_to_bitmap
+    # freeze 和 current 在多次渐变之间复用，不会重新创建 Bitmap
+    @@freeze_bitmap = snap_to_bitmap(@@freeze_bitmap) unless @@frozen
     RGM::Base.graphics_update
-    @@current_bitmap = snap_to_bitmap
+    @@current_bitmap = snap_to_bitmap(@@current_bitmap)
 
     duration /= @@low_fps_ratio if @@low_fps_mode
 
-    if filename.empty? || RGM::Config::Render_Driver == RGM::Driver::Software
+    if filename.empty?
       duration.times do |i|
         RGM::Base.graphics_transition(
           @@freeze_bitmap.id, @@current_bitmap.id, i / duration.to_f, 0, 0
@@ -119,20 +128,16 @@ module Graphics
         present
       end
     else
-      transition_bitmap = Bitmap.new(filename)
+      transition_bitmap = load_transition(filename)
       duration.times do |i|
         RGM::Base.graphics_transition(
           @@freeze_bitmap.id, @@current_bitmap.id, i / duration.to_f, transition_bitmap.id, vague.to_i
         )
         present
       end
-      transition_bitmap.dispose
     end
 
-    @@freeze_bitmap.dispose
-    @@current_bitmap.dispose
-    @@freeze_bitmap = nil
-    @@current_bitmap = nil
+    @@frozen = false
   end
 
   def frame_reset
@@ -148,6 +153,14 @@ module Graphics
     RGM::Base.present_window
     RGM::Base.check_delay(Graphics.frame_rate)
     @@frame_count += 1
+    update_benchmark if RGM::Config::Headless
+  end
+
+  def update_benchmark
+    # 无窗口的基准测试模式，运行指定的帧数后退出，Frames=0 则一直运行
+    # 不使用 frame_count，因为读档时会被改写
+    @@benchmark_count += 1
+    exit if @@benchmark_count == RGM::Config::Benchmark_Frames
   end
 
   def resize_window(width, height, scale_mode = 0)
@@ -170,12 +183,29 @@ module Graphics
     RGM::Base.resize_screen(@@width, @@height)
   end
 
-  def snap_to_bitmap
-    bitmap = Bitmap.new(@@width, @@height)
+  # 截取画面，尽量复用 bitmap，只在画面大小改变时重新创建
+  def snap_to_bitmap(bitmap = nil)
+    if bitmap.nil? || bitmap.disposed? || bitmap.width != @@width || bitmap.height != @@height
+      bitmap&.dispose
+      bitmap = Bitmap.new(@@width, @@height)
+    end
     bitmap.capture_screen
     bitmap
   end
 
+  # 读取渐变图，最近使用的 TRANSITION_CACHE_SIZE 张会被缓存，不需要重复解码
+  def load_transition(filename)
+    bitmap = @@transition_bitmaps.delete(filename)
+    bitmap = Bitmap.new(filename) if bitmap.nil? || bitmap.disposed?
+    @@transition_bitmaps[filename] = bitmap
+
+    if @@transition_bitmaps.size > TRANSITION_CACHE_SIZE
+      _, oldest = @@transition_bitmaps.shift
+      oldest.dispose
+    end
+    bitmap
+  end
+
   def frame_count
     @@frame_count
   end
@@ -208,6 +238,54 @@ module Graphics
     @@low_fps_ratio = ratio
   end
 
+  # 上一帧绘制的 sprite 数量，以及合批后实际的绘制任务数量，返回 [sprites, batches]
+  def sprite_stats
+    RGM::Base.graphics_sprite_stats
+  end
+
+  # 上一帧重新读取对象类型属性的 Drawable 数量、跳过读取的数量，以及 Graphics.update
+  # 中读取实例变量（rb_ivar_get）的总次数，返回 [refreshed, skipped, reads]
+  # 只有 Color、Tone 或 Rect 被修改过的 Drawable 才需要重新读取，但 reads 中仍然包括
+  # 每个 Drawable 的 @visible，以及每帧都要刷新的 Tilemap 的对象类型属性。
+  def object_stats
+    RGM::Base.graphics_object_stats
+  end
+
+  # 一次读取渲染线程中的统计数据，返回 Hash，每一项都是数组：
+  #   window:   窗口背景缓存的 [hits, misses, size]，以及上一帧绘制 Window 的 draw_calls
+  #   plane:    Plane 平铺缓存的 [hits, misses, size]
+  #   pool:     渲染目标缓存池的 [hits, misses, evictions, bytes]，bytes 是空闲 texture 占用的字节数
+  #   viewport: 上一帧直接绘制的 Viewport 数量和复制到单独的层上的数量 [direct, captured]
+  #   shader:   上一帧的 [switches, skipped_switches, uploads, skipped_uploads, queries]，只统计 opengl 渲染器
+  #   glyph:    字形缓存的 [hits, misses]
+  # 需要等待渲染线程，不要在每帧的逻辑中调用。
+  def render_stats
+    RGM::Base.graphics_render_stats
+  end
+
+  # 上一帧从逐帧内存池中分配的字节数、内存池向堆申请内存的次数、内存池的总字节数，
+  # 以及全局 operator new 的调用次数，返回 [bytes, overflows, capacity, heap]
+  # operator new 只在开发模式下统计，其他模式下为 0。
+  def arena_stats
+    RGM::Base.graphics_arena_stats
+  end
+
+  # 在当前场景中连续执行 frames 帧，返回平均每帧的堆分配次数、从内存池中分配的字节数，
+  # 以及内存池向堆申请内存的总次数，{heap:, bytes:, overflows:}
+  # 在地图场景中，内存池预热之后 heap 和 overflows 都应该为 0。
+  def allocation_benchmark(frames = 300)
+    heap = bytes = overflows = 0
+
+    frames.times do
+      update
+      b, o, _, h = arena_stats
+      heap += h
+      bytes += b
+      overflows += o
+    end
+    { heap: heap.to_f / frames, bytes: bytes.to_f / frames, overflows: overflows }
+  end
+
   # The screen's refresh rate count. Set this property to 0 at game start and
   # the game play time (in seconds) can be calculated by dividing this value by
   # the frame_rate property value.
@@ -222,8 +300,13 @@ module Graphics
 
   @@freeze_bitmap = nil
   @@current_bitmap = nil
+  @@frozen = false
   @@flag_synchronize = false
 
+  # 缓存的渐变图，与渲染线程中 transition_cache 的容量相同
+  TRANSITION_CACHE_SIZE = 8
+  @@transition_bitmaps = {}
+
   @@show_fps = (RGM::Config::Build_Mode < 2)
   @@fps_last_frame_count = 0
   @@fps_last_time = Time.now.to_f
@@ -231,4 +314,10 @@ module Graphics
   @@low_fps_mode = false
   @@low_fps_ratio = 2
   @@low_fps_countdown = 0
+
+  # 流水线模式下暂时保留的 RGM::Base::Temp
+  @@temp_generations = []
+
+  # 无窗口的基准测试模式下已经运行的帧数
+  @@benchmark_count = 0
 end
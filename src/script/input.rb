@@ -195,6 +195,27 @@ module Input
     RGM::Base.controller_bind(button, key, joy_index)
   end
 
+  def load_replay(path)
+    # 读取录制的输入脚本，在无窗口模式下回放。每行的格式为：帧号 +按键 或 帧号 -按键
+    # 帧号是第几次调用 Input.update（从 0 开始），+ 表示按下，- 表示抬起，
+    # 按键可以是 Input 中的常量名或者数字，# 开头的行是注释。例如：
+    # 30 +C
+    # 32 -C
+    File.foreach(path) do |line|
+      line = line.strip
+      next if line.empty? || line.start_with?('#')
+      raise "Invalid input replay line: #{line}" unless line =~ /^(\d+)\s+([+-])(-?\w+)$/
+
+      frame = Regexp.last_match(1).to_i
+      press = Regexp.last_match(2) == '+'
+      key = Regexp.last_match(3)
+      key = key =~ /^-?\d+$/ ? key.to_i : const_get(key.to_sym)
+      key += 256 if key < 0
+
+      RGM::Base.input_replay(frame, key, press)
+    end
+  end
+
   def controller_axis_value(axis, joy_index = 0)
     axis = RGM::SDL.const_get(axis) if axis.is_a?(Symbol)
     # compare with RGM::Config::Controller_Axis_Threshold
@@ -67,16 +67,21 @@ def force_utf8_encode(obj)
   end
 end
 
-def load_data(fn)
-  fn = Finder.find(fn, :data)
-  data = nil
-  File.open(fn, 'rb') do |f|
-    data = Marshal.load(f)
-  end
+# 使用 C++ 实现的 Marshal 读取数据，字符串直接创建为 UTF-8 编码，Table 直接
+# 复制到 C++ 层中。遇到不支持的数据时，退回到 Marshal.load 和 force_utf8_encode。
+def load_marshal_data(bin)
+  RGM::Base.marshal_load(bin)
+rescue NotImplementedError
+  data = Marshal.load(bin)
   force_utf8_encode(data)
   data
 end
 
+def load_data(fn)
+  fn = Finder.find(fn, :data)
+  load_marshal_data(File.binread(fn))
+end
+
 def save_data(obj, fn)
   File.open(fn, 'wb') do |f|
     Marshal.dump(obj, f)
@@ -91,18 +96,13 @@ end
 
 if RGM::Config::Build_Mode >= 3
   def load_data(fn)
-    data = nil
     if fn.start_with?('Data/')
       bin = RGM::Base.embeded_load(fn)
-      data = Marshal.load(bin)
     else
       fn = Finder.find(fn, :data)
-      File.open(fn, 'rb') do |f|
-        data = Marshal.load(f)
-      end
+      bin = File.binread(fn)
     end
-    force_utf8_encode(data)
-    data
+    load_marshal_data(bin)
   end
 end
 
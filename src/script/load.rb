@@ -67,5 +67,6 @@ load_script 'audio.rb'
 load_script 'rpg.rb'
 load_script 'rpgcache.rb'
 load_script 'config.rb'
+load_script 'benchmark.rb' if RGM::Config::Build_Mode < 2
 # entry
 load_script 'main.rb'
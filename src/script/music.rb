@@ -92,5 +92,11 @@ module RGM
     def ==(other)
       other.is_a?(Music) && other.path == @path
     end
+
+    # 比较 n 次同步查询和读取快照的平均耗时，返回 [sync, snapshot]，单位是微秒
+    # 现在 music_get_state 等查询直接读取音频状态的快照，不再等待音频线程。
+    def self.latency_benchmark(n = 1000)
+      RGM::Base.audio_latency_benchmark(n)
+    end
   end
 end
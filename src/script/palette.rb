@@ -64,6 +64,57 @@ class Palette
     RGM::Base.palette_set_pixel(@id, x.to_i, y.to_i, color)
   end
 
+  # 以下是批量操作的接口，在 C++ 中使用 SIMD 处理整个区域的像素，
+  # 比在 ruby 中循环调用 get_pixel 和 set_pixel 快得多。
+  # rect 省略时处理整个 Palette。
+
+  def fill_rect(*args)
+    if args.first.is_a?(Rect)
+      r = args[0]
+      c = args[1]
+    else
+      r = Rect.new(args[0], args[1], args[2], args[3])
+      c = args[4]
+    end
+    RGM::Base.palette_fill_rect(@id, r, c)
+  end
+
+  # 将 src_palette 的 rect 区域以 alpha 混合的方式绘制到 (x, y) 处
+  def blt(x, y, src_palette, rect, opacity = 255)
+    RGM::Base.palette_blt(@id, x.to_i, y.to_i, src_palette.id, rect, opacity.to_i)
+  end
+
+  def hue_change(hue, rect = nil)
+    RGM::Base.palette_hue_change(@id, rect || self.rect, hue.to_i)
+  end
+
+  def tone_change(tone, rect = nil)
+    RGM::Base.palette_tone_change(@id, rect || self.rect, tone)
+  end
+
+  def grayscale(rect = nil)
+    RGM::Base.palette_grayscale(@id, rect || self.rect)
+  end
+
+  # 将颜色与 from 完全相同的像素替换为 to，返回替换的像素数量
+  def replace_color(from, to)
+    RGM::Base.palette_replace_color(@id, from, to)
+  end
+
+  # 导出所有像素，每个像素依次是 r、g、b、a 4 个字节
+  def export_pixels
+    RGM::Base.palette_export_pixels(@id)
+  end
+
+  # 导入 export_pixels 格式的像素，字符串的长度必须是 width * height * 4
+  def import_pixels(string)
+    RGM::Base.palette_import_pixels(@id, string)
+  end
+
+  def rect
+    Rect.new(0, 0, @width, @height)
+  end
+
   def save_png(path)
     RGM::Base.palette_save_png(@id, path.to_s)
   end
@@ -26,6 +26,7 @@ module RGM
 
     # keep_alive 将其他线程异步使用的 ruby 对象保存在 Temp 数组中，暂时阻止该对象的 GC。
     # 主要给 Bitmap 的 draw_text 使用。每次 Graphics.update 结束后，Temp 数组会清空。
+    # 流水线模式下，清空的对象还会在 Graphics 中多保留 2 帧。
     def keep_alive(object)
       Temp << object
       object
@@ -5,6 +5,7 @@
 # --------------------------------------------------------------------
 module RGM
   module Base
+    def audio_latency_benchmark(n); end
     def bitmap_blt(id, x, y, src_id, rect, opacity); end
     def bitmap_capture_screen(id); end
     def bitmap_create(id, width, height); end
@@ -12,8 +13,10 @@ module RGM
     def bitmap_draw_text(id, font, rect, text, align); end
     def bitmap_fill_rect(id, rect, color); end
     def bitmap_get_pixel(id, x, y); end
+    def bitmap_get_pixels(id, rect); end
     def bitmap_grayscale(id); end
     def bitmap_hue_change(id, hue); end
+    def bitmap_readback_async(id); end
     def bitmap_reload_autotile(id); end
     def bitmap_save_png(id, path); end
     def bitmap_stretch_blt(id, dst_rect, src_id, src_rect, opacity); end
@@ -27,9 +30,14 @@ module RGM
     def drawable_set_z(drawable, viewport, z); end
     def embeded_load(); end
     def embeded_load(path); end
+    def external_cache_stats(); end
     def font_create(path); end
     def get_display_bounds(); end
     def get_hwnd(); end
+    def graphics_arena_stats(); end
+    def graphics_object_stats(); end
+    def graphics_render_stats(); end
+    def graphics_sprite_stats(); end
     def graphics_transition(freeze_id, current_id, rate, transition_id, vague); end
     def graphics_update(); end
     def input_bind(sdl_key, input_key); end
@@ -37,11 +45,15 @@ module RGM
     def input_last_release(); end
     def input_press(input_key); end
     def input_repeat(input_key); end
+    def input_replay(frame, input_key, press); end
     def input_reset(); end
     def input_trigger(input_key); end
     def input_update(); end
+    def kernel_benchmark(count, batched); end
     def load_script(); end
     def load_script(path); end
+    def marshal_load(buffer); end
+    def marshal_load_pages(source); end
     def message_show(text); end
     def music_create(id, path); end
     def music_dispose(id); end
@@ -49,6 +61,7 @@ module RGM
     def music_fade_out(duration); end
     def music_finish_callback(); end
     def music_get_position(id); end
+    def music_get_state(); end
     def music_get_volume(); end
     def music_halt(); end
     def music_pause(); end
@@ -59,39 +72,59 @@ module RGM
     def music_set_soundfonts(path); end
     def music_set_volume(volume); end
     def new_id(); end
+    def palette_blt(id, x, y, src_id, rect, opacity); end
     def palette_convert_to_bitmap(id, bitmap_id, rect); end
     def palette_create(id, width, height); end
     def palette_dispose(id); end
+    def palette_export_pixels(id); end
+    def palette_fill_rect(id, rect, color); end
     def palette_get_pixel(id, x, y); end
+    def palette_grayscale(id, rect); end
+    def palette_hue_change(id, rect, hue); end
+    def palette_import_pixels(id, string); end
+    def palette_replace_color(id, from, to); end
     def palette_save_png(id, path); end
     def palette_set_pixel(id, x, y, color); end
+    def palette_tone_change(id, rect, tone); end
     def present_window(); end
     def resize_screen(width, height); end
     def resize_window(width, height, scale_mode); end
     def set_fullscreen(mode); end
     def set_title(title); end
+    def software_effect_benchmark(width, height); end
     def sound_create(id, path); end
     def sound_dispose(id); end
     def sound_fade_in(id, duration); end
     def sound_fade_out(id, duration); end
     def sound_get_channel(id); end
     def sound_get_state(id); end
+    def sound_pitch_benchmark(speed, sinc); end
     def sound_play(id, iteration); end
     def sound_set_pitch(id, pitch, loop); end
     def sound_set_volume(id, volume); end
     def sound_stop(id); end
     def synchronize(worker_id); end
+    def table_copy(id, src_id, x, y, z, src_x, src_y, src_z, width, height, depth); end
     def table_create(id, x_size, y_size, z_size); end
     def table_dispose(id); end
     def table_dump(id); end
+    def table_fill(id, value, x, y, z, width, height, depth); end
+    def table_find(id, value, z); end
     def table_get(data_ptr, index); end
+    def table_get_layer(id, z); end
+    def table_histogram(id, z); end
     def table_load(id, string); end
+    def table_reset_observed(id); end
     def table_resize(id, x_size, y_size, z_size); end
     def table_set(data_ptr, index, value); end
+    def table_set_layer(id, z, string); end
+    def table_set_observed(id, index, value); end
+    def trace_dump(path); end
     def viewport_create(viewport); end
     def viewport_dispose(id); end
     def viewport_refresh_value(data_ptr, type); end
     def viewport_set_z(viewport, z); end
+    def viewport_touch_object(data_ptr); end
   end
 
   module Ext
@@ -116,11 +149,15 @@ module RGM
 
   module Config
     Battle_Test
+    Benchmark_Frames
+    Benchmark_Input
     Build_Mode
     Config_Path
     Controller_Axis_Threshold
     Debug
     Game_Title
+    Headless
+    Lazy_Event_Pages
     Max_Workers
     Render_Driver
     Render_Driver_Name
@@ -689,7 +689,34 @@ module RPG
       @y = y
       @pages = [RPG::Event::Page.new]
     end
-    attr_accessor :id, :name, :x, :y, :pages
+    attr_accessor :id, :name, :x, :y
+
+    # 开启 LazyEventPages 时，load_data 会跳过 @pages，在第一次访问时读取
+    def pages
+      if @pages_source
+        @pages = RGM::Base.marshal_load_pages(@pages_source)
+        remove_instance_variable(:@pages_source)
+      end
+      @pages
+    end
+
+    def pages=(pages)
+      remove_instance_variable(:@pages_source) if @pages_source
+      @pages = pages
+    end
+
+    # @pages_source 不写入存档，dump 之前先读取 @pages
+    if RGM::Config::Lazy_Event_Pages
+      def marshal_dump
+        pages
+        instance_variables.to_h { |name| [name, instance_variable_get(name)] }
+      end
+    end
+
+    # 读取开启 LazyEventPages 时保存的存档
+    def marshal_load(ivars)
+      ivars.each { |name, value| instance_variable_set(name, value) }
+    end
   end
 end
 
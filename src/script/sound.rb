@@ -41,6 +41,10 @@ module RGM
   # 3. module functions can only use as Music class functions
   # - sound_is_any_playing -> bool
 
+  # 4. benchmark of the pitch resampler
+  # - sound_pitch_benchmark(speed : Float, sinc : Boolean)
+  #   -> seconds of PCM processed per second on one channel
+
   class Sound
     attr_reader :id, :path
     attr_accessor :volume, :pitch
@@ -98,5 +102,10 @@ module RGM
     def ==(other)
       other.is_a?(Sound) && other.id == @id
     end
+
+    # 变调处理的基准测试，返回单个 channel 每秒能处理的 PCM 数据的秒数
+    def self.pitch_benchmark(speed = 1.5, sinc = false)
+      RGM::Base.sound_pitch_benchmark(speed, sinc)
+    end
   end
 end
@@ -28,6 +28,9 @@ class Table
   # 位置，加上偏移进行数据访问。在 STL 的 vector 实现下只有 create 和 resize 可能会改
   # 变 &vector.front() 的地址，这两个函数都会返回新的 @data_ptr 的值，从而合法访问数据。
 
+  # 被 Tilemap 引用的 Table 会设置 @observed，此后 []= 会通知 C++ 层，以增量更新 Tilemap
+  # 的图块优先级索引，避免每帧遍历整个 map_data。
+
   attr_reader :id, :xsize, :ysize, :zsize
 
   def self.create_finalizer
@@ -44,6 +47,7 @@ class Table
     @xsize = xsize
     @ysize = ysize
     @zsize = zsize
+    @observed = false
 
     @data_ptr = RGM::Base.table_create(@id, xsize, ysize, zsize)
     ObjectSpace.define_finalizer(self, self.class.create_finalizer)
@@ -71,7 +75,57 @@ class Table
     raise 'Invalid element index of table' if invalid?(x, y, z)
 
     index = x + @xsize * (y + @ysize * z)
-    RGM::Base.table_set(@data_ptr, index, value)
+    if @observed
+      RGM::Base.table_set_observed(@id, index, value)
+    else
+      RGM::Base.table_set(@data_ptr, index, value)
+    end
+  end
+
+  def observe
+    @observed = true
+  end
+
+  # 以下是批量操作的接口，在 C++ 中检查一次范围后直接处理整块数据，
+  # 比在 ruby 中逐个元素调用 [] 和 []= 快得多。范围越界时抛出 IndexError。
+  # 被 Tilemap 引用的 Table 在批量修改后会通知 Tilemap 完整地重建索引。
+
+  # 用 value 填充起点为 (x, y, z)，大小为 (width, height, depth) 的长方体
+  def fill(value, x = 0, y = 0, z = 0, width = @xsize - x, height = @ysize - y, depth = @zsize - z)
+    RGM::Base.table_fill(@id, value, x, y, z, width, height, depth)
+    RGM::Base.table_reset_observed(@id) if @observed
+  end
+
+  # 将 src_table 中起点为 (src_x, src_y, src_z) 的长方体复制到 (x, y, z) 处
+  # src_table 可以是自身，重叠的区域会被正确地处理
+  def copy_from(src_table, x, y, z, src_x, src_y, src_z, width, height, depth)
+    RGM::Base.table_copy(@id, src_table.id, x, y, z, src_x, src_y, src_z, width, height, depth)
+    RGM::Base.table_reset_observed(@id) if @observed
+  end
+
+  # 以 String 的形式返回第 z 层的数据，每个元素是 2 字节的 int16_t，可以用 unpack('s*') 解析
+  def layer(z = 0)
+    RGM::Base.table_get_layer(@id, z)
+  end
+
+  # 用 layer 格式的 String 替换第 z 层的数据
+  def set_layer(z, string)
+    RGM::Base.table_set_layer(@id, z, string)
+    RGM::Base.table_reset_observed(@id) if @observed
+  end
+
+  # 查找所有等于 value 的元素，返回坐标 [x, y, z] 的数组，z 为 nil 时查找所有层
+  def find(value, z = nil)
+    RGM::Base.table_find(@id, value, z).collect do |index|
+      yz, x = index.divmod(@xsize)
+      z2, y = yz.divmod(@ysize)
+      [x, y, z2]
+    end
+  end
+
+  # 统计第 z 层中各个值出现的次数，返回 {value => count}
+  def histogram(z = 0)
+    RGM::Base.table_histogram(@id, z)
   end
 
   def inspect
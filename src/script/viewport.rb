@@ -59,6 +59,7 @@ class Viewport
 
     # constructor / destructor
     @data_ptr = RGM::Base.viewport_create(self)
+    RGM::Base.observe_objects(self)
     ObjectSpace.define_finalizer(self, self.class.create_finalizer(@id))
   end
 
@@ -72,6 +73,7 @@ class Viewport
     @visible = false
     @disposed = true
     @data_ptr = nil
+    RGM::Base.unobserve_objects(self)
     RGM::Base.viewport_dispose(@id)
   end
 
@@ -79,6 +81,11 @@ class Viewport
     @visible = visible & (!@disposed)
   end
 
+  # 对象类型的属性被修改时调用，通知 C++ 层在下次绘制前重新读取
+  def touch_object
+    RGM::Base.viewport_touch_object(@data_ptr) unless @disposed
+  end
+
   # value type members setters
   def z=(z)
     return @z if @z == z
@@ -108,8 +115,11 @@ class Viewport
     if color
       @flash_type = 0
       @flash_count = duration
+      @flash_color.unobserve(self)
       @flash_color = color
+      @flash_color.observe(self)
       @flash_hidden = false
+      touch_object
     else
       @flash_type = 1
       @flash_count = duration
@@ -133,3 +143,6 @@ class Viewport
     RGM::Base.viewport_refresh_value(@data_ptr, RGM::Word::Attribute_flash_hidden) unless @disposed
   end
 end
+
+# 对象类型的属性，修改时通知 C++ 层重新读取
+RGM::Base.decorate_drawable_setter(Viewport, RGM::Base::Code_SetObject, :color, :tone, :rect)
@@ -97,6 +97,12 @@ struct init_shader {
     }
   }
 };
+
+/// @brief 任务：进入下一帧，保存 shader 的统计数据
+/// 需要在每帧的 clear_screen 之后发送。
+struct shader_step {
+  void run(auto&) { gl_state::step(); }
+};
 }  // namespace rgm::shader
 
 namespace rgm {
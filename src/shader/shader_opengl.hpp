@@ -148,6 +148,61 @@ struct shader_base<opengl> {
   }
 };
 
+/// @brief 渲染线程中 OpenGL 程序状态的缓存
+/// SDL 内部会缓存自己使用的程序，只有切换时才调用 glUseProgram，
+/// 所以每次使用完 shader 后都必须还原成 SDL 的程序，无法跨越绘制合批。
+/// 此类记录当前绑定的程序和嵌套使用 shader 时需要还原的程序，
+/// 跳过重复的 glUseProgram，只在最外层的 shader 中查询 SDL 的程序。
+struct gl_state {
+  /// @brief 当前绑定的程序，只在 shader 的作用域内有效
+  inline static GLint current_program = 0;
+
+  /// @brief 嵌套使用 shader 时，每一层结束后需要还原的程序
+  inline static std::vector<GLint> saved_programs;
+
+  /// @brief 本帧的统计数据：程序切换、跳过的切换、上传 uniform、
+  /// 跳过的 uniform 和查询程序的次数
+  inline static std::array<uint64_t, 5> counters{};
+
+  /// @brief 上一帧的统计数据
+  inline static std::array<uint64_t, 5> last_counters{};
+
+  /// @brief 开始使用程序 program，必须与 pop 成对调用
+  static void push(GLint program) {
+    if (saved_programs.empty()) {
+      /* 最外层需要查询 SDL 当前的程序，结束后还原 */
+      glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
+      ++counters[4];
+    }
+    saved_programs.push_back(current_program);
+    use(program);
+  }
+
+  /// @brief 结束使用程序，还原成 push 之前的程序
+  static void pop() {
+    const GLint program = saved_programs.back();
+    saved_programs.pop_back();
+    use(program);
+  }
+
+  /// @brief 绑定程序 program，与当前的程序相同时跳过
+  static void use(GLint program) {
+    if (program == current_program) {
+      ++counters[1];
+      return;
+    }
+    glUseProgram(program);
+    current_program = program;
+    ++counters[0];
+  }
+
+  /// @brief 进入下一帧，保存本帧的统计数据
+  static void step() {
+    last_counters = counters;
+    counters.fill(0);
+  }
+};
+
 /// @brief 动态 shader 类对 opengl 渲染器的特化
 /// @tparam T_shader shader 的类型
 /// 利用 RAII 机制切换 shader，渲染效果执行结束后再切回来。
@@ -160,21 +215,31 @@ struct shader_dynamic<opengl, T_shader> : shader_base<opengl> {
   /* T_shader 对应的程序 ID */
   inline static GLint program_id = 0;
 
-  /* 存储调用此 shader 之前的程序 ID，用于后续恢复 */
-  GLint last_program_id;
+  /* T_shader 的程序中各个 uniform 上次上传的值。
+   * 此程序只在这里使用，uniform 的值会一直保留，相同时无需重复上传 */
+  inline static std::unordered_map<GLint, std::array<float, 4>> uniforms;
 
   /// @brief 构造函数
   explicit shader_dynamic() {
-    /* 存储旧的 shader */
-    glGetIntegerv(GL_CURRENT_PROGRAM, &last_program_id);
-
-    /* 应用 T_shader */
-    glUseProgram(program_id);
+    /* 应用 T_shader，析构时还原旧的 shader */
+    gl_state::push(program_id);
   }
 
-  ~shader_dynamic() {
-    /* 还原旧的 shader */
-    glUseProgram(last_program_id);
+  ~shader_dynamic() { gl_state::pop(); }
+
+  /// @brief 设置 T_shader 的 vec4 类型的 uniform，与上次的值相同时跳过
+  static void set_uniform(GLint location, float x, float y, float z,
+                          float w) {
+    const std::array<float, 4> value = {x, y, z, w};
+
+    auto it = uniforms.find(location);
+    if (it != uniforms.end() && it->second == value) {
+      ++gl_state::counters[3];
+      return;
+    }
+    glUniform4f(location, x, y, z, w);
+    uniforms.insert_or_assign(location, value);
+    ++gl_state::counters[2];
   }
 
   /// @brief 初始化 T_shader
@@ -229,7 +294,7 @@ struct shader_hue<opengl> : shader_dynamic<opengl, shader_hue> {
 
     /* 设置 GL Uniform */
     static const auto location = glGetUniformLocation(program_id, "k");
-    glUniform4f(location, k0, k1, k2, 0);
+    set_uniform(location, k0, k1, k2, 0);
   }
 };
 
@@ -247,7 +312,7 @@ struct shader_tone<opengl> : shader_dynamic<opengl, shader_tone> {
 
     /* 设置 GL Uniform */
     static const auto location = glGetUniformLocation(program_id, "tone");
-    glUniform4f(location, red, green, blue, gray);
+    set_uniform(location, red, green, blue, gray);
   }
 };
 
@@ -275,7 +340,7 @@ struct shader_transition<opengl> : shader_dynamic<opengl, shader_transition> {
 
     /* 设置 GL Uniform */
     static const auto location = glGetUniformLocation(program_id, "k");
-    glUniform4f(location, k0, k1, k2, k3);
+    set_uniform(location, k0, k1, k2, k3);
   }
 };
 }  // namespace rgm::shader
\ No newline at end of file